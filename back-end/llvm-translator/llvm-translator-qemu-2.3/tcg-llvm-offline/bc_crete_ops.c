@@ -13,6 +13,16 @@ struct MemoryElement
     uint64_t m_static_addr;
 };
 
+struct MemoryRange
+{
+    uint64_t m_static_addr;
+    uint64_t m_size;
+    const uint8_t *m_data;
+};
+
+// Unit within which static addresses are expected to map to contiguous dynamic ones
+#define CRETE_SYNC_PAGE_SIZE 4096
+
 extern uint64_t crete_get_dynamic_addr(uint64_t);
 
 __attribute__((noinline)) static void internal_sync_cpu_state(uint8_t *cpu_state, uint32_t cs_size,
@@ -51,6 +61,61 @@ __attribute__((noinline)) static void internal_crete_sync_memory(const struct Me
     }
 }
 
+__attribute__((noinline)) static void internal_crete_sync_memory_ranges(const struct MemoryRange *sync_table, uint32_t st_size)
+{
+    const struct MemoryRange *current_range;
+    for(uint32_t i = 0; i < st_size; ++i)
+    {
+        current_range = sync_table + i;
+        uint64_t static_addr = current_range->m_static_addr;
+        uint64_t size = current_range->m_size;
+        const uint8_t *data = current_range->m_data;
+
+        // Ranges are written page by page, translating the address once per page
+        // when the page is mapped contiguously. As in internal_crete_sync_memory(),
+        // a byte is only written if it differs, so that bytes already holding the
+        // value keep their (possibly symbolic) state under KLEE.
+        while(size > 0)
+        {
+            uint64_t len = CRETE_SYNC_PAGE_SIZE - (static_addr & (CRETE_SYNC_PAGE_SIZE - 1));
+            if(len > size)
+            {
+                len = size;
+            }
+
+            uint8_t *first = (uint8_t *)crete_get_dynamic_addr(static_addr);
+            uint8_t *last = (uint8_t *)crete_get_dynamic_addr(static_addr + len - 1);
+
+            if(last == first + (len - 1))
+            {
+                for(uint64_t j = 0; j < len; ++j)
+                {
+                    if(first[j] != data[j])
+                    {
+                        first[j] = data[j];
+                    }
+                }
+            }
+            else
+            {
+                for(uint64_t j = 0; j < len; ++j)
+                {
+                    uint8_t *ptr_current_value = (uint8_t *)crete_get_dynamic_addr(static_addr + j);
+
+                    if(*ptr_current_value != data[j])
+                    {
+                        *ptr_current_value = data[j];
+                    }
+                }
+            }
+
+            static_addr += len;
+            data += len;
+            size -= len;
+        }
+    }
+}
+
 void crete_sync_cpu_state(uint8_t *cpu_state, uint32_t cs_size,
         const struct CPUStateElement *sync_table, uint32_t st_size)
 {
@@ -61,3 +126,8 @@ void crete_sync_memory(const struct MemoryElement *sync_table, uint32_t st_size)
 {
     internal_crete_sync_memory(sync_table, st_size);
 }
+
+void crete_sync_memory_ranges(const struct MemoryRange *sync_table, uint32_t st_size)
+{
+    internal_crete_sync_memory_ranges(sync_table, st_size);
+}
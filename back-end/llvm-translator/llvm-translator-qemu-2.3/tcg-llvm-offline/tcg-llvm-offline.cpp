@@ -29,15 +29,39 @@ uint64_t opc_defs_size = 0;
 #endif // !defined(TCG_LLVM_OFFLINE)
 }
 
-#if !defined(TCG_LLVM_OFFLINE)
-void TCGLLVMOfflineContext::dump_tlo_tb_pc(const uint64_t pc)
+QEMU_BUILD_BUG_ON(sizeof(TCGOp) != sizeof(uint64_t));
+QEMU_BUILD_BUG_ON(sizeof(TCGArg) > sizeof(uint64_t));
+
+void TCGLLVMOfflineContext::dump_tcg_ctx(const TCGContext& tcg_ctx)
 {
-    m_tlo_tb_pc.push_back(pc);
+    CompactTCGContext c;
+
+    c.nb_globals = tcg_ctx.nb_globals;
+    c.nb_temps = tcg_ctx.nb_temps;
+    c.nb_labels = tcg_ctx.nb_labels;
+
+    c.gen_first_op_idx = tcg_ctx.gen_first_op_idx;
+    c.gen_last_op_idx = tcg_ctx.gen_last_op_idx;
+    c.gen_next_op_idx = tcg_ctx.gen_next_op_idx;
+    c.gen_next_parm_idx = tcg_ctx.gen_next_parm_idx;
+
+    assert(c.gen_next_op_idx >= 0 && c.gen_next_op_idx <= OPC_BUF_SIZE);
+    assert(c.gen_next_parm_idx >= 0 && c.gen_next_parm_idx <= OPPARAM_BUF_SIZE);
+
+    c.ops.resize(c.gen_next_op_idx);
+    if(!c.ops.empty())
+        memcpy(&c.ops[0], tcg_ctx.gen_op_buf, c.ops.size() * sizeof(TCGOp));
+
+    c.params.assign(tcg_ctx.gen_opparam_buf,
+            tcg_ctx.gen_opparam_buf + c.gen_next_parm_idx);
+
+    m_tcg_ctx.push_back(c);
 }
 
-void TCGLLVMOfflineContext::dump_tcg_ctx(const TCGContext& tcg_ctx)
+#if !defined(TCG_LLVM_OFFLINE)
+void TCGLLVMOfflineContext::dump_tlo_tb_pc(const uint64_t pc)
 {
-    m_tcg_ctx.push_back(tcg_ctx);
+    m_tlo_tb_pc.push_back(pc);
 }
 
 void TCGLLVMOfflineContext::dump_tcg_temp(const vector<TCGTemp>& tcg_temp)
@@ -79,9 +103,31 @@ uint64_t TCGLLVMOfflineContext::get_tlo_tb_pc(const uint64_t tb_index) const
     return m_tlo_tb_pc[tb_index];
 }
 
-const TCGContext& TCGLLVMOfflineContext::get_tcg_ctx(const uint64_t tb_index) const
+// Restore the captured TB tb_index into tcg_ctx. Only the live range of the op
+// and param buffers is written, the rest of tcg_ctx is left untouched.
+void TCGLLVMOfflineContext::load_tcg_ctx(const uint64_t tb_index, TCGContext& tcg_ctx) const
 {
-    return m_tcg_ctx[tb_index];
+    const CompactTCGContext& c = m_tcg_ctx[tb_index];
+
+    tcg_ctx.nb_globals = c.nb_globals;
+    tcg_ctx.nb_temps = c.nb_temps;
+    tcg_ctx.nb_labels = c.nb_labels;
+
+    tcg_ctx.gen_first_op_idx = c.gen_first_op_idx;
+    tcg_ctx.gen_last_op_idx = c.gen_last_op_idx;
+    tcg_ctx.gen_next_op_idx = c.gen_next_op_idx;
+    tcg_ctx.gen_next_parm_idx = c.gen_next_parm_idx;
+
+    assert(c.ops.size() == (uint64_t)c.gen_next_op_idx &&
+            c.ops.size() <= OPC_BUF_SIZE);
+    assert(c.params.size() == (uint64_t)c.gen_next_parm_idx &&
+            c.params.size() <= OPPARAM_BUF_SIZE);
+
+    if(!c.ops.empty())
+        memcpy(tcg_ctx.gen_op_buf, &c.ops[0], c.ops.size() * sizeof(TCGOp));
+
+    for(uint64_t i = 0; i < c.params.size(); ++i)
+        tcg_ctx.gen_opparam_buf[i] = (TCGArg)c.params[i];
 }
 
 const vector<TCGTemp>& TCGLLVMOfflineContext::get_tcg_temp(const uint64_t tb_index) const
@@ -152,9 +198,22 @@ extern "C" {
 
 #include <boost/exception/all.hpp>
 #include <boost/filesystem.hpp>
+#include <crete/trace_container.h>
 #include <sstream>
+#include <algorithm>
 
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/un.h>
 
 #define CRETE_DEBUG
 
@@ -171,6 +230,24 @@ uint16_t gen_opc_icount[OPC_BUF_SIZE];
 uint8_t gen_opc_instr_start[OPC_BUF_SIZE];
 
 std::string crete_data_dir;
+// Directory of the TB cache shared among translator runs (--tb-cache)
+std::string crete_tb_cache_dir;
+// Size in MB the TB cache is trimmed to after each trace (--tb-cache-size), 0 for unbounded
+uint64_t crete_tb_cache_size = 4096;
+// Unix socket to serve translation requests on (--daemon)
+std::string crete_daemon_socket;
+// Output of a translation served by the daemon, in its trace directory
+const char *crete_daemon_log_name = "translator.log";
+// Number of worker processes translating the TBs of a trace (--jobs)
+unsigned crete_translate_jobs = 1;
+// Traces with fewer TBs per worker than this are translated serially
+const uint64_t CRETE_MIN_TBS_PER_JOB = 64;
+// Translate the chunks of a trace while it is being captured (--stream)
+bool crete_stream_trace = false;
+// FIFO QEMU notifies whenever it writes a chunk of the streamed trace (--stream)
+std::string crete_stream_signal;
+// Seconds to wait for the next chunk of a streamed trace
+const unsigned CRETE_STREAM_TIMEOUT = 600;
 
 enum CreteFileType {
     CRETE_FILE_TYPE_LLVM_LIB,
@@ -194,6 +271,40 @@ static void crete_set_data_dir(const char* data_dir)
 //  crete_data_dir = ".";
 }
 
+static void crete_parse_args(int argc, char **argv)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+
+        if(arg == "--tb-cache" && i + 1 < argc)
+        {
+            crete_tb_cache_dir = argv[++i];
+        }
+        else if(arg == "--tb-cache-size" && i + 1 < argc)
+        {
+            crete_tb_cache_size = strtoull(argv[++i], NULL, 10);
+        }
+        else if(arg == "--daemon" && i + 1 < argc)
+        {
+            crete_daemon_socket = argv[++i];
+        }
+        else if(arg == "--stream" && i + 1 < argc)
+        {
+            crete_stream_trace = true;
+            crete_stream_signal = argv[++i];
+        }
+        else if(arg == "--jobs" && i + 1 < argc)
+        {
+            crete_translate_jobs = std::max(atoi(argv[++i]), 1);
+        }
+        else
+        {
+            throw std::runtime_error("invalid argument: " + arg);
+        }
+    }
+}
+
 static std::string crete_find_file(CreteFileType type, const char *name)
 {
     namespace fs = boost::filesystem;
@@ -251,10 +362,10 @@ const char * get_helper_name(uint64_t func_addr)
     return ret;
 }
 
-void x86_llvm_translator()
+// Create tcg_llvm_ctx and link the helper libraries into it. The resulting
+// module is the starting point of every trace translation.
+static void crete_init_translator()
 {
-    namespace fs = boost::filesystem;
-
 #if defined(CRETE_DEBUG)
     cerr<< "this is the new main function from tcg-llvm-offline.\n" << endl;
 
@@ -284,14 +395,249 @@ void x86_llvm_translator()
     #error CRETE: Only I386 and x64 supported!
 #endif // defined(TARGET_X86_64) || defined(TARGET_I386)
 
+    if(!crete_tb_cache_dir.empty())
+    {
+        tcg_llvm_ctx->crete_set_tb_cache_dir(crete_tb_cache_dir, crete_tb_cache_size << 20);
+    }
+}
+
+// Translate TB tb_index of the offline context into tcg_llvm_ctx, and dump its
+// qemu-ir into tbir_file_name
+static void crete_translate_tb(TCGLLVMOfflineContext& offline_ctx, uint64_t tb_index,
+        const char *tbir_file_name)
+{
+    //3.1 update temp_tb
+    TranslationBlock temp_tb = {};
+    TCGContext *s = &tcg_ctx;
+
+    temp_tb.pc = (target_long)offline_ctx.get_tlo_tb_pc(tb_index);
+
+    //3.2 update tcg_ctx
+    offline_ctx.load_tcg_ctx(tb_index, *s);
+
+    //3.3 update gen_opc_buf and gen_opparam_buf, only the live range matters
+
+    for(int j = 0; j < s->gen_next_op_idx; ++j) {
+        gen_opc_buf[j] = (uint16_t)s->gen_op_buf[j].opc;
+    }
+
+    for(int j = 0; j < s->gen_next_parm_idx; ++j) {
+        gen_opparam_buf[j] = s->gen_opparam_buf[j];
+    }
+
+    // 3.4 update tcg-temp
+    const vector<TCGTemp> temp_tcg_temp = offline_ctx.get_tcg_temp(tb_index);
+    assert( temp_tcg_temp.size() == s->nb_temps);
+    for(uint64_t j = 0; j < s->nb_temps; ++j)
+        s->temps[j].assign(temp_tcg_temp[j]);
+
+    // generate offline-tbir.txt
+    uint64_t tb_inst_count = offline_ctx.get_tlo_tb_inst_count(tb_index);
+
+    FILE *f = fopen(tbir_file_name, "a");
+    assert(f);
+
+    fprintf(f, "qemu-ir-tb-%llu-%llu: tb_inst_count = %llu\n",
+            (unsigned long long)tcg_llvm_ctx->getTbCount(),
+            (unsigned long long)temp_tb.pc, (unsigned long long)tb_inst_count);
+    tcg_dump_ops_file(s, f);
+    fprintf(f, "\n");
+
+    fclose(f);
+
+    //3.5 generate llvm bitcode
+
+    cerr << "tcg_llvm_ctx->generateCode(s, &temp_tb) will be invoked." << endl;
+    temp_tb.tcg_llvm_context = NULL;
+    temp_tb.llvm_function = NULL;
+
+    tcg_llvm_ctx->generateCode(s, &temp_tb);
+
+    cerr<< "tcg_llvm_ctx->generateCode(s, &temp_tb) is done." << endl;
+
+    assert(temp_tb.tcg_llvm_context != NULL);
+    assert(temp_tb.llvm_function != NULL);
+}
+
+// Translate all TBs of the offline context. With --jobs N, the TBs are split
+// into N contiguous ranges, each translated by a forked worker into a partial
+// module, which is linked back into tcg_llvm_ctx in TB order. A worker
+// inherits tcg_llvm_ctx with its helpers, and numbers its TB functions as the
+// serial translation would. A range whose worker failed is translated here.
+static void crete_translate_tbs_parallel(TCGLLVMOfflineContext& offline_ctx)
+{
+    namespace fs = boost::filesystem;
+
+    const char *tbir_file_name = "offline-tbir.txt";
+    uint64_t tb_num = offline_ctx.get_size();
+    uint64_t jobs = std::min<uint64_t>(crete_translate_jobs,
+            tb_num / CRETE_MIN_TBS_PER_JOB);
+
+    if(jobs <= 1) {
+        for(uint64_t i = 0; i < tb_num; ++i)
+            crete_translate_tb(offline_ctx, i, tbir_file_name);
+
+        return;
+    }
+
+    int base_tb_count = tcg_llvm_ctx->getTbCount();
+    vector<pid_t> workers(jobs, -1);
+    vector<uint64_t> range_begins(jobs + 1, tb_num);
+
+    for(uint64_t k = 0; k < jobs; ++k)
+        range_begins[k] = tb_num * k / jobs;
 
+    // Workers refer to the globals of tcg_llvm_ctx by name
+    tcg_llvm_ctx->crete_externalize_local_globals();
+
+    for(uint64_t k = 0; k < jobs; ++k) {
+        stringstream part_bc, part_tbir, part_stats;
+        part_bc << "dump_tcg_llvm_offline.part." << k << ".bc";
+        part_tbir << tbir_file_name << ".part." << k;
+        part_stats << "dump_tcg_llvm_offline.part." << k << ".stats";
+        fs::remove(part_tbir.str());
+
+        pid_t pid = fork();
+        if(pid == 0) {
+            // Cancelling the translation kills the parent
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+            int ret = 1;
+            try {
+                uint64_t hits, misses;
+                tcg_llvm_ctx->crete_get_tb_cache_stats(hits, misses);
+                tcg_llvm_ctx->crete_set_tb_count(base_tb_count + range_begins[k]);
+
+                for(uint64_t i = range_begins[k]; i < range_begins[k+1]; ++i)
+                    crete_translate_tb(offline_ctx, i, part_tbir.str().c_str());
+
+                if(tcg_llvm_ctx->crete_write_generated_tbs(part_bc.str())) {
+                    // TB cache lookups of this worker, for the parent's statistics
+                    uint64_t worker_hits, worker_misses;
+                    tcg_llvm_ctx->crete_get_tb_cache_stats(worker_hits, worker_misses);
+
+                    ofstream stats_ofs(part_stats.str().c_str());
+                    stats_ofs << worker_hits - hits << ' ' << worker_misses - misses << endl;
+
+                    ret = 0;
+                }
+            }
+            catch(...)
+            {
+                cerr << boost::current_exception_diagnostic_information() << endl;
+            }
+
+            _exit(ret);
+        }
+
+        workers[k] = pid;
+    }
+
+    for(uint64_t k = 0; k < jobs; ++k) {
+        stringstream part_bc, part_tbir, part_stats;
+        part_bc << "dump_tcg_llvm_offline.part." << k << ".bc";
+        part_tbir << tbir_file_name << ".part." << k;
+        part_stats << "dump_tcg_llvm_offline.part." << k << ".stats";
+
+        int status = -1;
+        bool done = workers[k] > 0 &&
+                waitpid(workers[k], &status, 0) == workers[k] &&
+                WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+        tcg_llvm_ctx->crete_set_tb_count(base_tb_count + range_begins[k]);
+
+        if(done) {
+            tcg_llvm_ctx->crete_link_tbs(part_bc.str());
+
+            ifstream part_ifs(part_tbir.str().c_str());
+            ofstream tbir_ofs(tbir_file_name, ios_base::app);
+            tbir_ofs << part_ifs.rdbuf();
+
+            uint64_t hits, misses;
+            ifstream stats_ifs(part_stats.str().c_str());
+            if(stats_ifs >> hits >> misses)
+                tcg_llvm_ctx->crete_add_tb_cache_stats(hits, misses);
+        } else {
+            cerr << "[CRETE Warning] translation worker " << k
+                    << " failed, translating its tbs serially.\n";
+
+            for(uint64_t i = range_begins[k]; i < range_begins[k+1]; ++i)
+                crete_translate_tb(offline_ctx, i, tbir_file_name);
+        }
+
+        fs::remove(part_bc.str());
+        fs::remove(part_tbir.str());
+        fs::remove(part_stats.str());
+    }
+
+    tcg_llvm_ctx->crete_set_tb_count(base_tb_count + tb_num);
+}
+
+// Wait until chunk chunk_index of a streamed trace is completely written by
+// QEMU. Returns false if the trace is complete without it.
+// Blocks on crete_stream_signal between checks. A notification only means
+// "check again": the sections of the container are the ground truth.
+static bool crete_wait_for_chunk(crete::TraceContainer& trace, uint64_t chunk_index)
+{
+    static int signal_fd = -1;
+    if(signal_fd < 0) {
+        // Read-write, so that open() doesn't block
+        signal_fd = open(crete_stream_signal.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if(signal_fd < 0)
+            throw std::runtime_error("failed to open stream signal: " + crete_stream_signal);
+    }
+
+    stringstream chunk_ready;
+    chunk_ready << "dump_chunk_ready." << chunk_index;
+
+    time_t deadline = time(NULL) + CRETE_STREAM_TIMEOUT;
+
+    for(;;) {
+        trace.refresh();
+
+        if(trace.contains(chunk_ready.str()))
+            return true;
+
+        // The last chunk is marked ready before the trace is marked complete
+        if(trace.contains("dump_trace_complete"))
+            return trace.contains(chunk_ready.str());
+
+        time_t now = time(NULL);
+        if(now >= deadline)
+            throw std::runtime_error("timeout on waiting for " + chunk_ready.str());
+
+        struct pollfd pfd;
+        pfd.fd = signal_fd;
+        pfd.events = POLLIN;
+
+        if(poll(&pfd, 1, (deadline - now) * 1000) < 0 && errno != EINTR)
+            throw std::runtime_error("failed to wait on stream signal: " + crete_stream_signal);
+
+        char buf[64];
+        while(read(signal_fd, buf, sizeof(buf)) > 0)
+            ;
+    }
+}
+
+// Translate the trace stored in the current directory into dump_llvm_offline.bc
+static void crete_translate_trace()
+{
+    namespace fs = boost::filesystem;
+
+    // Sections are read in place from the mapped container
+    crete::TraceContainer trace(crete::CRETE_TRACE_CONTAINER_NAME);
 
     stringstream ss;
     uint64_t streamed_count = 0;
     for(;;) {
         ss.str(string());
         ss << "dump_tcg_llvm_offline." << streamed_count++ << ".bin";
-        if(!fs::exists(ss.str())){
+        if(crete_stream_trace && !crete_wait_for_chunk(trace, streamed_count - 1)){
+            cerr << "streamed trace is complete\n";
+            break;
+        }
+
+        if(!trace.contains(ss.str())){
             cerr << ss.str() << " not found\n";
             break;
         }
@@ -301,9 +647,13 @@ void x86_llvm_translator()
         //2. initialize tcg_llvm_ctx_offline
         TCGLLVMOfflineContext temp_tcg_llvm_offline_ctx;
 
-        ifstream ifs(ss.str().c_str());
-        boost::archive::binary_iarchive ia(ifs);
-        ia >> temp_tcg_llvm_offline_ctx;
+        {
+            pair<const char*, uint64_t> tcg_ctx = trace.section(ss.str());
+            crete::TraceSectionBuf buf(tcg_ctx.first, tcg_ctx.second);
+            istream is(&buf);
+            boost::archive::binary_iarchive ia(is);
+            ia >> temp_tcg_llvm_offline_ctx;
+        }
         temp_tcg_llvm_offline_ctx.dump_verify();
 
 #if defined(CRETE_DEBUG)
@@ -318,94 +668,193 @@ void x86_llvm_translator()
         tcg_llvm_ctx->crete_add_tbExecSequ(temp_tcg_llvm_offline_ctx.get_tbExecSequ());
 
         //3. Translate
-        TranslationBlock temp_tb = {};
-        TCGContext *s = &tcg_ctx;
-
-        for(uint64_t i = 0; i < temp_tcg_llvm_offline_ctx.get_size(); ++i) {
-            //3.1 update temp_tb
-            temp_tb.pc = (target_long)temp_tcg_llvm_offline_ctx.get_tlo_tb_pc(i);
-
-            //3.2 update tcg_ctx
-            const TCGContext temp_tcg_ctx = temp_tcg_llvm_offline_ctx.get_tcg_ctx(i);
-            memcpy((void *)s, (void *)&temp_tcg_ctx, sizeof(TCGContext));
-
-            //3.3 update gen_opc_buf and gen_opparam_buf
-
-            for(uint64_t j = 0; j < OPC_BUF_SIZE; ++j) {
-                gen_opc_buf[j] = (uint16_t)temp_tcg_ctx.gen_op_buf[j].opc;
-            }
-
-            for(uint64_t j = 0; j < OPPARAM_BUF_SIZE; ++j) {
-                gen_opparam_buf[j] = (TCGArg)temp_tcg_ctx.gen_opparam_buf[j];
-            }
-
-            // 3.4 update tcg-temp
-            const vector<TCGTemp> temp_tcg_temp = temp_tcg_llvm_offline_ctx.get_tcg_temp(i);
-            assert( temp_tcg_temp.size() == s->nb_temps);
-            for(uint64_t j = 0; j < s->nb_temps; ++j)
-                s->temps[j].assign(temp_tcg_temp[j]);
-
-            // generate offline-tbir.txt
-            uint64_t tb_inst_count = temp_tcg_llvm_offline_ctx.get_tlo_tb_inst_count(i);
-
-            static unsigned long long  tbir_count = 0;
-            char file_name[] = "offline-tbir.txt";
-            FILE *f = fopen(file_name, "a");
-            assert(f);
-
-            fprintf(f, "qemu-ir-tb-%llu-%llu: tb_inst_count = %llu\n",
-                    tbir_count++, temp_tb.pc, tb_inst_count);
-            tcg_dump_ops_file(s, f);
-            fprintf(f, "\n");
-
-            fclose(f);
-
-            //3.5 generate llvm bitcode
-
-            cerr << "tcg_llvm_ctx->generateCode(s, &temp_tb) will be invoked." << endl;
-            temp_tb.tcg_llvm_context = NULL;
-            temp_tb.llvm_function = NULL;
-
-            tcg_llvm_ctx->generateCode(s, &temp_tb);
-
-            cerr<< "tcg_llvm_ctx->generateCode(s, &temp_tb) is done." << endl;
-
-            assert(temp_tb.tcg_llvm_context != NULL);
-            assert(temp_tb.llvm_function != NULL);
-        }
+        crete_translate_tbs_parallel(temp_tcg_llvm_offline_ctx);
 
         {
             //process crete_CPUStateSynctable();
             ss.str(string());
             ss << "dump_sync_cpu_states." << streamed_count-1 << ".bin";
-            tcg_llvm_ctx->generate_llvm_cpuStateSyncTables(ss.str());
+            pair<const char*, uint64_t> tables = trace.section(ss.str());
+            tcg_llvm_ctx->generate_llvm_cpuStateSyncTables(tables.first, tables.second);
         }
 
         {
             //process dump_new_sync_memos();
             ss.str(string());
             ss << "dump_new_sync_memos." << streamed_count-1 << ".bin";
-            tcg_llvm_ctx->generate_llvm_MemorySyncTables(ss.str());
+            pair<const char*, uint64_t> tables = trace.section(ss.str());
+            tcg_llvm_ctx->generate_llvm_MemorySyncTables(tables.first, tables.second);
         }
     }
 
     //4. generate main function
-    tcg_llvm_ctx->generate_crete_main();
+    pair<const char*, uint64_t> initial_cpuState = trace.section("dump_initial_cpuState.bin");
+    tcg_llvm_ctx->generate_crete_main(initial_cpuState.first, initial_cpuState.second);
 
     //5. Write out the translated llvm bitcode to file in the current folder
     fs::path bitcode_path = fs::current_path() / "dump_llvm_offline.bc";
     tcg_llvm_ctx->writeBitCodeToFile(bitcode_path.string());
 
+    tcg_llvm_ctx->crete_print_tb_cache_stats();
+    tcg_llvm_ctx->crete_trim_tb_cache();
     cerr << "offline translator is done.\n" << endl;
     //6. cleanup
     //    delete tcg_llvm_offline_ctx;
 }
 
+void x86_llvm_translator()
+{
+    crete_init_translator();
+    crete_translate_trace();
+}
+
+static std::string crete_read_request_line(int conn)
+{
+    std::string line;
+    char c;
+    while(read(conn, &c, 1) == 1 && c != '\n') {
+        line.push_back(c);
+    }
+
+    return line;
+}
+
+// Serve one request of the translator daemon in a forked child, which owns a
+// copy-on-write clone of the pre-linked module. A request is the absolute path
+// of a trace directory terminated by '\n', optionally preceded by the line
+// "--stream <stream signal>\n".
+// The reply starts with the pid of this child, "<pid>\n", which the client
+// kills to cancel the request. Then comes "0\n" on success, or "1\n" followed
+// by the error diagnostic. The translator output goes to translator.log in the
+// trace directory.
+static void crete_serve_translation(int conn)
+{
+    // The translation waits for its own workers
+    signal(SIGCHLD, SIG_DFL);
+
+    std::string trace_dir = crete_read_request_line(conn);
+
+    const std::string stream_prefix = "--stream ";
+    if(trace_dir.compare(0, stream_prefix.size(), stream_prefix) == 0) {
+        crete_stream_trace = true;
+        crete_stream_signal = trace_dir.substr(stream_prefix.size());
+        trace_dir = crete_read_request_line(conn);
+    }
+
+    stringstream pid_line;
+    pid_line << getpid() << '\n';
+    if(write(conn, pid_line.str().data(), pid_line.str().size()) != (ssize_t)pid_line.str().size()) {
+        return;
+    }
+
+    std::string reply;
+    try {
+        if(trace_dir.empty() || chdir(trace_dir.c_str()) != 0) {
+            throw std::runtime_error("failed to enter trace directory: " + trace_dir);
+        }
+
+        // Keep the diagnostics of this translation with its trace, as the log
+        // of a translator launched per trace would
+        int log_fd = open(crete_daemon_log_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(log_fd < 0) {
+            throw std::runtime_error("failed to create " + std::string(crete_daemon_log_name) +
+                    " in trace directory: " + trace_dir);
+        }
+
+        dup2(log_fd, STDOUT_FILENO);
+        dup2(log_fd, STDERR_FILENO);
+        close(log_fd);
+        // Not lost on an abort, e.g., of a failed assertion
+        setvbuf(stdout, NULL, _IOLBF, 0);
+
+        crete_translate_trace();
+        reply = "0\n";
+    }
+    catch(...)
+    {
+        reply = "1\n" + boost::current_exception_diagnostic_information();
+    }
+
+    for(size_t written = 0; written < reply.size();) {
+        ssize_t ret = write(conn, reply.data() + written, reply.size() - written);
+        if(ret <= 0) {
+            break;
+        }
+
+        written += ret;
+    }
+}
+
+// Keep the linked helper module in memory and translate traces on request,
+// sent through the unix socket at socket_path. Every request is served by its
+// own forked child, so that translations run concurrently.
+static void crete_run_daemon(const std::string& socket_path)
+{
+    // The daemon belongs to the node that launched it
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    // Let the kernel reap the translation children
+    signal(SIGCHLD, SIG_IGN);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if(socket_path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("socket path is too long: " + socket_path);
+    }
+    strcpy(addr.sun_path, socket_path.c_str());
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listen_fd < 0) {
+        throw std::runtime_error("failed to create daemon socket");
+    }
+
+    unlink(socket_path.c_str());
+    if(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            listen(listen_fd, SOMAXCONN) != 0) {
+        throw std::runtime_error("failed to listen on daemon socket: " + socket_path);
+    }
+
+    cerr << "translator daemon is listening on " << socket_path << endl;
+
+    for(;;) {
+        int conn = accept(listen_fd, NULL, NULL);
+        if(conn < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            throw std::runtime_error("failed to accept translation request");
+        }
+
+        pid_t pid = fork();
+        if(pid == 0) {
+            close(listen_fd);
+            crete_serve_translation(conn);
+            close(conn);
+            _exit(0);
+        }
+
+        close(conn);
+
+        if(pid < 0) {
+            throw std::runtime_error("failed to fork translation child");
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     crete_set_data_dir(argv[0]);
 
     try {
-        x86_llvm_translator();
+        crete_parse_args(argc, argv);
+
+        if(crete_daemon_socket.empty()) {
+            x86_llvm_translator();
+        } else {
+            crete_init_translator();
+            crete_run_daemon(crete_daemon_socket);
+        }
     }
     catch(...)
     {
@@ -26,18 +26,53 @@ const char * get_helper_name(uint64_t func_addr);
 #include <boost/serialization/split_member.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/version.hpp>
 
 using namespace std;
 
 struct TCGContext;
 struct TCGTemp;
+
+// The parts of a TCGContext used by the offline translation of a TB: the live
+// range of its op and param buffers. Its temps are stored separately.
+struct CompactTCGContext
+{
+    int32_t nb_globals;
+    int32_t nb_temps;
+    int32_t nb_labels;
+
+    int32_t gen_first_op_idx;
+    int32_t gen_last_op_idx;
+    int32_t gen_next_op_idx;
+    int32_t gen_next_parm_idx;
+
+    vector<uint64_t> ops;    // raw TCGOp of gen_op_buf[0, gen_next_op_idx)
+    vector<uint64_t> params; // gen_opparam_buf[0, gen_next_parm_idx)
+
+    template <class Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        ar & nb_globals;
+        ar & nb_temps;
+        ar & nb_labels;
+
+        ar & gen_first_op_idx;
+        ar & gen_last_op_idx;
+        ar & gen_next_op_idx;
+        ar & gen_next_parm_idx;
+
+        ar & ops;
+        ar & params;
+    }
+};
+
 class TCGLLVMOfflineContext
 {
 private:
     // Required information from QEMU for the offline translation
     vector<uint64_t> m_tlo_tb_pc;
 
-    vector<TCGContext> m_tcg_ctx;
+    vector<CompactTCGContext> m_tcg_ctx;
     vector<vector<TCGTemp> > m_tcg_temps;
     map<uint64_t, string> m_helper_names;
 
@@ -51,12 +86,26 @@ public:
     TCGLLVMOfflineContext() {};
     ~TCGLLVMOfflineContext() {};
 
+    // version 0: a full TCGContext per captured TB
+    // version 1: a CompactTCGContext per captured TB
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version)
     {
         ar & m_tlo_tb_pc;
 
-        ar & m_tcg_ctx;
+        if(version == 0) {
+            // Only reached when loading, as the latest version is always saved
+            vector<TCGContext> full_tcg_ctx;
+            ar & full_tcg_ctx;
+
+            m_tcg_ctx.clear();
+            for(vector<TCGContext>::const_iterator it = full_tcg_ctx.begin();
+                    it != full_tcg_ctx.end(); ++it) {
+                dump_tcg_ctx(*it);
+            }
+        } else {
+            ar & m_tcg_ctx;
+        }
         ar & m_tcg_temps;
         ar & m_helper_names;
 
@@ -66,10 +115,11 @@ public:
         ar & m_cpuState_size;
     }
 
+    void dump_tcg_ctx(const TCGContext& tcg_ctx);
+
 #if !defined(TCG_LLVM_OFFLINE)
     void dump_tlo_tb_pc(const uint64_t pc);
 
-    void dump_tcg_ctx(const TCGContext& tcg_ctx);
     void dump_tcg_temp(const vector<TCGTemp>& tcg_temp);
     void dump_tcg_helper_name(const TCGContext &tcg_ctx);
 
@@ -81,7 +131,7 @@ public:
 
     uint64_t get_tlo_tb_pc(const uint64_t tb_index) const;
 
-    const TCGContext& get_tcg_ctx(const uint64_t tb_index) const;
+    void load_tcg_ctx(const uint64_t tb_index, TCGContext& tcg_ctx) const;
     const vector<TCGTemp>& get_tcg_temp(const uint64_t tb_index) const;
     const map<uint64_t, string> get_helper_names() const;
 
@@ -95,6 +145,8 @@ public:
     uint64_t get_size();
 };
 
+BOOST_CLASS_VERSION(TCGLLVMOfflineContext, 1)
+
 #endif // #ifdef __cplusplus
 
 #endif //#ifndef TCG_LLVM_OFFLINE_H
@@ -71,6 +71,8 @@ extern "C" {
 #include <llvm/Bitcode/ReaderWriter.h>
 #include "llvm/Linker.h"
 #include "llvm/Support/Path.h"
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
 
 #include "tcg-llvm-offline/tcg-llvm-offline.h"
 
@@ -79,9 +81,16 @@ extern "C" {
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/exception/all.hpp>
+#include <boost/filesystem.hpp>
+#include <crete/trace_container.h>
+#include <crete/memo_sync.h>
 #include <exception>
 
 #include <fstream>
+#include <set>
+#include <algorithm>
+#include <ctime>
+#include <unistd.h>
 #endif // #if defined(TCG_LLVM_OFFLINE)
 
 #include <iostream>
@@ -126,7 +135,66 @@ struct CPUStateElement{
 
 typedef pair<bool, vector<CPUStateElement> > cpuStateSyncTable_ty;
 
-typedef vector<pair<uint64_t, uint8_t> > memoSyncTable_ty;
+// <runs of synced memory as <address, size>, values of all runs concatenated>
+typedef pair<vector<pair<uint64_t, uint64_t> >, string> memoSyncTable_ty;
+
+#if defined(TCG_LLVM_OFFLINE)
+// Bump whenever generateCode() changes the IR it emits for a given TB, so
+// that stale entries of the TB cache are not linked in anymore.
+#define CRETE_TB_CACHE_VERSION 2
+
+// Name of the TB function within a stand-alone cache module
+static const char *tb_cache_function_name = "tcg-llvm-tb-cached";
+
+// Values returned by the exit_tb ops of a TB, canonical value -> host value.
+// See canonical_exit_value().
+typedef map<uint64_t, uint64_t> TBExitValues;
+
+// 128-bit FNV-1a, used to content-address the TB cache
+class TBCacheHasher
+{
+private:
+    unsigned __int128 m_hash;
+
+public:
+    TBCacheHasher()
+    : m_hash(((unsigned __int128)0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL) {}
+
+    void add(const void *data, uint64_t size)
+    {
+        const unsigned __int128 prime = ((unsigned __int128)1 << 88) | 0x13b;
+        const uint8_t *bytes = (const uint8_t *)data;
+
+        for(uint64_t i = 0; i < size; ++i) {
+            m_hash ^= bytes[i];
+            m_hash *= prime;
+        }
+    }
+
+    void add(uint64_t value)
+    {
+        add(&value, sizeof(value));
+    }
+
+    void add(const string& str)
+    {
+        add((uint64_t)str.size());
+        add(str.data(), str.size());
+    }
+
+    string get_key() const
+    {
+        std::ostringstream key;
+        key << std::hex;
+        key.width(16); key.fill('0');
+        key << (uint64_t)(m_hash >> 64);
+        key.width(16); key.fill('0');
+        key << (uint64_t)m_hash;
+
+        return key.str();
+    }
+};
+#endif // #if defined(TCG_LLVM_OFFLINE)
 
 struct TCGLLVMContextPrivate {
     LLVMContext& m_context;
@@ -261,17 +329,53 @@ public:
     void crete_set_cpuState_size(uint64_t cpuState_size);
     void crete_add_tbExecSequ(vector<pair<uint64_t, uint64_t> > seq);
 
-    void generate_crete_main();
-    GlobalVariable* generate_crete_init_cpuState();
-    void generate_crete_tb_prologue(uint64_t tb_count, uint64_t tb_pc, GlobalVariable *crete_cpu_state);
+    void generate_crete_main(const char *initial_cpuState, uint64_t size);
+    GlobalVariable* generate_crete_init_cpuState(const char *initial_cpuState, uint64_t size);
+    Function* get_crete_replay_function(const string& name, const vector<llvm::Type*>& argTypes);
+    GlobalVariable* generate_crete_sync_index(const vector<pair<uint64_t, GlobalVariable *> >& sync_globals,
+            Function *sync_func, unsigned step_field, vector<uint32_t>& steps, const string& name);
+    void generate_crete_sync_call(GlobalVariable *sync_index, Function *sync_func, Value *step_base,
+            unsigned step_field, GlobalVariable *steps, vector<Value*> argValues, const string& name);
 
-    void crete_generate_llvm_cpuStateSyncTables(const string& input_file_name);
+    void crete_generate_llvm_cpuStateSyncTables(const char *data, uint64_t size);
     void crete_generate_llvm_cpuStateSyncTable(const cpuStateSyncTable_ty& csst);
 
-    void generate_llvm_MemorySyncTables(const string& input_file_name);
+    void generate_llvm_MemorySyncTables(const char *data, uint64_t size);
     void generate_llvm_MemorySyncTable(const memoSyncTable_ty& memost);
 
+    void crete_set_tb_cache_dir(const string& cache_dir, uint64_t max_size);
+    void crete_print_tb_cache_stats() const;
+    string compute_tb_cache_key(TCGContext *s, TranslationBlock *tb,
+            TBExitValues& exit_values) const;
+    Function* load_cached_tb(const string& key, const string& func_name,
+            const TBExitValues& exit_values);
+    void store_cached_tb(const string& key, Function *tb_func,
+            const TBExitValues& exit_values);
+    void crete_trim_tb_cache() const;
+#if defined(USE_LLVM_3_4)
+    Module* clone_into_module(const vector<pair<Function *, string> >& funcs,
+            const string& module_name);
+#endif
+
+    void crete_get_tb_cache_stats(uint64_t& hits, uint64_t& misses) const;
+    void crete_add_tb_cache_stats(uint64_t hits, uint64_t misses);
+    void crete_set_tb_count(int tb_count);
+    void crete_externalize_local_globals();
+    bool crete_write_generated_tbs(const string& file_name);
+    void crete_link_tbs(const string& file_name);
+
 private:
+    // Directory of the persistent TB cache, shared by all translator runs
+    // of a VM node. Empty if the cache is disabled.
+    string m_tbCacheDir;
+    // Bytes of cache entries kept by crete_trim_tb_cache()
+    uint64_t m_tbCacheMaxSize;
+    uint64_t m_tbCacheHits;
+    uint64_t m_tbCacheMisses;
+
+    // TB functions generated since the last crete_set_tb_count()
+    vector<Function *> m_generatedTBs;
+
     map<uint64_t, string> m_crete_helper_names;
 
     // Execution sequence of cpatured TB: <pc, unique-tb-number>
@@ -284,7 +388,8 @@ private:
 
 TCGLLVMContextPrivate::TCGLLVMContextPrivate()
     : m_context(getGlobalContext()), m_builder(m_context), m_tbCount(0),
-      m_tcgContext(NULL), m_tbFunction(NULL)
+      m_tcgContext(NULL), m_tbFunction(NULL),
+      m_tbCacheMaxSize(0), m_tbCacheHits(0), m_tbCacheMisses(0)
 {
     std::memset(m_values, 0, sizeof(m_values));
     std::memset(m_memValuesPtr, 0, sizeof(m_memValuesPtr));
@@ -1342,10 +1447,31 @@ int TCGLLVMContextPrivate::generateOperation(TCGOp* op, int opc, const TCGArg *a
 void TCGLLVMContextPrivate::generateCode(TCGContext *s, TranslationBlock *tb)
 {
     /* Create new function for current translation block */
-    /* TODO: compute the checksum of the tb to see if we can reuse some code */
     std::ostringstream fName;
     fName << "tcg-llvm-tb-" << (m_tbCount++) << "-" << std::hex << tb->pc;
 
+#if defined(TCG_LLVM_OFFLINE)
+    /* Reuse the code generated for an identical tb by a previous run */
+    string cache_key;
+    TBExitValues exit_values;
+    if(!m_tbCacheDir.empty()) {
+        cache_key = compute_tb_cache_key(s, tb, exit_values);
+
+        Function *cached_func = load_cached_tb(cache_key, fName.str(), exit_values);
+        if(cached_func) {
+            ++m_tbCacheHits;
+
+            tb->llvm_function = cached_func;
+            tb->llvm_tc_ptr = 0;
+            tb->llvm_tc_end = 0;
+            m_generatedTBs.push_back(cached_func);
+            return;
+        }
+
+        ++m_tbCacheMisses;
+    }
+#endif // #if defined(TCG_LLVM_OFFLINE)
+
 
 #if defined(CRETE_DEBUG)
     std::cerr << " generateCode: " << fName.str()<<'\n';
@@ -1447,6 +1573,13 @@ void TCGLLVMContextPrivate::generateCode(TCGContext *s, TranslationBlock *tb)
     tb->llvm_tc_ptr = 0;
     tb->llvm_tc_end = 0;
 
+#if defined(TCG_LLVM_OFFLINE)
+    if(!cache_key.empty())
+        store_cached_tb(cache_key, m_tbFunction, exit_values);
+
+    m_generatedTBs.push_back(m_tbFunction);
+#endif // #if defined(TCG_LLVM_OFFLINE)
+
 #ifdef DEBUG_DISAS
     if (unlikely(qemu_loglevel_mask(CPU_LOG_TB_OP))) {
         qemu_log("OP:\n");
@@ -1490,9 +1623,561 @@ void TCGLLVMContextPrivate::crete_add_tbExecSequ(vector<pair<uint64_t, uint64_t>
     m_tbExecSequ.insert(m_tbExecSequ.end(), seq.begin(), seq.end());
 }
 
+void TCGLLVMContextPrivate::crete_set_tb_cache_dir(const string& cache_dir, uint64_t max_size)
+{
+#if defined(USE_LLVM_3_4)
+    namespace fs = boost::filesystem;
+
+    if(!fs::exists(cache_dir)) {
+        fs::create_directories(cache_dir);
+    }
+
+    m_tbCacheDir = cache_dir;
+    m_tbCacheMaxSize = max_size;
+#else
+    std::cerr << "[CRETE Warning] tb cache requires llvm-3.4, it is disabled.\n";
+#endif
+}
+
+void TCGLLVMContextPrivate::crete_get_tb_cache_stats(uint64_t& hits, uint64_t& misses) const
+{
+    hits = m_tbCacheHits;
+    misses = m_tbCacheMisses;
+}
+
+// Account for the lookups of a forked translation worker
+void TCGLLVMContextPrivate::crete_add_tb_cache_stats(uint64_t hits, uint64_t misses)
+{
+    m_tbCacheHits += hits;
+    m_tbCacheMisses += misses;
+}
+
+void TCGLLVMContextPrivate::crete_print_tb_cache_stats() const
+{
+    if(m_tbCacheDir.empty())
+        return;
+
+    std::cerr << "tb cache (" << m_tbCacheDir << "): "
+            << std::dec << m_tbCacheHits << " hits, "
+            << m_tbCacheMisses << " misses" << std::endl;
+}
+
+// Index of the label argument of a TCG op, -1 if the op has no label
+static int tcg_label_arg_index(int opc)
+{
+    switch(opc) {
+    case INDEX_op_br:
+    case INDEX_op_set_label:
+        return 0;
+    case INDEX_op_brcond_i32:
+#if TCG_TARGET_REG_BITS == 64
+    case INDEX_op_brcond_i64:
+#endif
+        return 3;
+#if TCG_TARGET_REG_BITS == 32
+    case INDEX_op_brcond2_i32:
+        return 5;
+#endif
+    default:
+        return -1;
+    }
+}
+
+// The argument of exit_tb is the host address of the TranslationBlock to chain
+// from, with the exit index in its low 2 bits. The address is replaced by its
+// ordinal within the TB (starting at 1, as 0 means no chaining), keeping the
+// exit index.
+static uint64_t canonical_exit_value(uint64_t value, map<uint64_t, uint64_t>& tb_ordinals)
+{
+    const uint64_t tb_addr = value & ~(uint64_t)3;
+    if(tb_addr == 0)
+        return value;
+
+    map<uint64_t, uint64_t>::iterator it = tb_ordinals.find(tb_addr);
+    if(it == tb_ordinals.end()) {
+        it = tb_ordinals.insert(make_pair(tb_addr,
+                (uint64_t)tb_ordinals.size() + 1)).first;
+    }
+
+    return (it->second << 2) | (value & 3);
+}
+
+// The key covers everything generateCode() consumes: pc, the live range of
+// the op/param buffers and the temps. Host pointers captured from QEMU (labels,
+// helper addresses and the TBs of exit_tb) are replaced by their label ordinal,
+// helper name and canonical exit value, so that the key is stable across
+// different QEMU processes. The canonical exit values are mapped to the host
+// values of this TB in exit_values.
+string TCGLLVMContextPrivate::compute_tb_cache_key(TCGContext *s, TranslationBlock *tb,
+        TBExitValues& exit_values) const
+{
+    TBCacheHasher hasher;
+
+    hasher.add((uint64_t)CRETE_TB_CACHE_VERSION);
+    hasher.add((uint64_t)tb->pc);
+
+    hasher.add((uint64_t)s->nb_globals);
+    hasher.add((uint64_t)s->nb_temps);
+    for(int i = 0; i < s->nb_temps; ++i) {
+        const TCGTemp &temp = s->temps[i];
+
+        hasher.add((uint64_t)temp.base_type);
+        hasher.add((uint64_t)temp.type);
+        hasher.add((uint64_t)temp.reg);
+        hasher.add((uint64_t)temp.mem_reg);
+        hasher.add((uint64_t)temp.mem_offset);
+        hasher.add((uint64_t)temp.fixed_reg);
+        hasher.add((uint64_t)temp.temp_local);
+        hasher.add(temp.name ? string(temp.name) : string());
+    }
+
+    map<uint64_t, uint64_t> label_ordinals;
+    map<uint64_t, uint64_t> tb_ordinals;
+    const TCGOp *op;
+    for (int oi = s->gen_first_op_idx, opc_index = 0; oi >= 0; oi = op->next, ++opc_index)
+    {
+        op = &s->gen_op_buf[oi];
+
+        int opc = gen_opc_buf[opc_index];
+        hasher.add((uint64_t)opc);
+
+        if(opc == INDEX_op_end)
+            break;
+
+        const TCGArg *args = &gen_opparam_buf[op->args];
+
+        if(opc == INDEX_op_call) {
+            int nb_oargs = op->callo;
+            int nb_iargs = op->calli;
+
+            hasher.add((uint64_t)nb_oargs);
+            hasher.add((uint64_t)nb_iargs);
+            for(int i = 0; i < nb_oargs + nb_iargs; ++i)
+                hasher.add((uint64_t)args[i]);
+
+            hasher.add(get_crete_helper_name((uint64_t)args[nb_oargs + nb_iargs]));
+            hasher.add((uint64_t)args[nb_oargs + nb_iargs + 1]);
+            continue;
+        }
+
+        if(opc == INDEX_op_exit_tb) {
+            uint64_t exit_value = canonical_exit_value(args[0], tb_ordinals);
+
+            exit_values[exit_value] = args[0];
+            hasher.add(exit_value);
+            continue;
+        }
+
+        int nb_args = (opc == INDEX_op_nopn) ? 1 : tcg_op_defs[opc].nb_args;
+        int label_idx = tcg_label_arg_index(opc);
+
+        for(int i = 0; i < nb_args; ++i) {
+            if(i == label_idx) {
+                map<uint64_t, uint64_t>::iterator it = label_ordinals.find(args[i]);
+                if(it == label_ordinals.end()) {
+                    it = label_ordinals.insert(make_pair((uint64_t)args[i],
+                            (uint64_t)label_ordinals.size())).first;
+                }
+
+                hasher.add(it->second);
+            } else {
+                hasher.add((uint64_t)args[i]);
+            }
+        }
+    }
+
+    return hasher.get_key();
+}
+
+#if defined(USE_LLVM_3_4)
+// Replace the constants returned by func (i.e., by its exit_tb ops) as mapped
+static void remap_tb_exit_values(Function *func, const map<uint64_t, uint64_t>& mapping)
+{
+    for(Function::iterator bb = func->begin(); bb != func->end(); ++bb) {
+        ReturnInst *ret = dyn_cast<ReturnInst>(bb->getTerminator());
+        if(!ret || !ret->getReturnValue())
+            continue;
+
+        ConstantInt *value = dyn_cast<ConstantInt>(ret->getReturnValue());
+        if(!value)
+            continue;
+
+        map<uint64_t, uint64_t>::const_iterator it = mapping.find(value->getZExtValue());
+        if(it != mapping.end())
+            ret->setOperand(0, ConstantInt::get(value->getType(), it->second));
+    }
+}
+#endif
+
+Function* TCGLLVMContextPrivate::load_cached_tb(const string& key, const string& func_name,
+        const TBExitValues& exit_values)
+{
+#if defined(USE_LLVM_3_4)
+    namespace fs = boost::filesystem;
+
+    fs::path cache_file = fs::path(m_tbCacheDir) / (key + ".bc");
+    if(!fs::exists(cache_file))
+        return NULL;
+
+    // Recently used, for crete_trim_tb_cache()
+    boost::system::error_code ec;
+    fs::last_write_time(cache_file, std::time(NULL), ec);
+
+    OwningPtr<MemoryBuffer> buffer;
+    if(MemoryBuffer::getFile(cache_file.string(), buffer))
+        return NULL;
+
+    std::string error;
+    Module *cached = ParseBitcodeFile(buffer.get(), m_context, &error);
+    if(!cached) {
+        std::cerr << "[CRETE Warning] ignoring corrupted tb cache entry "
+                << cache_file.string() << ": " << error << std::endl;
+        return NULL;
+    }
+
+    Function *cached_func = cached->getFunction(tb_cache_function_name);
+    if(!cached_func || cached_func->isDeclaration()) {
+        delete cached;
+        return NULL;
+    }
+
+    cached_func->setName(func_name);
+
+    if(Linker::LinkModules(m_module, cached, Linker::DestroySource, &error)) {
+        delete cached;
+        BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] failed to link tb cache entry "
+                + cache_file.string() + ": " + error));
+    }
+
+    delete cached;
+
+    // Cached with the canonical exit values
+    Function *func = m_module->getFunction(func_name);
+    remap_tb_exit_values(func, exit_values);
+
+    return func;
+#else
+    return NULL;
+#endif
+}
+
+// Collect the globals referenced by v, including those nested in constant expressions
+static void collect_referenced_globals(Value *v, std::set<GlobalValue *>& globals)
+{
+    if(GlobalValue *gv = dyn_cast<GlobalValue>(v)) {
+        globals.insert(gv);
+    } else if(Constant *c = dyn_cast<Constant>(v)) {
+        for(User::op_iterator it = c->op_begin(); it != c->op_end(); ++it)
+            collect_referenced_globals(*it, globals);
+    }
+}
+
+#if defined(USE_LLVM_3_4)
+static bool is_local_constant(const GlobalValue *gv)
+{
+    const GlobalVariable *var = dyn_cast<GlobalVariable>(gv);
+
+    return var && var->hasLocalLinkage() && var->isConstant() && var->hasInitializer();
+}
+
+// Clone funcs into a new module, each under the name paired with it. Local
+// constants they reference (e.g., strings) are copied along. Every other
+// global they reference becomes an external declaration, which gets resolved
+// by the linker when the module is linked back. Returns NULL if a referenced
+// global can't be resolved by name.
+Module* TCGLLVMContextPrivate::clone_into_module(const vector<pair<Function *, string> >& funcs,
+        const string& module_name)
+{
+    std::set<GlobalValue *> globals;
+    for(vector<pair<Function *, string> >::const_iterator f = funcs.begin();
+            f != funcs.end(); ++f)
+        for(Function::iterator bb = f->first->begin(); bb != f->first->end(); ++bb)
+            for(BasicBlock::iterator inst = bb->begin(); inst != bb->end(); ++inst)
+                for(User::op_iterator op = inst->op_begin(); op != inst->op_end(); ++op)
+                    collect_referenced_globals(*op, globals);
+
+    // The initializers of copied constants may reference further globals
+    vector<GlobalValue *> worklist(globals.begin(), globals.end());
+    while(!worklist.empty()) {
+        GlobalValue *gv = worklist.back();
+        worklist.pop_back();
+
+        if(!is_local_constant(gv))
+            continue;
+
+        std::set<GlobalValue *> referenced;
+        collect_referenced_globals(cast<GlobalVariable>(gv)->getInitializer(), referenced);
+
+        for(std::set<GlobalValue *>::const_iterator it = referenced.begin();
+                it != referenced.end(); ++it) {
+            if(globals.insert(*it).second)
+                worklist.push_back(*it);
+        }
+    }
+
+    Module *cloned = new Module(module_name, m_context);
+    ValueToValueMapTy vmap;
+    vector<GlobalVariable *> local_constants;
+
+    // Create the cloned functions first, as they may call each other
+    for(vector<pair<Function *, string> >::const_iterator f = funcs.begin();
+            f != funcs.end(); ++f) {
+        vmap[f->first] = Function::Create(f->first->getFunctionType(),
+                GlobalValue::ExternalLinkage, f->second, cloned);
+    }
+
+    for(std::set<GlobalValue *>::const_iterator it = globals.begin();
+            it != globals.end(); ++it) {
+        if(vmap.count(*it))
+            continue;
+
+        if(is_local_constant(*it)) {
+            GlobalVariable *gv = cast<GlobalVariable>(*it);
+            GlobalVariable *copy = new GlobalVariable(*cloned, gv->getType()->getElementType(),
+                    true, gv->getLinkage(), 0, gv->getName());
+            copy->setAlignment(gv->getAlignment());
+            copy->setUnnamedAddr(gv->hasUnnamedAddr());
+
+            vmap[gv] = copy;
+            local_constants.push_back(gv);
+            continue;
+        }
+
+        // Any other local global can't be resolved by name in the module linking the clone
+        if((*it)->hasLocalLinkage() || !(*it)->hasName()) {
+            std::cerr << "[CRETE Warning] can't clone tbs into " << module_name
+                    << ": they reference local global '" << (*it)->getName().str() << "'\n";
+            delete cloned;
+            return NULL;
+        }
+
+        if(Function *f = dyn_cast<Function>(*it)) {
+            vmap[f] = Function::Create(f->getFunctionType(),
+                    GlobalValue::ExternalLinkage, f->getName(), cloned);
+        } else if(GlobalVariable *gv = dyn_cast<GlobalVariable>(*it)) {
+            vmap[gv] = new GlobalVariable(*cloned, gv->getType()->getElementType(),
+                    gv->isConstant(), GlobalValue::ExternalLinkage, 0, gv->getName());
+        } else {
+            std::cerr << "[CRETE Warning] can't clone tbs into " << module_name
+                    << ": they reference global alias '" << (*it)->getName().str() << "'\n";
+            delete cloned;
+            return NULL;
+        }
+    }
+
+    // Once every global is mapped, as initializers may refer to each other
+    for(vector<GlobalVariable *>::const_iterator it = local_constants.begin();
+            it != local_constants.end(); ++it) {
+        cast<GlobalVariable>((Value *)vmap[*it])->setInitializer(
+                MapValue((*it)->getInitializer(), vmap));
+    }
+
+    for(vector<pair<Function *, string> >::const_iterator f = funcs.begin();
+            f != funcs.end(); ++f) {
+        Function *cloned_func = cast<Function>((Value *)vmap[f->first]);
+
+        Function::arg_iterator dst_arg = cloned_func->arg_begin();
+        for(Function::const_arg_iterator src_arg = f->first->arg_begin();
+                src_arg != f->first->arg_end(); ++src_arg, ++dst_arg) {
+            dst_arg->setName(src_arg->getName());
+            vmap[src_arg] = dst_arg;
+        }
+
+        SmallVector<ReturnInst*, 8> returns;
+        CloneFunctionInto(cloned_func, f->first, vmap, true, returns);
+    }
+
+    return cloned;
+}
+
+// Write module m to file_name through a private file and an atomic rename,
+// so that concurrent writers and readers never see a partial file.
+static bool write_module_atomically(Module *m, const string& file_name)
+{
+    std::ostringstream tmp_name;
+    tmp_name << file_name << "." << getpid() << ".tmp";
+
+    {
+        std::string error;
+        llvm::raw_fd_ostream o(tmp_name.str().c_str(), error,
+                llvm::sys::fs::F_Binary);
+        if(!error.empty()) {
+            std::cerr << "[CRETE Warning] failed to write "
+                    << tmp_name.str() << ": " << error << std::endl;
+            return false;
+        }
+
+        llvm::WriteBitcodeToFile(m, o);
+    }
+
+    boost::filesystem::rename(tmp_name.str(), file_name);
+
+    return true;
+}
+#endif // #if defined(USE_LLVM_3_4)
+
+// Write tb_func into a stand-alone module of the TB cache, returning the
+// canonical exit values instead of the host values of this QEMU process
+void TCGLLVMContextPrivate::store_cached_tb(const string& key, Function *tb_func,
+        const TBExitValues& exit_values)
+{
+#if defined(USE_LLVM_3_4)
+    namespace fs = boost::filesystem;
+
+    vector<pair<Function *, string> > funcs;
+    funcs.push_back(make_pair(tb_func, string(tb_cache_function_name)));
+
+    Module *cached = clone_into_module(funcs, key);
+    if(!cached)
+        return;
+
+    map<uint64_t, uint64_t> canonical_values;
+    for(TBExitValues::const_iterator it = exit_values.begin();
+            it != exit_values.end(); ++it)
+        canonical_values[it->second] = it->first;
+
+    remap_tb_exit_values(cached->getFunction(tb_cache_function_name), canonical_values);
+
+    fs::path cache_file = fs::path(m_tbCacheDir) / (key + ".bc");
+    write_module_atomically(cached, cache_file.string());
+
+    delete cached;
+#endif
+}
+
+// Evict the least recently used entries of the TB cache (by mtime, which a
+// hit refreshes) while it holds more than m_tbCacheMaxSize bytes, down to 90%
+// of it. Entries evicted while other translators use the cache are just misses.
+void TCGLLVMContextPrivate::crete_trim_tb_cache() const
+{
+#if defined(USE_LLVM_3_4)
+    namespace fs = boost::filesystem;
+
+    if(m_tbCacheDir.empty() || m_tbCacheMaxSize == 0)
+        return;
+
+    vector<pair<std::time_t, pair<uint64_t, fs::path> > > entries;
+    uint64_t total_size = 0;
+
+    boost::system::error_code ec;
+    for(fs::directory_iterator it(m_tbCacheDir, ec), end; !ec && it != end; it.increment(ec)) {
+        if(it->path().extension() != ".bc")
+            continue;
+
+        boost::system::error_code entry_ec;
+        uint64_t size = fs::file_size(it->path(), entry_ec);
+        std::time_t mtime = fs::last_write_time(it->path(), entry_ec);
+        if(entry_ec)
+            continue;
+
+        entries.push_back(make_pair(mtime, make_pair(size, it->path())));
+        total_size += size;
+    }
+
+    if(total_size <= m_tbCacheMaxSize)
+        return;
+
+    std::sort(entries.begin(), entries.end());
+
+    const uint64_t target_size = m_tbCacheMaxSize / 10 * 9;
+    uint64_t evicted = 0;
+    for(size_t i = 0; i < entries.size() && total_size > target_size; ++i) {
+        fs::remove(entries[i].second.second, ec);
+        total_size -= entries[i].second.first;
+        ++evicted;
+    }
+
+    std::cerr << "tb cache (" << m_tbCacheDir << "): evicted "
+            << std::dec << evicted << " entries" << std::endl;
+#endif
+}
+
+void TCGLLVMContextPrivate::crete_set_tb_count(int tb_count)
+{
+    m_tbCount = tb_count;
+    m_generatedTBs.clear();
+}
+
+// Give the local globals of the module external linkage, so that the TB
+// functions cloned by forked workers (see crete_write_generated_tbs()) can
+// refer to them by name. To be called before forking the workers.
+void TCGLLVMContextPrivate::crete_externalize_local_globals()
+{
+#if defined(USE_LLVM_3_4)
+    vector<GlobalValue *> locals;
+
+    for(Module::global_iterator it = m_module->global_begin();
+            it != m_module->global_end(); ++it) {
+        if(it->hasLocalLinkage())
+            locals.push_back(it);
+    }
+
+    for(Module::iterator it = m_module->begin(); it != m_module->end(); ++it) {
+        if(it->hasLocalLinkage())
+            locals.push_back(it);
+    }
+
+    for(vector<GlobalValue *>::const_iterator it = locals.begin();
+            it != locals.end(); ++it) {
+        if(!(*it)->hasName())
+            (*it)->setName("crete.local");
+
+        (*it)->setLinkage(GlobalValue::ExternalLinkage);
+    }
+#endif
+}
+
+// Write the TB functions generated since the last crete_set_tb_count() into
+// a stand-alone module, to be linked by crete_link_tbs() of another process
+bool TCGLLVMContextPrivate::crete_write_generated_tbs(const string& file_name)
+{
+#if defined(USE_LLVM_3_4)
+    vector<pair<Function *, string> > funcs;
+    for(vector<Function *>::const_iterator it = m_generatedTBs.begin();
+            it != m_generatedTBs.end(); ++it) {
+        funcs.push_back(make_pair(*it, (*it)->getName().str()));
+    }
+
+    Module *tbs = clone_into_module(funcs, file_name);
+    if(!tbs)
+        return false;
+
+    bool ret = write_module_atomically(tbs, file_name);
+
+    delete tbs;
+
+    return ret;
+#else
+    return false;
+#endif
+}
+
+void TCGLLVMContextPrivate::crete_link_tbs(const string& file_name)
+{
+#if defined(USE_LLVM_3_4)
+    OwningPtr<MemoryBuffer> buffer;
+    if(error_code ec = MemoryBuffer::getFile(file_name, buffer)) {
+        BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] failed to read "
+                + file_name + ": " + ec.message()));
+    }
+
+    std::string error;
+    Module *tbs = ParseBitcodeFile(buffer.get(), m_context, &error);
+    if(!tbs || Linker::LinkModules(m_module, tbs, Linker::DestroySource, &error)) {
+        delete tbs;
+        BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] failed to link "
+                + file_name + ": " + error));
+    }
+
+    delete tbs;
+#else
+    BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] linking translated tbs requires llvm-3.4"));
+#endif
+}
+
 //#define CRETE_CROSS_CHECK
 
-void TCGLLVMContextPrivate::generate_crete_main()
+void TCGLLVMContextPrivate::generate_crete_main(const char *initial_cpuState, uint64_t size)
 {
     if(m_tbExecSequ.size() != m_cpuState_sync_globals.size() ||
             m_tbExecSequ.size() != m_memory_sync_globals.size())
@@ -1501,7 +2186,7 @@ void TCGLLVMContextPrivate::generate_crete_main()
     }
 
     // 0. Construct initial cpu state in llvm bc
-    GlobalVariable* crete_cpu_state = generate_crete_init_cpuState();
+    GlobalVariable* crete_cpu_state = generate_crete_init_cpuState(initial_cpuState, size);
 
     {
         // 1. Construct main function in llvm bc
@@ -1557,62 +2242,202 @@ void TCGLLVMContextPrivate::generate_crete_main()
     m_builder.CreateStore(m_builder.CreatePtrToInt(crete_cpu_state, intType(64)),
             cpu_state_addr, false);
 
-    uint64_t tb_count = 0;
+    // 5. The execution sequence is replayed by a loop over constant tables rather
+    //    than by straight-line calls, so the size of main() does not grow with
+    //    the trace. Each step is 3 x i32 of @crete_replay_steps:
+    //      <tb function index, cpu-state sync index, memory sync index>
+    //    where sync index 0 means no sync before the tb.
+    uint64_t step_count = m_tbExecSequ.size();
+    vector<uint32_t> steps;
+    steps.reserve(3 * step_count);
+
+    // 5.1 Function table of executed TBs: @crete_tb_functions and @crete_tb_pcs
+    map<pair<uint64_t, uint64_t>, uint32_t> tb_indices;
+    vector<Constant *> tb_functions;
+    vector<uint64_t> tb_pcs;
+    FunctionType *tb_func_type = 0;
+
     for(vector<pair<uint64_t, uint64_t> >::const_iterator it = m_tbExecSequ.begin();
-            it != m_tbExecSequ.end(); ++it, ++tb_count) {
-        // 5.   call void @crete_qemu_tb_prologue(i64 tb_count, i64 tb_pc)
-        generate_crete_tb_prologue(tb_count, it->first, crete_cpu_state);
+            it != m_tbExecSequ.end(); ++it) {
+        pair<map<pair<uint64_t, uint64_t>, uint32_t>::iterator, bool> tb_index =
+                tb_indices.insert(make_pair(*it, (uint32_t)tb_functions.size()));
+
+        if(tb_index.second) {
+            // i64 @tcg-llvm-tb-0-b7db3f45(i64* %cpu_state_addr)
+            std::ostringstream fName;
+            fName << "tcg-llvm-tb-" << std::dec << it->second << "-" << std::hex << it->first;
+            Function *tcg_llvm_tb = m_module->getFunction(fName.str());
+
+            assert(tcg_llvm_tb);
+            if(!tb_func_type) {
+                tb_func_type = tcg_llvm_tb->getFunctionType();
+            }
+            assert(tcg_llvm_tb->getFunctionType() == tb_func_type);
+
+            tb_functions.push_back(tcg_llvm_tb);
+            tb_pcs.push_back(it->first);
+        }
+
+        steps.push_back(tb_index.first->second);
+        steps.push_back(0);
+        steps.push_back(0);
+    }
+
+    // 5.2 Tables of sync tables: @crete_cpu_state_syncs and @crete_memory_syncs
+    Function *func_sync_cpu_state = 0;
+    Function *func_sync_memory = 0;
+    GlobalVariable *cpu_state_syncs = 0;
+    GlobalVariable *memory_syncs = 0;
+
+    for(uint64_t i = 0; i < step_count; ++i) {
+        if(m_cpuState_sync_globals[i].first != 0 && !func_sync_cpu_state) {
+            func_sync_cpu_state = m_module->getFunction("crete_sync_cpu_state");
+            if(!func_sync_cpu_state)
+            {
+                BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] crete_sync_cpu_state() is not defined.\n"));
+            }
+        }
+
+        if(m_memory_sync_globals[i].first != 0 && !func_sync_memory) {
+            func_sync_memory = m_module->getFunction("crete_sync_memory_ranges");
+            if(!func_sync_memory)
+            {
+                BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] crete_sync_memory_ranges() is not defined.\n"));
+            }
+        }
+    }
+
+    if(func_sync_cpu_state) {
+        cpu_state_syncs = generate_crete_sync_index(m_cpuState_sync_globals, func_sync_cpu_state,
+                1, steps, "crete_cpu_state_syncs");
+    }
+
+    if(func_sync_memory) {
+        memory_syncs = generate_crete_sync_index(m_memory_sync_globals, func_sync_memory,
+                2, steps, "crete_memory_syncs");
+    }
+
+    // void @crete_qemu_tb_prologue(i64 tb_count, i64 tb_pc)
+    std::vector<llvm::Type*> tb_prologue_argTypes;
+    tb_prologue_argTypes.push_back(intType(64));
+    tb_prologue_argTypes.push_back(intType(64));
+    Function* crete_qemu_tb_prologue = get_crete_replay_function("crete_qemu_tb_prologue", tb_prologue_argTypes);
+
+    // void @crete_finish_replay(i64 tb_count)
+    Function *crete_finish_replay = get_crete_replay_function("crete_finish_replay",
+            std::vector<llvm::Type*>(1, intType(64)));
+
+    if(step_count != 0) {
+        assert(steps.size() == 3 * step_count);
+
+        // 5.3 The tables
+        GlobalVariable *gvar_steps = new GlobalVariable(*m_module,
+                ArrayType::get(intType(32), steps.size()), true, GlobalValue::InternalLinkage,
+                ConstantDataArray::get(m_context, ArrayRef<uint32_t>(steps)), "crete_replay_steps");
+
+        GlobalVariable *gvar_tb_pcs = new GlobalVariable(*m_module,
+                ArrayType::get(intType(64), tb_pcs.size()), true, GlobalValue::InternalLinkage,
+                ConstantDataArray::get(m_context, ArrayRef<uint64_t>(tb_pcs)), "crete_tb_pcs");
+
+        ArrayType *ArrayTy_tb_functions = ArrayType::get(PointerType::get(tb_func_type, 0), tb_functions.size());
+        GlobalVariable *gvar_tb_functions = new GlobalVariable(*m_module,
+                ArrayTy_tb_functions, true, GlobalValue::InternalLinkage,
+                ConstantArray::get(ArrayTy_tb_functions, tb_functions), "crete_tb_functions");
+
+        // 5.4 for(%step = 0; %step < step_count; ++%step)
+        Function *crete_main_func = m_builder.GetInsertBlock()->getParent();
+        BasicBlock *entry_bb = m_builder.GetInsertBlock();
+        BasicBlock *header_bb = BasicBlock::Create(m_context, "replay.header", crete_main_func);
+        BasicBlock *body_bb = BasicBlock::Create(m_context, "replay.body", crete_main_func);
+        BasicBlock *exit_bb = BasicBlock::Create(m_context, "replay.exit", crete_main_func);
+
+        m_builder.CreateBr(header_bb);
+
+        m_builder.SetInsertPoint(header_bb);
+        PHINode *step = m_builder.CreatePHI(intType(64), 2, "crete_step");
+        step->addIncoming(ConstantInt::get(intType(64), 0), entry_bb);
+        m_builder.CreateCondBr(m_builder.CreateICmpULT(step, ConstantInt::get(intType(64), step_count)),
+                body_bb, exit_bb);
+
+        m_builder.SetInsertPoint(body_bb);
+        Value *step_base = m_builder.CreateMul(step, ConstantInt::get(intType(64), 3));
+
+        // 5.5 call void @crete_sync_cpu_state(i8* cpu_state, i32 cs_size, %struct.CPUStateElement* table, i32 size)
+        if(cpu_state_syncs) {
+            std::vector<Value*> sync_cpu_state_argValues;
+            sync_cpu_state_argValues.push_back(ConstantExpr::getGetElementPtr(crete_cpu_state,
+                    vector<Constant *>(2, ConstantInt::get(m_module->getContext(), APInt(32, 0)))));
+            sync_cpu_state_argValues.push_back(ConstantInt::get(m_module->getContext(), APInt(32, m_cpuState_size)));
+
+            generate_crete_sync_call(cpu_state_syncs, func_sync_cpu_state, step_base, 1, gvar_steps,
+                    sync_cpu_state_argValues, "replay.sync_cpu_state");
+        }
+
+        // 5.6 call void @crete_sync_memory_ranges(%struct.MemoryRange* table, i32 size)
+        if(memory_syncs) {
+            generate_crete_sync_call(memory_syncs, func_sync_memory, step_base, 2, gvar_steps,
+                    std::vector<Value*>(), "replay.sync_memory");
+        }
 
-        // 6.   %1 = call i64 @tcg-llvm-tb-0-b7db3f45(i64* %cpu_state_addr)
-        std::ostringstream fName;
-        fName << "tcg-llvm-tb-" << std::dec << it->second << "-" << std::hex << it->first;
-        Function *tcg_llvm_tb = m_module->getFunction(fName.str());
+        // 5.7 call void @crete_qemu_tb_prologue(i64 %step, i64 @crete_tb_pcs[tb_index])
+        std::vector<Value*> indices(2, ConstantInt::get(intType(64), 0));
+        indices[1] = step_base;
+        Value *tb_index = m_builder.CreateZExt(
+                m_builder.CreateLoad(m_builder.CreateInBoundsGEP(gvar_steps, indices)), intType(64), "tb_index");
 
-        assert(tcg_llvm_tb);
+        indices[1] = tb_index;
+        Value *tb_pc = m_builder.CreateLoad(m_builder.CreateInBoundsGEP(gvar_tb_pcs, indices), "tb_pc");
 
+        std::vector<Value*> tb_prologue_argValues;
+        tb_prologue_argValues.push_back(step);
+        tb_prologue_argValues.push_back(tb_pc);
+        m_builder.CreateCall(crete_qemu_tb_prologue, tb_prologue_argValues);
+
+        // 5.8 %1 = call i64 @crete_tb_functions[tb_index](i64* %cpu_state_addr)
+        Value *tcg_llvm_tb = m_builder.CreateLoad(m_builder.CreateInBoundsGEP(gvar_tb_functions, indices), "tb_function");
         m_builder.CreateCall(tcg_llvm_tb,
                 std::vector<llvm::Value*>(1, cpu_state_addr));
-    }
 
-    Function *crete_finish_replay = m_module->getFunction("crete_finish_replay");
-    if(!crete_finish_replay){
-        crete_finish_replay = Function::Create(
-                FunctionType::get(Type::getVoidTy(m_context),
-                        std::vector<llvm::Type*>(1, intType(64)), false),
-                        Function::ExternalLinkage, "crete_finish_replay", m_module);
+        step->addIncoming(m_builder.CreateAdd(step, ConstantInt::get(intType(64), 1)), m_builder.GetInsertBlock());
+        m_builder.CreateBr(header_bb);
 
-        IRBuilder<> temp_irb(m_context);
-        BasicBlock *temp_bb = BasicBlock::Create(m_context,
-                                                 "entry", crete_finish_replay);
-        temp_irb.SetInsertPoint(temp_bb);
-        temp_irb.CreateRet(0);
+        m_builder.SetInsertPoint(exit_bb);
     }
+
     m_builder.CreateCall(crete_finish_replay,
-            std::vector<llvm::Value*>(1, ConstantInt::get(intType(64), tb_count)));
+            std::vector<llvm::Value*>(1, ConstantInt::get(intType(64), step_count)));
 
     m_builder.CreateRet(0);
 }
 
-GlobalVariable* TCGLLVMContextPrivate::generate_crete_init_cpuState()
+// Replay hook name(), defined as a no-op if the module lacks it
+Function* TCGLLVMContextPrivate::get_crete_replay_function(const string& name,
+        const vector<llvm::Type*>& argTypes)
 {
-    // 1. Get initial CPUState from file
-    ifstream i_sm("dump_initial_cpuState.bin", ios_base::binary);
-    assert(i_sm && "open file failed: dump_initial_cpuState.bin\n");;
+    Function *func = m_module->getFunction(name);
+    if(!func){
+        func = Function::Create(
+                FunctionType::get(Type::getVoidTy(m_context), argTypes, false),
+                        Function::ExternalLinkage, name, m_module);
 
-    i_sm.seekg(0, ios::end);
-    uint64_t size_cpuState = i_sm.tellg();
-    assert(size_cpuState == m_cpuState_size);
-    i_sm.seekg(0, ios::beg);
+        IRBuilder<> temp_irb(m_context);
+        BasicBlock *temp_bb = BasicBlock::Create(m_context,
+                                                 "entry", func);
+        temp_irb.SetInsertPoint(temp_bb);
+        temp_irb.CreateRet(0);
+    }
 
-    string initial_cpuState;
-    initial_cpuState.reserve(size_cpuState);
-    initial_cpuState.assign((std::istreambuf_iterator<char>(i_sm)),
-                std::istreambuf_iterator<char>());
+    return func;
+}
 
-    assert(initial_cpuState.size() == m_cpuState_size);
+GlobalVariable* TCGLLVMContextPrivate::generate_crete_init_cpuState(const char *initial_cpuState, uint64_t size)
+{
+    // 1. Initial CPUState, as dumped by qemu
+    assert(size == m_cpuState_size);
 
     // 2. Construct a global variable "cpu_state" with initial value read from file
-    Constant *const_initial_cpuState = ConstantDataArray::getString(m_module->getContext(), initial_cpuState, false);
+    Constant *const_initial_cpuState = ConstantDataArray::getString(m_module->getContext(),
+            StringRef(initial_cpuState, size), false);
     ArrayType* ArrayTy_0 = ArrayType::get(IntegerType::get(m_module->getContext(), 8), m_cpuState_size);
 
     GlobalVariable* gvar_array_init_cpuState = new GlobalVariable(/*Module=*/*m_module,
@@ -1627,99 +2452,85 @@ GlobalVariable* TCGLLVMContextPrivate::generate_crete_init_cpuState()
     return gvar_array_init_cpuState;
 }
 
-void TCGLLVMContextPrivate::generate_crete_tb_prologue(uint64_t tb_count, uint64_t tb_pc, GlobalVariable *crete_cpu_state)
+// Global array of <Element *table, i32 size> of the non-empty tables of sync_globals,
+// the sync table arguments of sync_func, with an empty entry at index 0.
+// Sets field step_field of each step to the index of its table.
+GlobalVariable* TCGLLVMContextPrivate::generate_crete_sync_index(
+        const vector<pair<uint64_t, GlobalVariable *> >& sync_globals,
+        Function *sync_func, unsigned step_field, vector<uint32_t>& steps, const string& name)
 {
-    // 1. call void crete_sync_cpu_state(uint8_t *cpu_state, uint32_t cs_size,
-    //                             const struct CPUStateElement *sync_table, uint32_t st_size);
-    if(m_cpuState_sync_globals[tb_count].first != 0)
-    {
-        uint32_t st_size = m_cpuState_sync_globals[tb_count].first;
-        GlobalVariable *sync_table = m_cpuState_sync_globals[tb_count].second;
+    FunctionType *sync_func_type = sync_func->getFunctionType();
+    unsigned num_params = sync_func_type->getNumParams();
+    assert(num_params >= 2);
 
-        Function* func_sync_cpu_state = m_module->getFunction("crete_sync_cpu_state");
-        if(!func_sync_cpu_state)
-        {
-            BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] crete_sync_cpu_state() is not defined.\n"));
+    std::vector<llvm::Type*> entry_fields;
+    entry_fields.push_back(sync_func_type->getParamType(num_params - 2));
+    entry_fields.push_back(sync_func_type->getParamType(num_params - 1));
+    StructType *entry_type = StructType::get(m_context, entry_fields);
+
+    std::vector<Constant*> entries;
+    std::vector<Constant*> entry(2);
+
+    entry[0] = ConstantPointerNull::get(cast<PointerType>(entry_fields[0]));
+    entry[1] = ConstantInt::get(entry_fields[1], 0);
+    entries.push_back(ConstantStruct::get(entry_type, entry));
+
+    for(uint64_t i = 0; i < sync_globals.size(); ++i) {
+        if(sync_globals[i].first == 0) {
+            continue;
         }
 
-        // 1.1 uint8_t *cpu_state (getelementptr inbounds (crete_cpu_state, i32 0, i32 0))
-        Constant* const_ptr_cpu_state = ConstantExpr::getGetElementPtr(crete_cpu_state,
-                vector<Constant *>(2, ConstantInt::get(m_module->getContext(), APInt(32, 0))));
-        // 1.2 uint32_t cs_size
-        ConstantInt* const_int32_cpu_size = ConstantInt::get(m_module->getContext(), APInt(32, m_cpuState_size));
-        // 1.3 const struct CPUStateElement *sync_table:
-        //         (getelementptr inbounds (crete_cpu_state, i32 0, i32 0))
-        Constant* const_ptr_sync_table = ConstantExpr::getGetElementPtr(sync_table,
-                vector<Constant *>(2, ConstantInt::get(m_module->getContext(), APInt(32, 0))));
-        // 1.4 uint32_t st_size
-        ConstantInt* const_int32_st_size = ConstantInt::get(m_module->getContext(), APInt(32, st_size));
+        steps[3 * i + step_field] = entries.size();
 
-        std::vector<Value*> sync_cpu_state_argValues;
-        sync_cpu_state_argValues.push_back(const_ptr_cpu_state);
-        sync_cpu_state_argValues.push_back(const_int32_cpu_size);
-        sync_cpu_state_argValues.push_back(const_ptr_sync_table);
-        sync_cpu_state_argValues.push_back(const_int32_st_size);
-        m_builder.CreateCall(func_sync_cpu_state, sync_cpu_state_argValues);
+        // (getelementptr inbounds (sync_table, i32 0, i32 0))
+        entry[0] = ConstantExpr::getGetElementPtr(sync_globals[i].second,
+                vector<Constant *>(2, ConstantInt::get(m_module->getContext(), APInt(32, 0))));
+        entry[1] = ConstantInt::get(entry_fields[1], sync_globals[i].first);
+        entries.push_back(ConstantStruct::get(entry_type, entry));
     }
 
-    // 2. call void crete_sync_memory(const struct MemoryElement *sync_table, uint32_t st_size)
-    if(m_memory_sync_globals[tb_count].first != 0)
-    {
-        uint32_t st_size = m_memory_sync_globals[tb_count].first;
-        GlobalVariable *sync_table = m_memory_sync_globals[tb_count].second;
+    ArrayType* ArrayTy_syncs = ArrayType::get(entry_type, entries.size());
 
-        Function* func_crete_sync_memory = m_module->getFunction("crete_sync_memory");
-        if(!func_crete_sync_memory)
-        {
-            BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] crete_sync_memory() is not defined.\n"));
-        }
+    return new GlobalVariable(*m_module, ArrayTy_syncs, true, GlobalValue::InternalLinkage,
+            ConstantArray::get(ArrayTy_syncs, entries), name);
+}
 
-        // 2.1 const struct MemoryElement *sync_table:
-        //         (getelementptr inbounds (MemoryElement, i32 0, i32 0))
-        Constant* const_ptr_sync_table = ConstantExpr::getGetElementPtr(sync_table,
-                vector<Constant *>(2, ConstantInt::get(m_module->getContext(), APInt(32, 0))));
-        // 2.2 uint32_t st_size
-        ConstantInt* const_int32_st_size = ConstantInt::get(m_module->getContext(), APInt(32, st_size));
+// Calls sync_func(argValues..., table, size) with the entry of sync_index given by
+// field step_field of the current step, unless it is 0
+void TCGLLVMContextPrivate::generate_crete_sync_call(GlobalVariable *sync_index, Function *sync_func,
+        Value *step_base, unsigned step_field, GlobalVariable *steps, vector<Value*> argValues,
+        const string& name)
+{
+    Function *crete_main_func = m_builder.GetInsertBlock()->getParent();
+    BasicBlock *sync_bb = BasicBlock::Create(m_context, name, crete_main_func);
+    BasicBlock *next_bb = BasicBlock::Create(m_context, name + ".next", crete_main_func);
 
-        std::vector<Value*> crete_sync_memory_argValues;
-        crete_sync_memory_argValues.push_back(const_ptr_sync_table);
-        crete_sync_memory_argValues.push_back(const_int32_st_size);
-        m_builder.CreateCall(func_crete_sync_memory, crete_sync_memory_argValues);
-    }
+    std::vector<Value*> indices(2, ConstantInt::get(intType(64), 0));
+    indices[1] = m_builder.CreateAdd(step_base, ConstantInt::get(intType(64), step_field));
+    Value *sync_idx = m_builder.CreateZExt(
+            m_builder.CreateLoad(m_builder.CreateInBoundsGEP(steps, indices)), intType(64));
 
-    {
-        // 2. call void @crete_qemu_tb_prologue(i64 tb_count, i64 tb_pc)
-        Function* crete_qemu_tb_prologue = m_module->getFunction("crete_qemu_tb_prologue");
-        if(!crete_qemu_tb_prologue)
-        {
-            std::vector<llvm::Type*> tb_prologue_argTypes;
-            tb_prologue_argTypes.push_back(intType(64));
-            tb_prologue_argTypes.push_back(intType(64));
+    m_builder.CreateCondBr(m_builder.CreateICmpNE(sync_idx, ConstantInt::get(intType(64), 0)),
+            sync_bb, next_bb);
 
-            crete_qemu_tb_prologue = Function::Create(
-                            FunctionType::get(Type::getVoidTy(m_context), tb_prologue_argTypes, false),
-                                    Function::ExternalLinkage, "crete_qemu_tb_prologue", m_module);
+    m_builder.SetInsertPoint(sync_bb);
 
-            IRBuilder<> temp_irb(m_context);
-            BasicBlock *temp_bb = BasicBlock::Create(m_context,
-                                                     "entry", crete_qemu_tb_prologue);
-            temp_irb.SetInsertPoint(temp_bb);
-            temp_irb.CreateRet(0);
-        }
+    std::vector<Value*> entry_indices(3, ConstantInt::get(intType(32), 0));
+    entry_indices[1] = sync_idx;
+    argValues.push_back(m_builder.CreateLoad(m_builder.CreateInBoundsGEP(sync_index, entry_indices)));
+    entry_indices[2] = ConstantInt::get(intType(32), 1);
+    argValues.push_back(m_builder.CreateLoad(m_builder.CreateInBoundsGEP(sync_index, entry_indices)));
 
-        std::vector<Value*> tb_prologue_argValues;
-        tb_prologue_argValues.push_back(ConstantInt::get(intType(64), tb_count));
-        tb_prologue_argValues.push_back(ConstantInt::get(intType(64), tb_pc));
-        m_builder.CreateCall(crete_qemu_tb_prologue,tb_prologue_argValues);
-    }
+    m_builder.CreateCall(sync_func, argValues);
+    m_builder.CreateBr(next_bb);
+
+    m_builder.SetInsertPoint(next_bb);
 }
 
-void TCGLLVMContextPrivate::crete_generate_llvm_cpuStateSyncTables(const string& input_file_name)
+void TCGLLVMContextPrivate::crete_generate_llvm_cpuStateSyncTables(const char *data, uint64_t size)
 {
-    ifstream i_sm(input_file_name.c_str(), ios_base::binary);
-    if(!i_sm.good()) {
-        BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] can't find file: " + input_file_name));
-    }
+    crete::TraceSectionBuf i_buf(data, size);
+    istream i_sm(&i_buf);
 
     vector<cpuStateSyncTable_ty> cpuStateSyncTables;
     boost::archive::binary_iarchive ia(i_sm);
@@ -1798,64 +2609,100 @@ void TCGLLVMContextPrivate::crete_generate_llvm_cpuStateSyncTable(const cpuState
     m_cpuState_sync_globals.push_back(make_pair(syncTable_size, gvar_array_cpuStateSyncTable));
 }
 
-void TCGLLVMContextPrivate::generate_llvm_MemorySyncTables(const string& input_file_name)
+// Reads the tables written by RuntimeEnv::writeMemoSyncTables(), in place
+void TCGLLVMContextPrivate::generate_llvm_MemorySyncTables(const char *data, uint64_t size)
 {
-    ifstream i_sm(input_file_name.c_str(), ios_base::binary);
-    if(!i_sm.good()) {
-        BOOST_THROW_EXCEPTION(std::runtime_error("[Crete Error] can't find file: " + input_file_name));
-    }
+    crete::MemoSyncReader reader(data, size);
 
-    vector<memoSyncTable_ty> memorySyncTable;
-    boost::archive::binary_iarchive ia(i_sm);
-    ia >> memorySyncTable;;
+    uint64_t table_count = reader.read_count();
+
+    memoSyncTable_ty memorySyncTable;
+
+    for(uint64_t i = 0; i < table_count; ++i) {
+        uint64_t range_count = reader.read_count();
+
+        memorySyncTable.first.clear();
+        memorySyncTable.second.clear();
+
+        for(uint64_t j = 0; j < range_count; ++j) {
+            uint64_t addr = 0;
+            uint64_t range_size = 0;
+            const char *values = reader.read_range(addr, range_size);
+
+            if(range_size == 0) {
+                continue;
+            }
+
+            vector<pair<uint64_t, uint64_t> >& ranges = memorySyncTable.first;
+            if(!ranges.empty() && ranges.back().first + ranges.back().second == addr) {
+                ranges.back().second += range_size;
+            } else {
+                ranges.push_back(make_pair(addr, range_size));
+            }
+
+            memorySyncTable.second.append(values, range_size);
+        }
 
-    for(vector<memoSyncTable_ty>::const_iterator it = memorySyncTable.begin();
-            it != memorySyncTable.end(); ++it) {
-        generate_llvm_MemorySyncTable(*it);
+        generate_llvm_MemorySyncTable(memorySyncTable);
     }
 }
 
 void TCGLLVMContextPrivate::generate_llvm_MemorySyncTable(const memoSyncTable_ty& memost)
 {
-    if(memost.empty())
+    if(memost.first.empty())
     {
         m_memory_sync_globals.push_back(make_pair(0, (GlobalVariable*)0));
         return;
     }
 
-    StructType *StructTy_struct_MemoSyncElement = m_module->getTypeByName("struct.MemoryElement");
-    if(!StructTy_struct_MemoSyncElement)
+    StructType *StructTy_struct_MemoryRange = m_module->getTypeByName("struct.MemoryRange");
+    if(!StructTy_struct_MemoryRange)
     {
-        BOOST_THROW_EXCEPTION(std::runtime_error( "struct.MemoSyncElement is not defined.\n"));
+        BOOST_THROW_EXCEPTION(std::runtime_error( "struct.MemoryRange is not defined.\n"));
     }
 
-    uint64_t syncTable_size = memost.size();
+    // Values of all ranges as one constant blob, which ranges point into
+    Constant *const_data = ConstantDataArray::getString(m_module->getContext(), memost.second, false);
+    GlobalVariable* gvar_data = new GlobalVariable(*m_module, /*Module=*/
+                                                   const_data->getType(), /*Type=*/
+                                                   true, /*isConstant=*/
+                                                   GlobalValue::InternalLinkage, /*Linkage=*/
+                                                   const_data /*Initializer=*/);
+
+    uint64_t syncTable_size = memost.first.size();
     std::vector<Constant*> const_array_elems; // construct value for syncTable in llvm
     const_array_elems.reserve(syncTable_size);
 
-    for(memoSyncTable_ty::const_iterator it = memost.begin();
-            it != memost.end(); ++it) {
-        uint8_t value = it->second;
-        uint64_t static_addr = it->first;
-
-        // 1. uint8_t m_value
-        ConstantInt* const_int8_value = ConstantInt::get(m_module->getContext(), APInt(8, value));
-        // 2. uint64_t m_static_addr
-        ConstantInt* const_int64_static_addr = ConstantInt::get(m_module->getContext(), APInt(64, static_addr));
-
-        std::vector<Constant*> const_memoSyncElement_fields;
-        const_memoSyncElement_fields.push_back(const_int8_value);
-        const_memoSyncElement_fields.push_back(const_int64_static_addr);
-
-        Constant* const_memoSyncElement = ConstantStruct::get(StructTy_struct_MemoSyncElement, const_memoSyncElement_fields);
-
-        const_array_elems.push_back(const_memoSyncElement);
+    uint64_t data_offset = 0;
+    for(vector<pair<uint64_t, uint64_t> >::const_iterator it = memost.first.begin();
+            it != memost.first.end(); ++it) {
+        // 1. uint64_t m_static_addr
+        ConstantInt* const_int64_static_addr = ConstantInt::get(m_module->getContext(), APInt(64, it->first));
+        // 2. uint64_t m_size
+        ConstantInt* const_int64_size = ConstantInt::get(m_module->getContext(), APInt(64, it->second));
+        // 3. const uint8_t *m_data (getelementptr inbounds (data, i32 0, i64 data_offset))
+        std::vector<Constant*> data_indices;
+        data_indices.push_back(ConstantInt::get(m_module->getContext(), APInt(32, 0)));
+        data_indices.push_back(ConstantInt::get(m_module->getContext(), APInt(64, data_offset)));
+        Constant* const_ptr_data = ConstantExpr::getGetElementPtr(gvar_data, data_indices);
+
+        std::vector<Constant*> const_memoryRange_fields;
+        const_memoryRange_fields.push_back(const_int64_static_addr);
+        const_memoryRange_fields.push_back(const_int64_size);
+        const_memoryRange_fields.push_back(const_ptr_data);
+
+        Constant* const_memoryRange = ConstantStruct::get(StructTy_struct_MemoryRange, const_memoryRange_fields);
+
+        const_array_elems.push_back(const_memoryRange);
+
+        data_offset += it->second;
     }
 
     assert(const_array_elems.size() == syncTable_size);
+    assert(data_offset == memost.second.size());
 
-    // Construct type for syncTable in llvm as "MemoSyncElement[syncTable_size]"
-    ArrayType* ArrayTy_syncTable = ArrayType::get(StructTy_struct_MemoSyncElement, syncTable_size);
+    // Construct type for syncTable in llvm as "MemoryRange[syncTable_size]"
+    ArrayType* ArrayTy_syncTable = ArrayType::get(StructTy_struct_MemoryRange, syncTable_size);
     // Construct instance of syncTable as global variable in llvm
     GlobalVariable* gvar_array_cpuStateSyncTable = new GlobalVariable(*m_module, /*Module=*/
                                                                       ArrayTy_syncTable, /*Type=*/
@@ -1980,19 +2827,64 @@ void TCGLLVMContext::crete_add_tbExecSequ(vector<pair<uint64_t, uint64_t> > seq)
     m_private->crete_add_tbExecSequ(seq);
 }
 
-void TCGLLVMContext::generate_crete_main()
+void TCGLLVMContext::generate_crete_main(const char *initial_cpuState, uint64_t size)
+{
+    m_private->generate_crete_main(initial_cpuState, size);
+}
+
+void TCGLLVMContext::generate_llvm_cpuStateSyncTables(const char *data, uint64_t size)
+{
+    m_private->crete_generate_llvm_cpuStateSyncTables(data, size);
+}
+
+void TCGLLVMContext::generate_llvm_MemorySyncTables(const char *data, uint64_t size)
+{
+    m_private->generate_llvm_MemorySyncTables(data, size);
+}
+
+void TCGLLVMContext::crete_set_tb_cache_dir(const string& cache_dir, uint64_t max_size)
+{
+    m_private->crete_set_tb_cache_dir(cache_dir, max_size);
+}
+
+void TCGLLVMContext::crete_trim_tb_cache() const
+{
+    m_private->crete_trim_tb_cache();
+}
+
+void TCGLLVMContext::crete_print_tb_cache_stats() const
+{
+    m_private->crete_print_tb_cache_stats();
+}
+
+void TCGLLVMContext::crete_get_tb_cache_stats(uint64_t& hits, uint64_t& misses) const
+{
+    m_private->crete_get_tb_cache_stats(hits, misses);
+}
+
+void TCGLLVMContext::crete_add_tb_cache_stats(uint64_t hits, uint64_t misses)
+{
+    m_private->crete_add_tb_cache_stats(hits, misses);
+}
+
+void TCGLLVMContext::crete_set_tb_count(int tb_count)
+{
+    m_private->crete_set_tb_count(tb_count);
+}
+
+void TCGLLVMContext::crete_externalize_local_globals()
 {
-    m_private->generate_crete_main();
+    m_private->crete_externalize_local_globals();
 }
 
-void TCGLLVMContext::generate_llvm_cpuStateSyncTables(const string& input_file_name)
+bool TCGLLVMContext::crete_write_generated_tbs(const string& file_name)
 {
-    m_private->crete_generate_llvm_cpuStateSyncTables(input_file_name);
+    return m_private->crete_write_generated_tbs(file_name);
 }
 
-void TCGLLVMContext::generate_llvm_MemorySyncTables(const string& input_file_name)
+void TCGLLVMContext::crete_link_tbs(const string& file_name)
 {
-    m_private->generate_llvm_MemorySyncTables(input_file_name);
+    m_private->crete_link_tbs(file_name);
 }
 #endif // TCG_LLVM_OFFLINE
 /*****************************/
@@ -125,9 +125,22 @@ public:
     void crete_set_cpuState_size(uint64_t cpuState_size);
     void crete_add_tbExecSequ(vector<pair<uint64_t, uint64_t> > seq);
 
-    void generate_crete_main();
-    void generate_llvm_cpuStateSyncTables(const string& input_file_name);
-    void generate_llvm_MemorySyncTables(const string& input_file_name);
+    /* Tables and states are sections of the trace container */
+    void generate_crete_main(const char *initial_cpuState, uint64_t size);
+    void generate_llvm_cpuStateSyncTables(const char *data, uint64_t size);
+    void generate_llvm_MemorySyncTables(const char *data, uint64_t size);
+
+    void crete_set_tb_cache_dir(const string& cache_dir, uint64_t max_size);
+    void crete_trim_tb_cache() const;
+    void crete_print_tb_cache_stats() const;
+
+    /* Translation of a trace split across worker processes */
+    void crete_get_tb_cache_stats(uint64_t& hits, uint64_t& misses) const;
+    void crete_add_tb_cache_stats(uint64_t hits, uint64_t misses);
+    void crete_set_tb_count(int tb_count);
+    void crete_externalize_local_globals();
+    bool crete_write_generated_tbs(const string& file_name);
+    void crete_link_tbs(const string& file_name);
 #else
 #error "ERROR"
 #endif
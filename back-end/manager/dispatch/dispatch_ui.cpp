@@ -78,6 +78,15 @@ auto DispatchUI::process_config(const pt::ptree& config) -> option::Dispatch
         opts.trace.print_graph_only_branches = trace.get<bool>("print-graph-branches-only", false);
         opts.trace.print_elf_info = trace.get<bool>("print-elf-info", false);
         opts.trace.compress = trace.get<bool>("compress", false);
+        opts.trace.compressor = trace.get<std::string>("compressor", opts.trace.compressor);
+
+        if(opts.trace.compressor != "gzip" &&
+           opts.trace.compressor != "lz4" &&
+           opts.trace.compressor != "zstd")
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::arg_invalid_str{opts.trace.compressor}
+                                              << err::parse{"crete.trace.compressor"});
+        }
 
         if(opts.trace.print_graph && !opts.trace.filter_traces)
             throw Exception{} << err::parse{"trace.print-graph requires trace.filter-traces"};
@@ -95,6 +104,7 @@ auto DispatchUI::process_config(const pt::ptree& config) -> option::Dispatch
         opts.test.interval.tc = test.get<uint64_t>("interval.tc", std::numeric_limits<uint64_t>::max());
         opts.test.interval.time = test.get<uint64_t>("interval.time", std::numeric_limits<uint64_t>::max());
         opts.test.interval.new_inst_wait_time = test.get<uint64_t>("interval.new_inst_wait_time", std::numeric_limits<uint64_t>::max());
+        opts.test.fingerprint_spill = test.get<uint64_t>("fingerprint-spill", 0);
 
         if(opts.mode.distributed)
         {
@@ -7,6 +7,10 @@
 #include <boost/filesystem.hpp>
 
 #include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <cassert>
 #include <cstdlib>
 
@@ -227,6 +231,81 @@ static inline void update_proc_maps()
     }
 }
 
+// ret: false, if crete-run closed the fork-server pipe
+static inline bool crete_fork_server_read(int32_t& word)
+{
+    ssize_t ret;
+    do
+    {
+        ret = read(CRETE_FORK_SERVER_CTL_FD, &word, sizeof(word));
+    } while(ret < 0 && errno == EINTR);
+
+    return ret == sizeof(word);
+}
+
+static inline void crete_fork_server_write(int32_t word)
+{
+    ssize_t ret;
+    do
+    {
+        ret = write(CRETE_FORK_SERVER_ST_FD, &word, sizeof(word));
+    } while(ret < 0 && errno == EINTR);
+
+    if(ret != sizeof(word))
+        throw runtime_error("fork server failed to report to crete-run");
+}
+
+// Stop here once, after dynamic linking and loading the configuration, and fork a
+// fresh test process for each request from crete-run.
+// Returns only within a forked test process.
+static inline void crete_fork_server()
+{
+    fprintf(stderr, "crete_fork_server() entered\n");
+
+    // Not inherited by whatever a test process executes
+    if(fcntl(CRETE_FORK_SERVER_CTL_FD, F_SETFD, FD_CLOEXEC) != 0 ||
+       fcntl(CRETE_FORK_SERVER_ST_FD, F_SETFD, FD_CLOEXEC) != 0)
+        throw runtime_error("failed to set FD_CLOEXEC on the fork server pipes");
+
+    crete_fork_server_write(0); // ready
+
+    int32_t request;
+    while(crete_fork_server_read(request))
+    {
+        pid_t pid = fork();
+        if(pid < 0)
+            throw runtime_error("fork() failed in fork server");
+
+        if(pid == 0)
+        {
+            close(CRETE_FORK_SERVER_CTL_FD);
+            close(CRETE_FORK_SERVER_ST_FD);
+            setpgrp();
+
+            // A preloaded executable exec'ed by the test (e.g., env, nice or timeout)
+            // runs normally, rather than as another fork server.
+            unsetenv(CRETE_ENV_FORK_SERVER);
+
+            // crete-run may have re-created the launch directory since the fork server started
+            const char *pwd = std::getenv("PWD");
+            if(pwd && chdir(pwd) != 0)
+                throw runtime_error("failed to chdir() to the launch directory: " + std::string(pwd));
+
+            return;
+        }
+
+        crete_fork_server_write(pid);
+
+        int status = 0;
+        while(waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+        crete_fork_server_write(status);
+    }
+
+    // crete-run is done with this executable
+    _exit(0);
+}
+
 static inline void crete_preload_initialize(int argc, char**& argv)
 {
     fprintf(stderr, "crete_preload_initialize() entered\n");
@@ -234,10 +313,19 @@ static inline void crete_preload_initialize(int argc, char**& argv)
     int is_sec_cmd = std::getenv(CRETE_ENV_SEC_CMD)? 1:0;
     fprintf(stderr, "is_sec_cmd = %d\n", is_sec_cmd);
 
+    config::HarnessConfiguration hconfig;
+
     if(!is_sec_cmd)
     {
         // Should terminate program while being launched as prime
         update_proc_maps();
+
+        hconfig = crete_load_configuration();
+
+        if(std::getenv(CRETE_ENV_FORK_SERVER))
+        {
+            crete_fork_server();
+        }
     }
 
     // Need to call crete_send_target_pid before make_concolics, or they won't be captured.
@@ -245,7 +333,6 @@ static inline void crete_preload_initialize(int argc, char**& argv)
 
     if(!is_sec_cmd)
     {
-        config::HarnessConfiguration hconfig = crete_load_configuration();
         crete_process_configuration(hconfig, argc, argv);
     }
     fprintf(stderr, "crete_preload_initialize() finished\n");
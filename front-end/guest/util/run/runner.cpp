@@ -25,7 +25,10 @@
 #include <boost/algorithm/string/classification.hpp>
 
 #include <unistd.h>
+#include <errno.h>
 #include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 namespace bp = boost::process;
 namespace fs = boost::filesystem;
@@ -87,6 +90,9 @@ private:
     bool is_first_exec_;
     std::size_t proc_maps_hash_;
 
+    bool m_fork_server;
+    boost::shared_ptr<bp::posix_child> m_fork_server_proc;
+
 public:
     RunnerFSM_();
 
@@ -94,6 +100,8 @@ public:
     void prime_executable();
     void write_configuration() const;
     void launch_executable();
+    void start_fork_server();
+    void launch_from_fork_server();
     void void_target_pid() const;
     void signal_dump() const;
 
@@ -116,6 +124,7 @@ private:
     void init_launch_folder();
 
     void init_sandbox();
+    void clear_sandbox();
     void init_ramdisk();
     void reset_sandbox_folder_permission();
 
@@ -333,24 +342,28 @@ struct start // Basically, serves as constructor.
     start(const std::string& host_ip,
           const fs::path& config,
           const fs::path& sandbox,
-          const fs::path& environment) :
+          const fs::path& environment,
+          bool fork_server) :
         host_ip_(host_ip),
         config_(config),
         sandbox_(sandbox),
-        environment_(environment)
+        environment_(environment),
+        fork_server_(fork_server)
     {}
 
     const std::string& host_ip_;
     const fs::path& config_;
     const fs::path& sandbox_;
     const fs::path& environment_;
+    bool fork_server_;
 };
 
 RunnerFSM_::RunnerFSM_() :
     client_(),
     pid_(-1),
     is_first_exec_(true),
-    proc_maps_hash_(0)
+    proc_maps_hash_(0),
+    m_fork_server(false)
 {
 }
 
@@ -361,6 +374,7 @@ void RunnerFSM_::init(const start& ev)
 
     m_sandbox_dir = ev.sandbox_;
     m_environment = ev.environment_;
+    m_fork_server = ev.fork_server_;
 }
 
 void RunnerFSM_::verify_env(const poll&)
@@ -648,6 +662,13 @@ static inline void process_exit_status(std::ostream& log, int exit_status)
 
 void RunnerFSM_::launch_executable()
 {
+    // The configuration only settles after the first execution (see update_config())
+    if(m_fork_server && !is_first_exec_)
+    {
+        launch_from_fork_server();
+        return;
+    }
+
 #if defined(CRETE_DBG_SYSTEM_LAUNCH)
     // A alternative of bp::launch. require header file "#include <cstdlib>"
     std::string exec_cmd = "LD_PRELOAD=\"libcrete_run_preload.so\" ";
@@ -683,6 +704,94 @@ void RunnerFSM_::launch_executable()
 #endif
 }
 
+// Transfer a word over a fork-server pipe, retrying when interrupted by the timeout alarm
+static inline void fork_server_write(int fd, int32_t word)
+{
+    ssize_t ret;
+    do
+    {
+        ret = ::write(fd, &word, sizeof(word));
+    } while(ret < 0 && errno == EINTR);
+
+    if(ret != sizeof(word))
+    {
+        BOOST_THROW_EXCEPTION(Exception() << err::process("fork server exited unexpectedly"));
+    }
+}
+
+static inline int32_t fork_server_read(int fd)
+{
+    int32_t word = 0;
+    ssize_t ret;
+    do
+    {
+        ret = ::read(fd, &word, sizeof(word));
+    } while(ret < 0 && errno == EINTR);
+
+    if(ret != sizeof(word))
+    {
+        BOOST_THROW_EXCEPTION(Exception() << err::process("fork server exited unexpectedly"));
+    }
+
+    return word;
+}
+
+// Launch the executable once as a fork server: run-preload stops it after dynamic
+// linking and loading the configuration, and forks a test process from there on
+// each request, saving the exec, dynamic linking and config parsing of every test.
+void RunnerFSM_::start_fork_server()
+{
+    bp::posix_context ctx = m_launch_ctx;
+
+    // The fork server outlives each test, so its output can not be read until EOF
+    ctx.output_behavior.clear();
+    ctx.output_behavior.insert(bp::behavior_map::value_type(STDOUT_FILENO, bp::inherit_stream()));
+    ctx.output_behavior.insert(bp::behavior_map::value_type(STDERR_FILENO, bp::inherit_stream()));
+    ctx.output_behavior.insert(bp::behavior_map::value_type(CRETE_FORK_SERVER_ST_FD, bp::capture_stream()));
+    ctx.input_behavior.clear();
+    ctx.input_behavior.insert(bp::behavior_map::value_type(STDIN_FILENO, bp::silence_stream()));
+    ctx.input_behavior.insert(bp::behavior_map::value_type(CRETE_FORK_SERVER_CTL_FD, bp::capture_stream()));
+
+    ctx.environment.insert(bp::environment::value_type(CRETE_ENV_FORK_SERVER, "true"));
+
+    m_fork_server_proc.reset(new bp::posix_child(bp::posix_launch(m_exec, m_launch_args, ctx)));
+
+    // wait until the fork server is ready
+    fork_server_read(m_fork_server_proc->get_output(CRETE_FORK_SERVER_ST_FD).handle().get());
+
+    std::cerr << "[crete-run] fork server started: pid = " << m_fork_server_proc->get_id() << std::endl;
+}
+
+void RunnerFSM_::launch_from_fork_server()
+{
+    if(!m_fork_server_proc)
+    {
+        start_fork_server();
+    }
+
+    const int ctl_fd = m_fork_server_proc->get_input(CRETE_FORK_SERVER_CTL_FD).handle().get();
+    const int st_fd = m_fork_server_proc->get_output(CRETE_FORK_SERVER_ST_FD).handle().get();
+
+    fork_server_write(ctl_fd, 0);
+
+    pid_ = fork_server_read(st_fd);
+    monitored_pid = pid_;
+    assert(monitored_timeout != 0);
+    alarm(monitored_timeout);
+
+    std::cerr << "=== Output from the target executable ===\n";
+    int status = fork_server_read(st_fd);
+    alarm(0);
+
+    if(WIFEXITED(status))
+    {
+        process_exit_status(std::cerr, WEXITSTATUS(status));
+    } else {
+        process_exit_status(std::cerr, CRETE_EXIT_CODE_SIG_BASE + WTERMSIG(status));
+    }
+    std::cerr << "=========================================\n";
+}
+
 static bool execute_command_line(const std::string& cmd, const bp::posix_context& ctx)
  {
     fprintf(stderr, "executing: %s\n", cmd.c_str());
@@ -1001,6 +1110,48 @@ void RunnerFSM_::init_sandbox()
     fs::create_directories(fs::path(CRETE_SANDBOX_PATH) / "tmp");
 }
 
+// Remove the contents of "dir", except "keep" and folders mounted from another
+// device (e.g., the bind mounts and the ramdisk), which are left in place.
+static void remove_unmounted_contents(const fs::path& dir, dev_t dev, const fs::path& keep)
+{
+    std::vector<fs::path> entries(fs::directory_iterator(dir), (fs::directory_iterator()));
+
+    for(std::vector<fs::path>::const_iterator it = entries.begin();
+            it != entries.end(); ++it) {
+        struct stat st;
+        if(lstat(it->string().c_str(), &st) != 0 || *it == keep)
+            continue;
+
+        if(S_ISDIR(st.st_mode))
+        {
+            if(st.st_dev != dev)
+                continue;
+
+            remove_unmounted_contents(*it, dev, keep);
+
+            if(fs::is_empty(*it))
+                fs::remove(*it);
+        } else {
+            fs::remove(*it);
+        }
+    }
+}
+
+// Clear what previous tests left in the sandbox, as init_sandbox() does, but keep
+// its root folder and mounts in place: the fork server is chroot-ed into it.
+void RunnerFSM_::clear_sandbox()
+{
+    reset_sandbox_folder_permission();
+
+    struct stat st;
+    if(stat(CRETE_SANDBOX_PATH, &st) != 0)
+        BOOST_THROW_EXCEPTION(Exception() << err::file_missing(CRETE_SANDBOX_PATH));
+
+    remove_unmounted_contents(CRETE_SANDBOX_PATH, st.st_dev, m_proc_map);
+
+    fs::create_directories(fs::path(CRETE_SANDBOX_PATH) / "tmp");
+}
+
 // reset CRETE_SANDBOX_EXEC folder by copying m_sandbox_dir
 void RunnerFSM_::reset_sandbox()
 {
@@ -1051,32 +1202,44 @@ void RunnerFSM_::verify_invariants(const poll&)
 {
 #if !defined(CRETE_TEST)
 
-    std::ifstream ifs (m_proc_map.string().c_str());
-    std::string contents((
-        std::istreambuf_iterator<char>(ifs)),
-        std::istreambuf_iterator<char>());
+    // Only the fork server writes proc-maps, once: the processes it forks share its
+    // layout, so it is verified once and kept in place.
+    if(!m_fork_server_proc || proc_maps_hash_ == 0)
+    {
+        std::ifstream ifs (m_proc_map.string().c_str());
+        std::string contents((
+            std::istreambuf_iterator<char>(ifs)),
+            std::istreambuf_iterator<char>());
 
-    boost::hash<std::string> hash_fn;
+        boost::hash<std::string> hash_fn;
 
-    std::size_t new_hash = hash_fn(contents);
+        std::size_t new_hash = hash_fn(contents);
 
-    assert(new_hash);
+        assert(new_hash);
 
-    if(proc_maps_hash_ == 0)
-    {
-        proc_maps_hash_ = new_hash;
-    }
-    else if(new_hash != proc_maps_hash_)
-    {
-        throw std::runtime_error("proc-maps.log changed across iterations! Ensure ASLR is disabled");
+        if(proc_maps_hash_ == 0)
+        {
+            proc_maps_hash_ = new_hash;
+        }
+        else if(new_hash != proc_maps_hash_)
+        {
+            throw std::runtime_error("proc-maps.log changed across iterations! Ensure ASLR is disabled");
+        }
     }
 
     if(!m_sandbox_dir.empty())
     {
-        init_launch_folder();
-        //FIXME: xxx create dummy "proc-map.log" to prevent executable from terminating prematurely
-        std::ofstream ofs (m_proc_map.string().c_str());
-        ofs.close();
+        if(!m_fork_server_proc)
+        {
+            init_launch_folder();
+
+            //FIXME: xxx create dummy "proc-map.log" to prevent executable from terminating prematurely
+            std::ofstream ofs (m_proc_map.string().c_str());
+            ofs.close();
+        } else {
+            // The fork server is chroot-ed into the current sandbox, which must stay in place
+            clear_sandbox();
+        }
         // Provide "guest_config"
         write_configuration();
 
@@ -1215,6 +1378,7 @@ bool RunnerFSM_::is_not_first_exec(const poll&)
 Runner::Runner(int argc, char* argv[]) :
     ops_descr_(make_options()),
     fsm_(boost::make_shared<RunnerFSM>()),
+    fork_server_(false),
     stopped_(false)
 {
     parse_options(argc, argv);
@@ -1235,6 +1399,8 @@ po::options_description Runner::make_options()
             ("ip,i", po::value<std::string>(), "host IP")
             ("sandbox,s", po::value<fs::path>(), "sandbox directory")
             ("environment,v", po::value<fs::path>(), "environment file")
+            ("fork-server,f", po::bool_switch(), "fork each test from a stopped instance of the executable, "
+                    "instead of launching it anew")
         ;
 
     return desc;
@@ -1306,6 +1472,11 @@ void Runner::process_options()
 
         environment_path_ = p;
     }
+
+    if(var_map_.count("fork-server"))
+    {
+        fork_server_ = var_map_["fork-server"].as<bool>();
+    }
 }
 
 void Runner::start_FSM()
@@ -1323,7 +1494,8 @@ void Runner::run()
     start s(ip_,
             target_config_,
             sandbox_dir_,
-            environment_path_);
+            environment_path_,
+            fork_server_);
 
     fsm_->process_event(s);
 
@@ -36,6 +36,7 @@ private:
     boost::filesystem::path target_config_;
     boost::filesystem::path sandbox_dir_;
     boost::filesystem::path environment_path_;
+    bool fork_server_;
     bool stopped_;
 };
 
@@ -186,15 +186,11 @@ struct TranslationBlock {
     struct TranslationBlock *jmp_first;
 
 #if defined(CRETE_CONFIG) || 1
-    /* Indicate whether the related tcg translation context is captured:
-     * 0: not captured
-     * 1: catpured already */
-    int tcg_ctx_captured;
-    /* The index of captured llvm tb for this tb, should be matched with
-     * the index of the llvm function name translated offline:
-     * -1: not captured yet
-     * >= 0, the index of the tb */
-    int64_t index_captured_llvm_tb;
+    /* Unique over the lifetime of QEMU (never reused, even after tb_flush).
+     * Keys the per-trace state kept in RuntimeEnv, e.g. whether the tcg
+     * translation context of this tb is captured, so that translated tbs
+     * can be kept across traces. */
+    uint64_t crete_tb_id;
 
     /*  list of Customized last_opc:
      *  0xFFFF, tb ended by gen_jmp_tb() or unknown
@@ -68,12 +68,20 @@ uintptr_t tci_tb_ptr;
 
 static tcg_target_ulong tci_reg[TCG_TARGET_NB_REGS];
 
+/* Whether the taint analysis hooks run for the rest of the current block.
+ * A block starts without them and switches over at the first access that
+ * may touch taint, see crete_tci_check_host_mem() and
+ * crete_tci_check_guest_mem(). Until then no tcg register is tainted, so
+ * skipping the hooks can't miss a propagation. */
+static bool crete_tci_analyze;
+
 static tcg_target_ulong tci_read_reg(TCGReg index)
 {
     assert(index < ARRAY_SIZE(tci_reg));
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-    crete_tci_read_reg(index, tci_reg[index]);
+    if(crete_tci_analyze)
+        crete_tci_read_reg(index, tci_reg[index]);
 #endif // defined(CRETE_DEP_ANALYSIS)
 
     return tci_reg[index];
@@ -129,7 +137,8 @@ static void tci_write_reg(TCGReg index, tcg_target_ulong value)
     assert(index != TCG_REG_CALL_STACK);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-    crete_tci_write_reg(index, value);
+    if(crete_tci_analyze)
+        crete_tci_write_reg(index, value);
 #endif // defined(CRETE_DEP_ANALYSIS)
 
     tci_reg[index] = value;
@@ -484,6 +493,29 @@ static bool tci_compare64(uint64_t u0, uint64_t u1, TCGCond condition)
 # define qemu_st_beq(X)  stq_be_p(g2h(taddr), X)
 #endif
 
+static void crete_tci_enter_analysis(void)
+{
+    crete_tci_analyze = true;
+    crete_tci_next_tci_instr();
+}
+
+/* Host memory accesses go to the vcpu state or the tcg call stack */
+static void crete_tci_check_host_mem(tcg_target_ulong base, tcg_target_ulong offset,
+                                     uint64_t size)
+{
+    if(!crete_tci_analyze && crete_tci_is_host_mem_tainted(base, offset, size))
+        crete_tci_enter_analysis();
+}
+
+/* Checked on the shadow pages, as the taint can be introduced within the
+ * block, e.g. by the helper of crete_make_concolic() */
+static void crete_tci_check_guest_mem(target_ulong taddr, TCGMemOp memop)
+{
+    if(!crete_tci_analyze &&
+            crete_tci_is_guest_page_tainted(taddr, 1 << (memop & MO_SIZE)))
+        crete_tci_enter_analysis();
+}
+
 /* Interpret pseudo code in tb. */
 uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
 {
@@ -513,6 +545,8 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
     assert(get_size_current_tb_br_taken() == 0);
     );
 
+    crete_tci_analyze = false;
+
     for (;;) {
         TCGOpcode opc = tb_ptr[0];
 #if !defined(NDEBUG)
@@ -580,7 +614,8 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
                 opc == INDEX_op_st_i64)*/
 
 #endif
-        crete_tci_next_tci_instr();
+        if(crete_tci_analyze)
+            crete_tci_next_tci_instr();
 #endif // defined(CRETE_DEP_ANALYSIS)
 
         switch (opc) {
@@ -720,7 +755,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t2 = tci_read_s32(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld8u_i32(t0, t1, t2);
+            crete_tci_check_host_mem(t1, t2, 1);
+            if(crete_tci_analyze)
+                crete_tci_ld8u_i32(t0, t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg8(t0, *(uint8_t *)(t1 + t2));
@@ -756,7 +793,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
 #endif
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld_i32(t0, t1, t2);
+            crete_tci_check_host_mem(t1, t2, 4);
+            if(crete_tci_analyze)
+                crete_tci_ld_i32(t0, t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg32(t0, *(uint32_t *)(t1 + t2));
@@ -768,7 +807,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint8_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st8_i32(t1, t2);
+            crete_tci_check_host_mem(t1, t2, 1);
+            if(crete_tci_analyze)
+                crete_tci_st8_i32(t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st16_i32:
@@ -778,7 +819,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint16_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st16_i32(t1, t2);
+            crete_tci_check_host_mem(t1, t2, 2);
+            if(crete_tci_analyze)
+                crete_tci_st16_i32(t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st_i32:
@@ -807,7 +850,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
 #endif
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st_i32(t1, t2);
+            crete_tci_check_host_mem(t1, t2, 4);
+            if(crete_tci_analyze)
+                crete_tci_st_i32(t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
 
@@ -1094,7 +1139,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t2 = tci_read_s32(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld8u_i64(t0, t1, t2);
+            crete_tci_check_host_mem(t1, t2, 1);
+            if(crete_tci_analyze)
+                crete_tci_ld8u_i64(t0, t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg8(t0, *(uint8_t *)(t1 + t2));
@@ -1111,7 +1158,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t2 = tci_read_s32(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld32u_i64(t0, t1, t2);
+            crete_tci_check_host_mem(t1, t2, 4);
+            if(crete_tci_analyze)
+                crete_tci_ld32u_i64(t0, t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg32(t0, *(uint32_t *)(t1 + t2));
@@ -1122,7 +1171,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t2 = tci_read_s32(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld32s_i64(t0, t1, t2);
+            crete_tci_check_host_mem(t1, t2, 4);
+            if(crete_tci_analyze)
+                crete_tci_ld32s_i64(t0, t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg32s(t0, *(int32_t *)(t1 + t2));
@@ -1150,7 +1201,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
 #endif
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_ld_i64(t0, t1, t2);
+            crete_tci_check_host_mem(t1, t2, 8);
+            if(crete_tci_analyze)
+                crete_tci_ld_i64(t0, t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
 
             tci_write_reg64(t0, *(uint64_t *)(t1 + t2));
@@ -1162,7 +1215,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint8_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st8_i64(t1, t2);
+            crete_tci_check_host_mem(t1, t2, 1);
+            if(crete_tci_analyze)
+                crete_tci_st8_i64(t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st16_i64:
@@ -1172,7 +1227,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint16_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st16_i64(t1, t2);
+            crete_tci_check_host_mem(t1, t2, 2);
+            if(crete_tci_analyze)
+                crete_tci_st16_i64(t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st32_i64:
@@ -1182,7 +1239,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint32_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st32_i64(t1, t2);
+            crete_tci_check_host_mem(t1, t2, 4);
+            if(crete_tci_analyze)
+                crete_tci_st32_i64(t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
         case INDEX_op_st_i64:
@@ -1193,7 +1252,9 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             *(uint64_t *)(t1 + t2) = t0;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_st_i64(t1, t2);
+            crete_tci_check_host_mem(t1, t2, 8);
+            if(crete_tci_analyze)
+                crete_tci_st_i64(t1, t2);
 #endif // defined(CRETE_DEP_ANALYSIS)
 
 #if defined(CRETE_DEBUG_GENERAL)
@@ -1462,61 +1523,70 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t0 = *tb_ptr++;
             taddr = tci_read_ulong(&tb_ptr);
             memop = tci_read_i(&tb_ptr);
+            crete_tci_check_guest_mem(taddr, memop);
             switch (memop) {
             case MO_UB:
                 tmp32 = qemu_ld_ub;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld8u(t0, taddr, tmp32);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld8u(t0, taddr, tmp32);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_SB:
                 tmp32 = (int8_t)qemu_ld_ub;
 
                 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld8s(t0, taddr, tmp32);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld8s(t0, taddr, tmp32);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUW:
                 tmp32 = qemu_ld_leuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16u(t0, taddr, tmp32);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld16u(t0, taddr, tmp32);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LESW:
                 tmp32 = (int16_t)qemu_ld_leuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp32);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld16s(t0, taddr, tmp32);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUL:
                 tmp32 = qemu_ld_leul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp32);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld32s(t0, taddr, tmp32);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUW:
                 tmp32 = qemu_ld_beuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp32);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld16s(t0, taddr, tmp32);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BESW:
                 tmp32 = (int16_t)qemu_ld_beuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp32);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld16s(t0, taddr, tmp32);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUL:
                 tmp32 = qemu_ld_beul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp32);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld32s(t0, taddr, tmp32);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             default:
@@ -1538,89 +1608,102 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             }
             taddr = tci_read_ulong(&tb_ptr);
             memop = tci_read_i(&tb_ptr);
+            crete_tci_check_guest_mem(taddr, memop);
             switch (memop) {
             case MO_UB:
                 tmp64 = qemu_ld_ub;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld8u(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld8u(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_SB:
                 tmp64 = (int8_t)qemu_ld_ub;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld8u(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld8u(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUW:
                 tmp64 = qemu_ld_leuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld16s(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LESW:
                 tmp64 = (int16_t)qemu_ld_leuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld16s(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUL:
                 tmp64 = qemu_ld_leul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld32s(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
             case MO_LESL:
                 tmp64 = (int32_t)qemu_ld_leul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld32s(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
             case MO_LEQ:
                 tmp64 = qemu_ld_leq;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld64(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld64(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
             case MO_BEUW:
                 tmp64 = qemu_ld_beuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld16s(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BESW:
                 tmp64 = (int16_t)qemu_ld_beuw;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld16s(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld16s(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUL:
                 tmp64 = qemu_ld_beul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld32s(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
             break;
             case MO_BESL:
                 tmp64 = (int32_t)qemu_ld_beul;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_ld32s(t0, taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_ld32s(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEQ:
                 tmp64 = qemu_ld_beq;
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_ld64(t0, taddr, tmp64);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_ld64(t0, taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             default:
@@ -1635,50 +1718,58 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             t0 = tci_read_r(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            temp_crete_read_was_symbolic =
-                    crete_tci_get_crete_read_was_symbolic();
+            if(crete_tci_analyze)
+                temp_crete_read_was_symbolic =
+                        crete_tci_get_crete_read_was_symbolic();
 #endif
 
             taddr = tci_read_ulong(&tb_ptr);
             memop = tci_read_i(&tb_ptr);
+            crete_tci_check_guest_mem(taddr, memop);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_set_crete_read_was_symbolic(temp_crete_read_was_symbolic);
+            if(crete_tci_analyze)
+                crete_tci_set_crete_read_was_symbolic(temp_crete_read_was_symbolic);
 #endif
             switch (memop) {
             case MO_UB:
                 qemu_st_b(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st8(taddr, t0);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st8(taddr, t0);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUW:
                 qemu_st_lew(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st16(taddr, t0);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st16(taddr, t0);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUL:
                 qemu_st_lel(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st32(taddr, t0);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st32(taddr, t0);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUW:
                 qemu_st_bew(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st16(taddr, t0);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st16(taddr, t0);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUL:
                 qemu_st_bel(t0);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st32(taddr, t0);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st32(taddr, t0);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             default:
@@ -1697,14 +1788,17 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
             tmp64 = tci_read_r64(&tb_ptr);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            temp_crete_read_was_symbolic =
-                    crete_tci_get_crete_read_was_symbolic();
+            if(crete_tci_analyze)
+                temp_crete_read_was_symbolic =
+                        crete_tci_get_crete_read_was_symbolic();
 #endif
             taddr = tci_read_ulong(&tb_ptr);
             memop = tci_read_i(&tb_ptr);
+            crete_tci_check_guest_mem(taddr, memop);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_set_crete_read_was_symbolic(temp_crete_read_was_symbolic);
+            if(crete_tci_analyze)
+                crete_tci_set_crete_read_was_symbolic(temp_crete_read_was_symbolic);
 #endif
 
             switch (memop) {
@@ -1712,49 +1806,56 @@ uintptr_t crete_tcg_qemu_tb_exec(CPUArchState *env, uint8_t *tb_ptr)
                 qemu_st_b(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-            crete_tci_qemu_st8(taddr, tmp64);
+            if(crete_tci_analyze)
+                crete_tci_qemu_st8(taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUW:
                 qemu_st_lew(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st16(taddr, tmp64);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st16(taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEUL:
                 qemu_st_lel(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st32(taddr, tmp64);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st32(taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_LEQ:
                 qemu_st_leq(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st64(taddr, tmp64);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st64(taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUW:
                 qemu_st_bew(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st16(taddr, tmp64);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st16(taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEUL:
                 qemu_st_bel(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st32(taddr, tmp64);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st32(taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             case MO_BEQ:
                 qemu_st_beq(tmp64);
 
 #if defined(CRETE_DEP_ANALYSIS) || 1
-                crete_tci_qemu_st64(taddr, tmp64);
+                if(crete_tci_analyze)
+                    crete_tci_qemu_st64(taddr, tmp64);
 #endif // defined(CRETE_DEP_ANALYSIS)
                 break;
             default:
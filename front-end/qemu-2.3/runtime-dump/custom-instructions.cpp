@@ -5,9 +5,17 @@
 
 #include <boost/serialization/split_member.hpp>
 #include <boost/filesystem/fstream.hpp>
-#include <boost/unordered_set.hpp>
 #include <boost/filesystem/operations.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <crete/custom_opcode.h>
 #include <crete/debug_flags.h>
 
@@ -31,9 +39,91 @@ extern bool g_crete_is_valid_target_pid;
 //        in crete.xml from guest
 // static bool crete_flag_write_initial_input = false;
 static const string crete_trace_ready_file_name = "trace_ready";
+// Notification FIFOs created by vm_node (see cluster/common.h)
+static const string crete_trace_ready_fifo_name = "trace_ready.fifo";
+static const string crete_trace_consumed_fifo_name = "trace_consumed.fifo";
+static const string crete_trace_chunk_fifo_name = "trace_chunk.fifo";
+
+// A set of pc ranges [begin, end). Ranges are appended in O(1) and sorted/merged
+// lazily on the first lookup after an insertion, so a lookup is a binary search
+// (or a hit on the last matched range).
+class PCFilter
+{
+public:
+    PCFilter() : m_normalized(true), m_last_hit(0) {}
+
+    void insert(uint64_t begin, uint64_t end)
+    {
+        if(begin >= end)
+            return;
+
+        m_ranges.push_back(make_pair(begin, end));
+        m_normalized = false;
+    }
+
+    void clear()
+    {
+        m_ranges.clear();
+        m_normalized = true;
+        m_last_hit = 0;
+    }
+
+    bool contains(uint64_t pc)
+    {
+        if(!m_normalized)
+            normalize();
+
+        if(m_ranges.empty())
+            return false;
+
+        if(m_ranges[m_last_hit].first <= pc && pc < m_ranges[m_last_hit].second)
+            return true;
+
+        // First range beginning after pc; its predecessor is the only candidate.
+        vector<pair<uint64_t, uint64_t> >::const_iterator it =
+                upper_bound(m_ranges.begin(), m_ranges.end(),
+                        make_pair(pc, numeric_limits<uint64_t>::max()));
 
-static boost::unordered_set<uint64_t> g_pc_exclude_filters;
-static boost::unordered_set<uint64_t> g_pc_include_filters;
+        if(it == m_ranges.begin())
+            return false;
+
+        --it;
+
+        if(pc >= it->second)
+            return false;
+
+        m_last_hit = it - m_ranges.begin();
+
+        return true;
+    }
+
+private:
+    void normalize()
+    {
+        sort(m_ranges.begin(), m_ranges.end());
+
+        vector<pair<uint64_t, uint64_t> > merged;
+        for(vector<pair<uint64_t, uint64_t> >::const_iterator it = m_ranges.begin();
+                it != m_ranges.end(); ++it) {
+            if(!merged.empty() && it->first <= merged.back().second) {
+                merged.back().second = max(merged.back().second, it->second);
+            } else {
+                merged.push_back(*it);
+            }
+        }
+
+        m_ranges.swap(merged);
+        m_normalized = true;
+        m_last_hit = 0;
+    }
+
+    vector<pair<uint64_t, uint64_t> > m_ranges;
+    bool m_normalized;
+    size_t m_last_hit;
+};
+
+static PCFilter g_pc_exclude_filters;
+static PCFilter g_pc_include_filters;
 
 static uint64_t target_process_count = 0;
 static set<string> concolics_names;
@@ -171,6 +261,55 @@ static inline void crete_custom_instr_prime()
 
 namespace fs = boost::filesystem;
 
+// Opened read-write so that open() never blocks and reads never see EOF.
+// vm_node creates the fifos before starting qemu, so a missing one is an error.
+static int crete_open_hostfile_fifo(const string& name, int flags)
+{
+    fs::path fifo = fs::path("hostfile") / name;
+    int fd = open(fifo.string().c_str(), O_RDWR | O_CLOEXEC | flags);
+
+    if(fd < 0) {
+        cerr << "[CRETE ERROR] can't open " << fifo.string() << ": " << strerror(errno) << endl;
+        exit(1);
+    }
+
+    return fd;
+}
+
+// Blocks until vm_node has consumed the previous trace.
+static void crete_wait_trace_consumed()
+{
+    static int consumed_fd = crete_open_hostfile_fifo(crete_trace_consumed_fifo_name, 0);
+
+    while(fs::exists(fs::path("hostfile") / crete_trace_ready_file_name))
+    {
+        // A notification only means "check again": trace_ready is the ground truth.
+        char c;
+        while(read(consumed_fd, &c, sizeof(c)) < 0 && errno == EINTR)
+            ;
+    }
+}
+
+static void crete_notify_trace_ready()
+{
+    static int ready_fd = crete_open_hostfile_fifo(crete_trace_ready_fifo_name, O_NONBLOCK);
+
+    // A full fifo already holds pending notifications.
+    char c = 0;
+    while(write(ready_fd, &c, sizeof(c)) < 0 && errno == EINTR)
+        ;
+}
+
+// Wakes the streaming translator, waiting for the next chunk of the trace
+void crete_notify_trace_chunk()
+{
+    static int chunk_fd = crete_open_hostfile_fifo(crete_trace_chunk_fifo_name, O_NONBLOCK);
+
+    char c = 0;
+    while(write(chunk_fd, &c, sizeof(c)) < 0 && errno == EINTR)
+        ;
+}
+
 // CRETE_INSTR_DUMP_VALUE
 static inline void crete_tracing_finish()
 {
@@ -178,19 +317,22 @@ static inline void crete_tracing_finish()
     assert(runtime_env);
 
 	// Waiting for vm_node
-    while(fs::exists(crete_trace_ready_file_name))
-        ; // Wait for it to not exist. FIXME: not efficient and can hang qume.
+    crete_wait_trace_consumed();
 
     // Writing trace to file
     runtime_env->writeRtEnvToFile();
     runtime_env->printInfo();
 
-    fs::ofstream ofs(fs::path("hostfile") / crete_trace_ready_file_name);
-
-    if(!ofs.good())
     {
-        assert(0 && "can't write to crete_trace_ready_file_name");
+        fs::ofstream ofs(fs::path("hostfile") / crete_trace_ready_file_name);
+
+        if(!ofs.good())
+        {
+            assert(0 && "can't write to crete_trace_ready_file_name");
+        }
     }
+
+    crete_notify_trace_ready();
 }
 
 // CRETE_INSTR_DUMP_VALUE
@@ -198,8 +340,9 @@ static inline void crete_tracing_finish()
 static inline void crete_tracing_reset()
 {
     // Release
-    crete_runtime_dump_close(); // Cleanup must happen before tb_flush (or crash occurs).
-    tb_flush(g_cpuState_bct); // Flush tb cache, so references to runtime_env/tcg_llvm_ctx are destroyed.
+    // Translated tbs are kept across traces: the per-trace state of tbs lives
+    // in runtime_env, keyed by TranslationBlock::crete_tb_id.
+    crete_runtime_dump_close();
     assert(!runtime_env && !g_crete_flags);
 
     // reset flags
@@ -221,9 +364,7 @@ static inline void crete_custom_instr_exclude_filter()
     target_ulong addr_begin = g_cpuState_bct->regs[R_EAX];
     target_ulong addr_end = g_cpuState_bct->regs[R_ECX];
 
-    for(uint64_t i = addr_begin; i < addr_end; ++i) {
-        g_pc_exclude_filters.insert(i);
-    }
+    g_pc_exclude_filters.insert(addr_begin, addr_end);
 }
 
 // CRETE_INSTR_INCLUDE_FILTER_VALUE
@@ -233,9 +374,7 @@ static inline void crete_custom_instr_inlude_filter()
     target_ulong addr_begin = g_cpuState_bct->regs[R_EAX];
     target_ulong addr_end = g_cpuState_bct->regs[R_ECX];
 
-    for(uint64_t i = addr_begin; i < addr_end; ++i) {
-        g_pc_include_filters.insert(i);
-    }
+    g_pc_include_filters.insert(addr_begin, addr_end);
 }
 
 
@@ -330,22 +469,12 @@ void crete_custom_instruction_handler(uint64_t arg) {
 
 int crete_is_pc_in_exclude_filter_range(uint64_t pc)
 {
-    boost::unordered_set<uint64_t>::const_iterator it = g_pc_exclude_filters.find(pc);
-    if(it != g_pc_exclude_filters.end()){
-        return 1;
-    } else {
-        return 0;
-    }
+    return g_pc_exclude_filters.contains(pc) ? 1 : 0;
 }
 
 int crete_is_pc_in_include_filter_range(uint64_t pc)
 {
-    boost::unordered_set<uint64_t>::const_iterator it = g_pc_include_filters.find(pc);
-    if(it != g_pc_include_filters.end()){
-        return 1;
-    } else {
-        return 0;
-    }
+    return g_pc_include_filters.contains(pc) ? 1 : 0;
 }
 
 struct PIDWriter
@@ -23,6 +23,8 @@ enum CreteFileType {
 
 int crete_is_pc_in_exclude_filter_range(uint64_t pc);
 int crete_is_pc_in_include_filter_range(uint64_t pc);
+
+void crete_notify_trace_chunk();
 #endif
 
 #endif
@@ -12,8 +12,10 @@ extern "C" {
 
 #include <crete/test_case.h>
 #include <crete/stacktrace.h>
+#include <crete/memo_sync.h>
 
 #include <stdexcept>
+#include <algorithm>
 #include <boost/filesystem/operations.hpp>
 
 #include "custom-instructions.h"
@@ -64,6 +66,8 @@ uint64_t nb_captured_llvm_tb = 0;
 #define CPU_OFFSET(field) offsetof(CPUArchState, field)
 
 static const uint32_t CRETE_TRACING_WINDOW_SIZE = 10000;
+// Least record count of a memoSyncTable before it is compacted
+static const uint64_t CRETE_MEMO_SYNC_COMPACT_SIZE = 4096;
 
 /***********************************/
 /* External interface for C++ code */
@@ -72,7 +76,11 @@ RuntimeEnv::RuntimeEnv()
   m_streamed_tb_count(0), m_streamed_index(0),
   m_trace_tag_nodes_count(0),
   m_qemu_default_br_skipped(false),
-  m_new_tb(false)
+  m_new_tb(false),
+  m_trace_container(0),
+  m_committed_memoSyncRecords(0),
+  m_mergePoint_memoSyncTables(0),
+  m_compact_memoSyncRecords(CRETE_MEMO_SYNC_COMPACT_SIZE)
 {
     m_tlo_ctx_cpuState = new uint8_t [sizeof(CPUArchState)];
 
@@ -85,6 +93,14 @@ RuntimeEnv::RuntimeEnv()
     m_tcg_llvm_offline_ctx.dump_cpuState_size(sizeof(CPUArchState));
     m_initial_CpuState.reserve(sizeof(CPUArchState));
 
+    m_cpuStateDeltaTables.reserve(CRETE_TRACING_WINDOW_SIZE);
+    m_cpuStateDeltas.reserve(CRETE_TRACING_WINDOW_SIZE);
+    m_cpuStateDeltaData.reserve(CRETE_TRACING_WINDOW_SIZE * sizeof(uint64_t));
+
+    m_memoSyncTables.reserve(CRETE_TRACING_WINDOW_SIZE);
+    m_memoSyncRecords.reserve(CRETE_MEMO_SYNC_COMPACT_SIZE);
+    m_memoSyncData.reserve(CRETE_MEMO_SYNC_COMPACT_SIZE * sizeof(uint64_t));
+
     CRETE_DBG_INT(m_dbg_cpuState_post_interest = new uint8_t [sizeof(CPUArchState)];);
 }
 
@@ -103,17 +119,19 @@ RuntimeEnv::~RuntimeEnv()
     assert(m_dbg_cpuState_post_interest);
     delete [] (uint8_t *)m_dbg_cpuState_post_interest;
     );
+
+    delete m_trace_container;
 }
 
 // Dump the context for offline translation from qemu-ir to llvm bitcode
 // TODO: xxx Optimize the way how we trace the tcg_ctx:
 //      1. Translate from a copy of current TB,
 //      2. Only update the relevant flag of current TB if necessary for caching purpose
-void RuntimeEnv::dump_tloCtx(void *cpuState, TranslationBlock *tb, uint64_t crete_interrupted_pc)
+// Returns the index of the captured llvm tb
+uint64_t RuntimeEnv::dump_tloCtx(void *cpuState, TranslationBlock *tb, uint64_t crete_interrupted_pc)
 {
     if(crete_interrupted_pc == 0) {
-        assert(tb->tcg_ctx_captured == 0);
-        assert(tb->index_captured_llvm_tb == -1);
+        assert(get_captured_tb_index(tb) == -1);
     } else {
         assert(crete_interrupted_pc > tb->pc);
     }
@@ -158,10 +176,28 @@ void RuntimeEnv::dump_tloCtx(void *cpuState, TranslationBlock *tb, uint64_t cret
     	temp_tcg_temp.push_back(s->temps[i]);
     dump_tcg_temp(temp_tcg_temp);
 
-    tb->index_captured_llvm_tb = nb_captured_llvm_tb++;
+    uint64_t index_captured_llvm_tb = nb_captured_llvm_tb++;
 
     //for debug purpose, qemu ir
     dump_IR(s, tb);
+
+    return index_captured_llvm_tb;
+}
+
+// Returns -1 if the tcg_ctx of tb has not been captured in the current trace
+int64_t RuntimeEnv::get_captured_tb_index(const TranslationBlock *tb) const
+{
+    boost::unordered_map<uint64_t, uint64_t>::const_iterator it = m_captured_tbs.find(tb->crete_tb_id);
+
+    if(it == m_captured_tbs.end())
+        return -1;
+
+    return it->second;
+}
+
+void RuntimeEnv::set_captured_tb_index(const TranslationBlock *tb, uint64_t index)
+{
+    m_captured_tbs[tb->crete_tb_id] = index;
 }
 
 void RuntimeEnv::addInitialCpuState()
@@ -173,19 +209,22 @@ void RuntimeEnv::addInitialCpuState()
     memcpy(m_initial_CpuState.data(), m_cpuState_pre_interest.second, sizeof(CPUArchState));
 }
 
-static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchState *reference,
-        const CPUArchState *target);
+static void x86_cpuState_diff(const uint8_t *reference, const uint8_t *target,
+        vector<CPUStateDelta>& deltas, vector<uint8_t>& data);
+static CPUStateElement x86_cpuState_delta_element(const CPUStateDelta& delta,
+        const vector<uint8_t>& data);
 
 void RuntimeEnv::addcpuStateSyncTable()
 {
     assert(m_cpuState_post_insterest.first == true);
     assert(m_cpuState_pre_interest.first == true);
 
-    const CPUArchState *post_interest = (const CPUArchState *) m_cpuState_post_insterest.second;
-    const CPUArchState *pre_insterest = (const CPUArchState *) m_cpuState_pre_interest.second;
+    const uint8_t *post_interest = (const uint8_t *) m_cpuState_post_insterest.second;
+    const uint8_t *pre_insterest = (const uint8_t *) m_cpuState_pre_interest.second;
 
-    m_cpuStateSyncTables.push_back(make_pair(true,
-            x86_cpuState_compuate_side_effect(post_interest, pre_insterest)));
+    x86_cpuState_diff(post_interest, pre_insterest,
+            m_cpuStateDeltas, m_cpuStateDeltaData);
+    m_cpuStateDeltaTables.push_back(make_pair(true, (uint64_t)m_cpuStateDeltas.size()));
 
     // Invalid m_cpuState_post_insterest, after CPUState side-effect is computed
     m_cpuState_post_insterest.first = false;
@@ -193,7 +232,7 @@ void RuntimeEnv::addcpuStateSyncTable()
 
 void RuntimeEnv::addEmptyCPUStateSyncTable()
 {
-    m_cpuStateSyncTables.push_back(make_pair(false, vector<CPUStateElement>()));
+    m_cpuStateDeltaTables.push_back(make_pair(false, (uint64_t)m_cpuStateDeltas.size()));
 }
 
 vector<CPUStateElement> x86_cpuState_dump(const CPUArchState *target);
@@ -232,35 +271,150 @@ void RuntimeEnv::printDebugCpuStateSyncTable(const string name) const
     cerr << "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n";
 }
 
+// Appends a load of the current TB to the log, extending the last record when
+// the load is adjacent to it. Repeated loads of the same bytes are resolved to
+// the first one by resolveMemoSyncRecords().
 void RuntimeEnv::addCurrentMemoSyncTableEntry(uint64_t addr, uint32_t size, uint64_t value)
 {
     assert(size <= 8);
-    uint8_t byte_value;
+
+    if(m_memoSyncRecords.size() > m_committed_memoSyncRecords)
+    {
+        MemoSyncRecord& last = m_memoSyncRecords.back();
+
+        if(addr >= last.m_addr && addr + size <= last.m_addr + last.m_size)
+        {
+            return;
+        }
+
+        if(addr == last.m_addr + last.m_size)
+        {
+            for(uint64_t i = 0; i < size ; ++i){
+                m_memoSyncData.push_back((value >> i*8) & 0xff);
+            }
+            last.m_size += size;
+
+            return;
+        }
+    }
+
+    MemoSyncRecord record = {addr, size, m_memoSyncData.size()};
+    m_memoSyncRecords.push_back(record);
+
     for(uint64_t i = 0; i < size ; ++i){
-        byte_value = (value >> i*8) & 0xff;
-        m_currentMemoSyncTable.insert(make_pair(addr + i, byte_value));
+        m_memoSyncData.push_back((value >> i*8) & 0xff);
     }
 }
 
-// Add m_currentMemoSyncTable to m_memoSyncTables
+// Add the records of the current TB to m_memoSyncTables as a new table
 void RuntimeEnv::addCurrentMemoSyncTable()
 {
-    m_memoSyncTables.push_back(m_currentMemoSyncTable);
+    m_memoSyncTables.push_back(make_pair(m_committed_memoSyncRecords,
+            (uint64_t)m_memoSyncRecords.size()));
     m_mergePoint_memoSyncTables = m_memoSyncTables.size() - 1;
+    m_committed_memoSyncRecords = m_memoSyncRecords.size();
+
+    m_compact_memoSyncRecords = CRETE_MEMO_SYNC_COMPACT_SIZE;
+    compactMergePointMemoSyncTable();
 }
 
+// Add the records of the current TB to the merge point table, which is the
+// last table with records, and an empty table for the current TB
 void RuntimeEnv::mergeCurrentMemoSyncTable()
 {
     assert(m_mergePoint_memoSyncTables < m_memoSyncTables.size());
+    assert(m_memoSyncTables[m_mergePoint_memoSyncTables].second == m_committed_memoSyncRecords);
 
-    m_memoSyncTables.push_back(memoSyncTable_ty());
-    m_memoSyncTables[m_mergePoint_memoSyncTables].insert(m_currentMemoSyncTable.begin(),
-            m_currentMemoSyncTable.end());
+    m_memoSyncTables.push_back(make_pair(m_committed_memoSyncRecords, m_committed_memoSyncRecords));
+    m_memoSyncTables[m_mergePoint_memoSyncTables].second = m_memoSyncRecords.size();
+    m_committed_memoSyncRecords = m_memoSyncRecords.size();
+
+    compactMergePointMemoSyncTable();
 }
 
 void RuntimeEnv::clearCurrentMemoSyncTable()
 {
-    m_currentMemoSyncTable.clear();
+    if(m_memoSyncRecords.size() == m_committed_memoSyncRecords)
+        return;
+
+    m_memoSyncData.resize(m_memoSyncRecords[m_committed_memoSyncRecords].m_data_offset);
+    m_memoSyncRecords.resize(m_committed_memoSyncRecords);
+}
+
+// Resolve the records of a table to the first loaded value of each byte, as
+// sorted and coalesced ranges
+void RuntimeEnv::resolveMemoSyncRecords(const memoSyncTable_ty& table,
+        vector<MemoSyncRecord>& records, vector<uint8_t>& data) const
+{
+    // <<addr, load order>, value>
+    vector<pair<pair<uint64_t, uint64_t>, uint8_t> > bytes;
+
+    for(uint64_t i = table.first; i < table.second; ++i) {
+        const MemoSyncRecord& record = m_memoSyncRecords[i];
+
+        for(uint64_t j = 0; j < record.m_size; ++j) {
+            bytes.push_back(make_pair(make_pair(record.m_addr + j, i),
+                    m_memoSyncData[record.m_data_offset + j]));
+        }
+    }
+
+    sort(bytes.begin(), bytes.end());
+
+    for(vector<pair<pair<uint64_t, uint64_t>, uint8_t> >::const_iterator it = bytes.begin();
+            it != bytes.end(); ++it) {
+        uint64_t addr = it->first.first;
+
+        if(!records.empty()) {
+            MemoSyncRecord& last = records.back();
+
+            // A later load of a byte already resolved
+            if(addr < last.m_addr + last.m_size)
+                continue;
+
+            if(addr == last.m_addr + last.m_size) {
+                ++last.m_size;
+                data.push_back(it->second);
+                continue;
+            }
+        }
+
+        MemoSyncRecord record = {addr, 1, data.size()};
+        records.push_back(record);
+        data.push_back(it->second);
+    }
+}
+
+// Compact the merge point table in place once it has grown past
+// m_compact_memoSyncRecords, so that memory stays bounded by the bytes loaded
+// rather than by the number of loads
+void RuntimeEnv::compactMergePointMemoSyncTable()
+{
+    memoSyncTable_ty& table = m_memoSyncTables[m_mergePoint_memoSyncTables];
+    assert(table.second == m_memoSyncRecords.size());
+
+    if(table.second - table.first < m_compact_memoSyncRecords)
+        return;
+
+    uint64_t data_begin = m_memoSyncRecords[table.first].m_data_offset;
+    vector<MemoSyncRecord> records;
+    vector<uint8_t> data;
+
+    resolveMemoSyncRecords(table, records, data);
+
+    for(vector<MemoSyncRecord>::iterator it = records.begin();
+            it != records.end(); ++it) {
+        it->m_data_offset += data_begin;
+    }
+
+    m_memoSyncRecords.resize(table.first);
+    m_memoSyncRecords.insert(m_memoSyncRecords.end(), records.begin(), records.end());
+    m_memoSyncData.resize(data_begin);
+    m_memoSyncData.insert(m_memoSyncData.end(), data.begin(), data.end());
+
+    table.second = m_memoSyncRecords.size();
+    m_committed_memoSyncRecords = m_memoSyncRecords.size();
+    m_compact_memoSyncRecords = max(CRETE_MEMO_SYNC_COMPACT_SIZE,
+            2 * (table.second - table.first));
 }
 
 #if defined(CRETE_DBG_MEM_MONI)
@@ -441,6 +595,8 @@ void RuntimeEnv::writeRtEnvToFile()
         writeCPUStateSyncTables();
         writeDebugCPUStateSyncTables();
         writeMemoSyncTables();
+        writeChunkReady();
+        writeTraceComplete();
 
         // to-be-streamed
         writeInterruptStates();
@@ -452,6 +608,8 @@ void RuntimeEnv::writeRtEnvToFile()
         writeConcolics();
         writeTBGraphExecSequ();
         writeGuestDataPostExec();
+
+        closeTraceContainer();
     }
     catch(std::exception& e)
     {
@@ -475,6 +633,7 @@ void RuntimeEnv::stream_writeRtEnvToFile(uint64_t tb_count) {
     writeCPUStateSyncTables();
     writeDebugCPUStateSyncTables();
     writeMemoSyncTables();
+    writeChunkReady();
 
     m_streamed = true;
     m_pending_stream = false;
@@ -557,6 +716,10 @@ void RuntimeEnv::initOutputDirectory(const string& outputDirectory)
         assert(0);
     }
 
+    // Created before runtime-dump-last, which the streaming translator waits on
+    assert(!m_trace_container);
+    m_trace_container = new crete::TraceContainerWriter(getOutputFilename(crete::CRETE_TRACE_CONTAINER_NAME));
+
     fs::path dumpLast("trace");
     dumpLast /= "runtime-dump-last";
 
@@ -612,8 +775,8 @@ void RuntimeEnv::addEmptyQemuInterruptState()
  * To verify the number of dumped TBs in RuntimeEnv is valid*/
 void RuntimeEnv::verifyDumpData() const
 {
-    assert(m_cpuStateSyncTables.size() == (rt_dump_tb_count - m_streamed_tb_count) &&
-               "Something wrong in m_cpuStateSyncTables dump, its size should be equal to rt_dump_tb_count all the time.\n");
+    assert(m_cpuStateDeltaTables.size() == (rt_dump_tb_count - m_streamed_tb_count) &&
+               "Something wrong in m_cpuStateDeltaTables dump, its size should be equal to rt_dump_tb_count all the time.\n");
     assert(m_debug_cpuStateSyncTables.size() == (rt_dump_tb_count - m_streamed_tb_count) &&
                "Something wrong in m_cpuStateSyncTables dump, its size should be equal to rt_dump_tb_count all the time.\n");
 
@@ -668,9 +831,12 @@ void RuntimeEnv::set_dbgCPUStatePostInterest(const void *src)
 
 void RuntimeEnv::check_dbgCPUStatePostInterest(const void *src)
 {
-    vector<CPUStateElement> differs = x86_cpuState_compuate_side_effect((const CPUArchState *)m_dbg_cpuState_post_interest,
-            (const CPUArchState *)src);
-    if(differs.empty())
+    vector<CPUStateDelta> deltas;
+    vector<uint8_t> delta_data;
+
+    x86_cpuState_diff((const uint8_t *)m_dbg_cpuState_post_interest, (const uint8_t *)src,
+            deltas, delta_data);
+    if(deltas.empty())
     {
         CRETE_DBG_GEN(
         cerr << "check_dbgCPUStatePostInterest(): passed\n";
@@ -684,18 +850,20 @@ void RuntimeEnv::check_dbgCPUStatePostInterest(const void *src)
     uint8_t* post_interest_cpuState = (uint8_t*)m_dbg_cpuState_post_interest;
     uint8_t* current_cpuState = (uint8_t*)src;
 
-    for(vector<CPUStateElement>::const_iterator it = differs.begin();
-            it != differs.end(); ++it) {
-        cerr << it->m_name << ": " << it->m_size << " bytes\n";
+    for(vector<CPUStateDelta>::const_iterator delta = deltas.begin();
+            delta != deltas.end(); ++delta) {
+        const CPUStateElement element = x86_cpuState_delta_element(*delta, delta_data);
+
+        cerr << element.m_name << ": " << element.m_size << " bytes\n";
         cerr << " post_interest_value :[";
-        for(uint64_t i = 0; i < it->m_size; ++i) {
-            cerr << " 0x"<< hex << (uint32_t)*(post_interest_cpuState + it->m_offset + i);
+        for(uint64_t i = 0; i < element.m_size; ++i) {
+            cerr << " 0x"<< hex << (uint32_t)*(post_interest_cpuState + element.m_offset + i);
         }
         cerr << "]\n";
 
         cerr << " current_value :[";
-        for(uint64_t i = 0; i < it->m_size; ++i) {
-            cerr << " 0x"<< hex << (uint32_t)*(current_cpuState + it->m_offset + i);
+        for(uint64_t i = 0; i < element.m_size; ++i) {
+            cerr << " 0x"<< hex << (uint32_t)*(current_cpuState + element.m_offset + i);
         }
 
         cerr << "]\n";
@@ -782,9 +950,8 @@ void RuntimeEnv::writeTcgLlvmCtx()
 {
     stringstream ss;
     ss << "dump_tcg_llvm_offline." << m_streamed_index << ".bin";
-    ofstream ofs(getOutputFilename(ss.str()).c_str(), ios_base::binary);
+    ostringstream ofs(ios_base::binary);
 
-    assert(ofs.good());
 	try {
         boost::archive::binary_oarchive oa(ofs);
 	    oa << m_tcg_llvm_offline_ctx;
@@ -793,9 +960,30 @@ void RuntimeEnv::writeTcgLlvmCtx()
 	    cerr << e.what() << endl;
 	}
 
+    addTraceSection(ss.str(), ofs.str());
+
     m_tcg_llvm_offline_ctx = TCGLLVMOfflineContext();
 }
 
+// Signal the streaming translator that all files of the current chunk are
+// written, see translator's option --stream
+void RuntimeEnv::writeChunkReady()
+{
+    stringstream ss;
+    ss << "dump_chunk_ready." << m_streamed_index;
+    addTraceSection(ss.str(), string());
+
+    crete_notify_trace_chunk();
+}
+
+// Signal the streaming translator that no chunk follows the current one
+void RuntimeEnv::writeTraceComplete()
+{
+    addTraceSection("dump_trace_complete", string());
+
+    crete_notify_trace_chunk();
+}
+
 string RuntimeEnv::getOutputFilename(const string &fileName) const
 {
     fs::path filePath(m_outputDirectory);
@@ -803,6 +991,19 @@ string RuntimeEnv::getOutputFilename(const string &fileName) const
     return filePath.string();
 }
 
+void RuntimeEnv::addTraceSection(const string &name, const string &data)
+{
+    assert(m_trace_container && "trace container is created by initOutputDirectory()");
+    m_trace_container->add_section(name, data);
+}
+
+// Index the trace container; the trace is complete
+void RuntimeEnv::closeTraceContainer()
+{
+    assert(m_trace_container);
+    m_trace_container->close();
+}
+
 void RuntimeEnv::writeConcolics()
 {
     assert(!m_concolics.empty());
@@ -891,40 +1092,36 @@ void RuntimeEnv::writeMemoSyncTables()
 {
     stringstream ss;
     ss << "dump_new_sync_memos." << m_streamed_index << ".bin";
-    ofstream o_sm(getOutputFilename(ss.str()).c_str(), ios_base::binary);
+    ostringstream o_sm(ios_base::binary);
 
-    assert(o_sm.good());
+    // See crete/memo_sync.h for the format
+    crete::write_memo_sync_count(o_sm, m_memoSyncTables.size());
 
-    // boost::unordered_map is not supported by boost::serialization
-    // Covert boost::unordered_map to vector< pair<> >
-    vector<vector<pair<uint64_t, uint8_t> > > to_serialize;
-    to_serialize.reserve(m_memoSyncTables.size());
+    vector<MemoSyncRecord> records;
+    vector<uint8_t> data;
 
     for(memoSyncTables_ty::const_iterator it = m_memoSyncTables.begin();
             it != m_memoSyncTables.end(); ++it) {
-        vector<pair<uint64_t, uint8_t> > temp_memSyncTable;
-        temp_memSyncTable.reserve(it->size());
+        records.clear();
+        data.clear();
+        resolveMemoSyncRecords(*it, records, data);
 
-        for(memoSyncTable_ty::const_iterator in_it = it->begin();
-                in_it != it->end(); ++in_it) {
-            temp_memSyncTable.push_back(*in_it);
-        }
+        crete::write_memo_sync_count(o_sm, records.size());
 
-        assert(temp_memSyncTable.size() == it->size());
-        to_serialize.push_back(temp_memSyncTable);
+        for(vector<MemoSyncRecord>::const_iterator r_it = records.begin();
+                r_it != records.end(); ++r_it) {
+            crete::write_memo_sync_range(o_sm, r_it->m_addr, r_it->m_size,
+                    &data[r_it->m_data_offset]);
+        }
     }
 
-    assert(to_serialize.size() == m_memoSyncTables.size());
-
-    try {
-        boost::archive::binary_oarchive oa(o_sm);
-        oa << to_serialize;
-    }
-    catch(std::exception &e){
-        cerr << e.what() << endl;
-    }
+    addTraceSection(ss.str(), o_sm.str());
 
+    // Keeps the capacity of the logs for the next tables
     m_memoSyncTables.clear();
+    m_memoSyncRecords.clear();
+    m_memoSyncData.clear();
+    m_committed_memoSyncRecords = 0;
 }
 
 #if defined(CRETE_DBG_MEM_MONI)
@@ -1002,7 +1199,7 @@ void RuntimeEnv::debug_writeMemoSyncTables()
         if(m_debug_memoMergePoints[i] == OutofInterestTb ||
                 m_debug_memoMergePoints[i] == NormalTb) {
             assert(m_debug_memoSyncTables[i].empty() && "Something is wrong in debug_mergeMemoSyncTables().\n");
-            assert(m_memoSyncTables[i].empty());
+            assert(m_memoSyncTables[i].first == m_memoSyncTables[i].second);
         }
     }
 
@@ -1158,7 +1355,7 @@ void RuntimeEnv::print_memoSyncTables()
     cerr << "[memoSyncTables:]\n";
     for(uint64_t temp_tb_count = 0; temp_tb_count < m_debug_memoSyncTables.size();
             ++temp_tb_count){
-        if(m_memoSyncTables[temp_tb_count].empty()){
+        if(m_memoSyncTables[temp_tb_count].first == m_memoSyncTables[temp_tb_count].second){
             assert(m_debug_memoSyncTables[temp_tb_count].empty());
             cerr << "===================================================================\n";
             cerr << "tb_count: " << dec << temp_tb_count<< ": NULL\n";
@@ -1169,10 +1366,18 @@ void RuntimeEnv::print_memoSyncTables()
             cerr << "tb_count: " << dec << temp_tb_count << endl;
             cerr << "===================================================================\n";
 
-            cerr << "memoSyncTables size = " << m_memoSyncTables[temp_tb_count].size() << "\n";
-            for(memoSyncTable_ty::iterator m_it = m_memoSyncTables[temp_tb_count].begin();
-                    m_it != m_memoSyncTables[temp_tb_count].end(); ++m_it){
-                cerr << hex << "0x" << m_it->first << ": (0x " << (uint64_t)m_it->second  << "); ";
+            vector<MemoSyncRecord> records;
+            vector<uint8_t> data;
+            resolveMemoSyncRecords(m_memoSyncTables[temp_tb_count], records, data);
+
+            cerr << "memoSyncTables size = " << records.size() << "\n";
+            for(vector<MemoSyncRecord>::iterator m_it = records.begin();
+                    m_it != records.end(); ++m_it){
+                cerr << hex << "0x" << m_it->m_addr << ": (0x " << m_it->m_size << ", 0x ";
+                for(uint64_t i = 0; i < m_it->m_size; ++i) {
+                    cerr << (uint32_t)data[m_it->m_data_offset + i] << " ";
+                }
+                cerr << "); ";
             }
 
             cerr << "---------------------------------------------------------------------\n"
@@ -1198,11 +1403,8 @@ void RuntimeEnv::writeInitialCpuState()
 {
     assert(m_initial_CpuState.size() == sizeof(CPUArchState));
 
-    ofstream o_sm(getOutputFilename("dump_initial_cpuState.bin").c_str(),
-                ios_base::binary);
-    assert(o_sm && "Create file failed: dump_initial_cpuState.bin\n");
-    o_sm.write((const char*)m_initial_CpuState.data(), sizeof(CPUArchState));
-    o_sm.clear();
+    addTraceSection("dump_initial_cpuState.bin",
+            string((const char*)m_initial_CpuState.data(), sizeof(CPUArchState)));
 
     m_initial_CpuState.clear();
 }
@@ -1225,11 +1427,11 @@ void RuntimeEnv::writeDebugCpuStateOffsets()
 }
 
 
-void RuntimeEnv::checkEmptyCPUStateSyncTables()
+void RuntimeEnv::checkEmptyCPUStateSyncTables(vector<cpuStateSyncTable_ty>& cpuStateSyncTables) const
 {
     uint64_t tb_count = 0;
-    for(vector<cpuStateSyncTable_ty>::iterator it = m_cpuStateSyncTables.begin();
-            it != m_cpuStateSyncTables.end(); ++it) {
+    for(vector<cpuStateSyncTable_ty>::iterator it = cpuStateSyncTables.begin();
+            it != cpuStateSyncTables.end(); ++it) {
         if(it->first && it->second.empty()) {
             it->first = false;
 
@@ -1245,23 +1447,43 @@ void RuntimeEnv::checkEmptyCPUStateSyncTables()
 
 void RuntimeEnv::writeCPUStateSyncTables()
 {
-    checkEmptyCPUStateSyncTables();
+    // Expand the deltas into the serialized format, naming their fields
+    vector<cpuStateSyncTable_ty> cpuStateSyncTables;
+    cpuStateSyncTables.reserve(m_cpuStateDeltaTables.size());
+
+    uint64_t delta = 0;
+    for(vector<cpuStateDeltaTable_ty>::const_iterator it = m_cpuStateDeltaTables.begin();
+            it != m_cpuStateDeltaTables.end(); ++it) {
+        cpuStateSyncTables.push_back(make_pair(it->first, vector<CPUStateElement>()));
+
+        vector<CPUStateElement>& elements = cpuStateSyncTables.back().second;
+        elements.reserve(it->second - delta);
+
+        for(; delta < it->second; ++delta) {
+            elements.push_back(x86_cpuState_delta_element(m_cpuStateDeltas[delta], m_cpuStateDeltaData));
+        }
+    }
+
+    checkEmptyCPUStateSyncTables(cpuStateSyncTables);
 
     stringstream ss;
     ss << "dump_sync_cpu_states." << m_streamed_index << ".bin";
-    ofstream o_sm(getOutputFilename(ss.str()).c_str(), ios_base::binary);
-
-    assert(o_sm.good() && "Create file failed: dump_sync_cpu_states.bin\n");
+    ostringstream o_sm(ios_base::binary);
 
     try {
         boost::archive::binary_oarchive oa(o_sm);
-        oa << m_cpuStateSyncTables;
+        oa << cpuStateSyncTables;
     }
     catch(std::exception &e){
         cerr << e.what() << endl;
     }
 
-    m_cpuStateSyncTables.clear();
+    addTraceSection(ss.str(), o_sm.str());
+
+    // Keeps the capacity of the arenas for the next tables
+    m_cpuStateDeltaTables.clear();
+    m_cpuStateDeltas.clear();
+    m_cpuStateDeltaData.clear();
 }
 
 void RuntimeEnv::writeDebugCPUStateSyncTables()
@@ -1650,9 +1872,7 @@ void RuntimeEnv::add_new_tb_pc(const uint64_t current_tb_pc)
 
 void RuntimeEnv::writeGuestDataPostExec()
 {
-    ofstream o_sm(getOutputFilename(CRETE_FILENAME_GUEST_DATA_POST_EXEC).c_str(),
-            ios_base::binary);
-    assert(o_sm.good());
+    ostringstream o_sm(ios_base::binary);
 
     try {
         boost::archive::binary_oarchive oa(o_sm);
@@ -1661,6 +1881,8 @@ void RuntimeEnv::writeGuestDataPostExec()
     catch(std::exception &e){
         cerr << e.what() << endl;
     }
+
+    addTraceSection(CRETE_FILENAME_GUEST_DATA_POST_EXEC, o_sm.str());
 }
 
 void RuntimeEnv::handleCreteVoidTargetPid()
@@ -1968,19 +2190,22 @@ int crete_post_cpu_tb_exec(void *qemuCpuState, TranslationBlock *input_tb, uint6
 	        }
 
 	        // 1. instruction sequence and its translation context
+	        assert(runtime_env != NULL);
+	        int64_t index_captured_llvm_tb;
 	        if(crete_interrupted_pc != 0){
-	            assert(runtime_env != NULL);
-	            runtime_env->dump_tloCtx(qemuCpuState, &tb, crete_interrupted_pc);
-	        } else if(tb.tcg_ctx_captured == 0){
-	          assert(runtime_env != NULL);
-	          runtime_env->dump_tloCtx(qemuCpuState, &tb, 0);
-
-	          // Set flag for caching traced tcg_ctx
-	          input_tb->tcg_ctx_captured = 1;
-	          input_tb->index_captured_llvm_tb = tb.index_captured_llvm_tb;
+	            index_captured_llvm_tb = runtime_env->dump_tloCtx(qemuCpuState, &tb, crete_interrupted_pc);
+	        } else {
+	            index_captured_llvm_tb = runtime_env->get_captured_tb_index(&tb);
+
+	            if(index_captured_llvm_tb == -1) {
+	                index_captured_llvm_tb = runtime_env->dump_tloCtx(qemuCpuState, &tb, 0);
+
+	                // Cache traced tcg_ctx for the rest of this trace
+	                runtime_env->set_captured_tb_index(&tb, index_captured_llvm_tb);
+	            }
 	        }
 
-	        runtime_env->addTBExecSequ(tb.index_captured_llvm_tb, tb.pc);
+	        runtime_env->addTBExecSequ(index_captured_llvm_tb, tb.pc);
 
 	        // 2. CPUState tracing:
 	        // 2.1 calculate CPUState side-effects for TBs that are "BackToInterestTb"
@@ -2290,45 +2515,24 @@ int crete_flags_is_true(struct CreteFlags *cf)
 	return cf->is_true();
 }
 
-#define __CRETE_CALC_CPU_SIDE_EFFECT(in_type, in_name)                              \
-        if(memcmp(&reference->in_name, &target->in_name, sizeof(in_type)) != 0)     \
-        {                                                                           \
-            offset = CPU_OFFSET(in_name);                                           \
-            size   = sizeof(in_type);                                               \
-            name.str(string());                                                     \
-            name << #in_name;                                                       \
-            data.clear();                                                           \
-                                                                                    \
-            for(uint64_t j=0; j < size; ++j) {                                      \
-                data.push_back(*(uint8_t *)(((uint8_t *)target)                     \
-                        + offset + j));                                             \
-            }                                                                       \
-                                                                                    \
-            ret.push_back(CPUStateElement(offset, size, name.str(), data));         \
-        }
-
+#define __CRETE_CPU_STATE_FIELD(in_type, in_name)                                   \
+        ret.push_back(x86_cpuState_field(CPU_OFFSET(in_name), sizeof(in_type),      \
+                #in_name, -1));
 
-#define __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(in_type, in_name, array_size)            \
+#define __CRETE_CPU_STATE_FIELD_ARRAY(in_type, in_name, array_size)                 \
         for(uint64_t i = 0; i < (array_size); ++i)                                  \
         {                                                                           \
-            if(memcmp(&reference->in_name[i], &target->in_name[i],                  \
-                    sizeof(in_type)) != 0)                                          \
-            {                                                                       \
-                offset = CPU_OFFSET(in_name) + i*sizeof(in_type);                   \
-                size   = sizeof(in_type);                                           \
-                name.str(string());                                                 \
-                name << #in_name << "[" << dec << i << "]";                         \
-                data.clear();                                                       \
-                                                                                    \
-                for(uint64_t j=0; j < size; ++j) {                                  \
-                    data.push_back(*(uint8_t *)(((uint8_t *)target)                 \
-                            + offset + j));                                         \
-                }                                                                   \
-                                                                                    \
-                ret.push_back(CPUStateElement(offset, size, name.str(), data));     \
-            }                                                                       \
+            ret.push_back(x86_cpuState_field(CPU_OFFSET(in_name) + i*sizeof(in_type),\
+                    sizeof(in_type), #in_name, i));                                 \
         }
 
+static CPUStateField x86_cpuState_field(uint64_t offset, uint64_t size,
+        const char *name, int32_t index)
+{
+    CPUStateField field = {(uint32_t)offset, (uint32_t)size, name, index};
+    return field;
+}
+
 // List of CPUState being ignored by cpuStateSyncTable
 //  Element:                            Reason
 // +--------------------------------+----------------------------+
@@ -2340,213 +2544,206 @@ int crete_flags_is_true(struct CreteFlags *cf)
 // int old_exception;                 Irrelevant + cannot trace
 // CPU_COMMON and all below           Irrelevant
 
-// Compare two cpu states, return the different elements of target cpu state
-static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchState *reference,
-        const CPUArchState *target) {
-    vector<CPUStateElement> ret;
-    ret.clear();
-
-    uint64_t offset;
-    uint64_t size;
-    stringstream name;
-    vector<uint8_t> data;
+// The cpu state fields being traced by cpuStateSyncTable
+static vector<CPUStateField> x86_cpuState_fields() {
+    vector<CPUStateField> ret;
 
     /* standard registers */
     // target_ulong regs[CPU_NB_REGS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(target_ulong, regs, CPU_NB_REGS)
+    __CRETE_CPU_STATE_FIELD_ARRAY(target_ulong, regs, CPU_NB_REGS)
 
 //xxx: not traced
 // target_ulong eip;
 
    // target_ulong eflags;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, eflags)
+    __CRETE_CPU_STATE_FIELD(target_ulong, eflags)
 
     /* emulator internal eflags handling */
     // target_ulong cc_dst;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, cc_dst)
+    __CRETE_CPU_STATE_FIELD(target_ulong, cc_dst)
     // target_ulong cc_src;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, cc_src)
+    __CRETE_CPU_STATE_FIELD(target_ulong, cc_src)
     // target_ulong cc_src2;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, cc_src2)
+    __CRETE_CPU_STATE_FIELD(target_ulong, cc_src2)
     //uint32_t cc_op;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, cc_op);
+    __CRETE_CPU_STATE_FIELD(uint32_t, cc_op);
 
     // int32_t df;
-    __CRETE_CALC_CPU_SIDE_EFFECT(int32_t, df)
+    __CRETE_CPU_STATE_FIELD(int32_t, df)
     // uint32_t hflags;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, hflags)
+    __CRETE_CPU_STATE_FIELD(uint32_t, hflags)
     // uint32_t hflags2;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, hflags2)
+    __CRETE_CPU_STATE_FIELD(uint32_t, hflags2)
 
     /* segments */
     // SegmentCache segs[6];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(SegmentCache, segs, 6)
+    __CRETE_CPU_STATE_FIELD_ARRAY(SegmentCache, segs, 6)
     // SegmentCache ldt;
-    __CRETE_CALC_CPU_SIDE_EFFECT(SegmentCache, ldt)
+    __CRETE_CPU_STATE_FIELD(SegmentCache, ldt)
     // SegmentCache tr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(SegmentCache, tr)
+    __CRETE_CPU_STATE_FIELD(SegmentCache, tr)
     // SegmentCache gdt;
-    __CRETE_CALC_CPU_SIDE_EFFECT(SegmentCache, gdt)
+    __CRETE_CPU_STATE_FIELD(SegmentCache, gdt)
     // SegmentCache idt;
-    __CRETE_CALC_CPU_SIDE_EFFECT(SegmentCache, idt)
+    __CRETE_CPU_STATE_FIELD(SegmentCache, idt)
 
 // xxx: not traced
 // target_ulong cr[5];
-//    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(target_ulong, cr, 5)
+//    __CRETE_CPU_STATE_FIELD_ARRAY(target_ulong, cr, 5)
 
     // int32_t a20_mask;
-    __CRETE_CALC_CPU_SIDE_EFFECT(int32_t, a20_mask)
+    __CRETE_CPU_STATE_FIELD(int32_t, a20_mask)
 
     // BNDReg bnd_regs[4];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(BNDReg, bnd_regs, 4)
+    __CRETE_CPU_STATE_FIELD_ARRAY(BNDReg, bnd_regs, 4)
     // BNDCSReg bndcs_regs;
-    __CRETE_CALC_CPU_SIDE_EFFECT(BNDCSReg, bndcs_regs)
+    __CRETE_CPU_STATE_FIELD(BNDCSReg, bndcs_regs)
     // uint64_t msr_bndcfgs;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_bndcfgs)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_bndcfgs)
 
     /* Beginning of state preserved by INIT (dummy marker).  */
 //xxx: not traced
 //    struct {} start_init_save;
-//    __CRETE_CALC_CPU_SIDE_EFFECT(struct {}, start_init_save)
+//    __CRETE_CPU_STATE_FIELD(struct {}, start_init_save)
 
     /* FPU state */
     // unsigned int fpstt;
-    __CRETE_CALC_CPU_SIDE_EFFECT(unsigned int, fpstt)
+    __CRETE_CPU_STATE_FIELD(unsigned int, fpstt)
     // uint16_t fpus;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, fpus)
+    __CRETE_CPU_STATE_FIELD(uint16_t, fpus)
     // uint16_t fpuc;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, fpuc)
+    __CRETE_CPU_STATE_FIELD(uint16_t, fpuc)
     // uint8_t fptags[8];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint8_t, fptags, 8)
+    __CRETE_CPU_STATE_FIELD_ARRAY(uint8_t, fptags, 8)
     // FPReg fpregs[8];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(FPReg, fpregs, 8)
+    __CRETE_CPU_STATE_FIELD_ARRAY(FPReg, fpregs, 8)
     /* KVM-only so far */
     // uint16_t fpop;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, fpop)
+    __CRETE_CPU_STATE_FIELD(uint16_t, fpop)
     // uint64_t fpip;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, fpip)
+    __CRETE_CPU_STATE_FIELD(uint64_t, fpip)
     // uint64_t fpdp;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, fpdp)
+    __CRETE_CPU_STATE_FIELD(uint64_t, fpdp)
 
     /* emulator internal variables */
     // float_status fp_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(float_status, fp_status)
+    __CRETE_CPU_STATE_FIELD(float_status, fp_status)
     // floatx80 ft0;
-    __CRETE_CALC_CPU_SIDE_EFFECT(floatx80, ft0)
+    __CRETE_CPU_STATE_FIELD(floatx80, ft0)
 
     // float_status mmx_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(float_status, mmx_status)
+    __CRETE_CPU_STATE_FIELD(float_status, mmx_status)
     // float_status sse_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(float_status, sse_status)
+    __CRETE_CPU_STATE_FIELD(float_status, sse_status)
     // uint32_t mxcsr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, mxcsr)
+    __CRETE_CPU_STATE_FIELD(uint32_t, mxcsr)
     // XMMReg xmm_regs[CPU_NB_REGS == 8 ? 8 : 32];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(XMMReg, xmm_regs, CPU_NB_REGS == 8 ? 8 : 32)
+    __CRETE_CPU_STATE_FIELD_ARRAY(XMMReg, xmm_regs, CPU_NB_REGS == 8 ? 8 : 32)
     // XMMReg xmm_t0;
-    __CRETE_CALC_CPU_SIDE_EFFECT(XMMReg, xmm_t0)
+    __CRETE_CPU_STATE_FIELD(XMMReg, xmm_t0)
     // MMXReg mmx_t0;
-    __CRETE_CALC_CPU_SIDE_EFFECT(MMXReg, mmx_t0)
+    __CRETE_CPU_STATE_FIELD(MMXReg, mmx_t0)
 
     // uint64_t opmask_regs[NB_OPMASK_REGS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint64_t, opmask_regs, NB_OPMASK_REGS)
+    __CRETE_CPU_STATE_FIELD_ARRAY(uint64_t, opmask_regs, NB_OPMASK_REGS)
 
     /* sysenter registers */
     // uint32_t sysenter_cs;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, sysenter_cs)
+    __CRETE_CPU_STATE_FIELD(uint32_t, sysenter_cs)
     // target_ulong sysenter_esp;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, sysenter_esp)
+    __CRETE_CPU_STATE_FIELD(target_ulong, sysenter_esp)
     // target_ulong sysenter_eip;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, sysenter_eip)
+    __CRETE_CPU_STATE_FIELD(target_ulong, sysenter_eip)
     // uint64_t efer;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, efer)
+    __CRETE_CPU_STATE_FIELD(uint64_t, efer)
     // uint64_t star;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, star)
+    __CRETE_CPU_STATE_FIELD(uint64_t, star)
 
     // uint64_t vm_hsave;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, vm_hsave)
+    __CRETE_CPU_STATE_FIELD(uint64_t, vm_hsave)
 
 #ifdef TARGET_X86_64
     // target_ulong lstar;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, lstar)
+    __CRETE_CPU_STATE_FIELD(target_ulong, lstar)
     // target_ulong cstar;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, cstar)
+    __CRETE_CPU_STATE_FIELD(target_ulong, cstar)
     // target_ulong fmask;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, fmask)
+    __CRETE_CPU_STATE_FIELD(target_ulong, fmask)
     // target_ulong kernelgsbase;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, kernelgsbase)
+    __CRETE_CPU_STATE_FIELD(target_ulong, kernelgsbase)
 #endif
 
     // uint64_t tsc;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, tsc)
+    __CRETE_CPU_STATE_FIELD(uint64_t, tsc)
     // uint64_t tsc_adjust;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, tsc_adjust)
+    __CRETE_CPU_STATE_FIELD(uint64_t, tsc_adjust)
     // uint64_t tsc_deadline;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, tsc_deadline)
+    __CRETE_CPU_STATE_FIELD(uint64_t, tsc_deadline)
 
     // uint64_t mcg_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, mcg_status)
+    __CRETE_CPU_STATE_FIELD(uint64_t, mcg_status)
     // uint64_t msr_ia32_misc_enable;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_ia32_misc_enable)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_ia32_misc_enable)
     // uint64_t msr_ia32_feature_control;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_ia32_feature_control)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_ia32_feature_control)
 
     // uint64_t msr_fixed_ctr_ctrl;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_fixed_ctr_ctrl)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_fixed_ctr_ctrl)
     // uint64_t msr_global_ctrl;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_global_ctrl)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_global_ctrl)
     // uint64_t msr_global_status;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_global_status)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_global_status)
     // uint64_t msr_global_ovf_ctrl;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_global_ovf_ctrl)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_global_ovf_ctrl)
     // uint64_t msr_fixed_counters[MAX_FIXED_COUNTERS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint64_t, msr_fixed_counters, MAX_FIXED_COUNTERS)
+    __CRETE_CPU_STATE_FIELD_ARRAY(uint64_t, msr_fixed_counters, MAX_FIXED_COUNTERS)
     // uint64_t msr_gp_counters[MAX_GP_COUNTERS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint64_t, msr_gp_counters, MAX_GP_COUNTERS)
+    __CRETE_CPU_STATE_FIELD_ARRAY(uint64_t, msr_gp_counters, MAX_GP_COUNTERS)
     // uint64_t msr_gp_evtsel[MAX_GP_COUNTERS];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(uint64_t, msr_gp_evtsel, MAX_GP_COUNTERS)
+    __CRETE_CPU_STATE_FIELD_ARRAY(uint64_t, msr_gp_evtsel, MAX_GP_COUNTERS)
 
     // uint64_t pat;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, pat)
+    __CRETE_CPU_STATE_FIELD(uint64_t, pat)
     // uint32_t smbase;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, smbase)
+    __CRETE_CPU_STATE_FIELD(uint32_t, smbase)
 
     /* End of state preserved by INIT (dummy marker).  */
 // xxx: not traced
 //    struct {} end_init_save;
-//    __CRETE_CALC_CPU_SIDE_EFFECT(struct {}, end_init_save)
+//    __CRETE_CPU_STATE_FIELD(struct {}, end_init_save)
 
     // uint64_t system_time_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, system_time_msr)
+    __CRETE_CPU_STATE_FIELD(uint64_t, system_time_msr)
     // uint64_t wall_clock_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, wall_clock_msr)
+    __CRETE_CPU_STATE_FIELD(uint64_t, wall_clock_msr)
     // uint64_t steal_time_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, steal_time_msr)
+    __CRETE_CPU_STATE_FIELD(uint64_t, steal_time_msr)
     // uint64_t async_pf_en_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, async_pf_en_msr)
+    __CRETE_CPU_STATE_FIELD(uint64_t, async_pf_en_msr)
     // uint64_t pv_eoi_en_msr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, pv_eoi_en_msr)
+    __CRETE_CPU_STATE_FIELD(uint64_t, pv_eoi_en_msr)
 
     // uint64_t msr_hv_hypercall;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_hv_hypercall)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_hv_hypercall)
     // uint64_t msr_hv_guest_os_id;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_hv_guest_os_id)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_hv_guest_os_id)
     // uint64_t msr_hv_vapic;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_hv_vapic)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_hv_vapic)
     // uint64_t msr_hv_tsc;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, msr_hv_tsc)
+    __CRETE_CPU_STATE_FIELD(uint64_t, msr_hv_tsc)
 
     /* exception/interrupt handling */
 
 // xxx: not traced
 // int error_code;
-//    __CRETE_CALC_CPU_SIDE_EFFECT(int, error_code)
+//    __CRETE_CPU_STATE_FIELD(int, error_code)
 
     // int exception_is_int;
-    __CRETE_CALC_CPU_SIDE_EFFECT(int, exception_is_int)
+    __CRETE_CPU_STATE_FIELD(int, exception_is_int)
     // target_ulong exception_next_eip;
-    __CRETE_CALC_CPU_SIDE_EFFECT(target_ulong, exception_next_eip)
+    __CRETE_CPU_STATE_FIELD(target_ulong, exception_next_eip)
     // target_ulong dr[8];
-    __CRETE_CALC_CPU_SIDE_EFFECT_ARRAY(target_ulong, dr, 8)
+    __CRETE_CPU_STATE_FIELD_ARRAY(target_ulong, dr, 8)
 
 //xxx: not traced
 //    union {
@@ -2555,31 +2752,31 @@ static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchSt
 //    };
 
     // int old_exception;
-    __CRETE_CALC_CPU_SIDE_EFFECT(int, old_exception)
+    __CRETE_CPU_STATE_FIELD(int, old_exception)
     // uint64_t vm_vmcb;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, vm_vmcb)
+    __CRETE_CPU_STATE_FIELD(uint64_t, vm_vmcb)
     // uint64_t tsc_offset;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, tsc_offset)
+    __CRETE_CPU_STATE_FIELD(uint64_t, tsc_offset)
     // uint64_t intercept;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint64_t, intercept)
+    __CRETE_CPU_STATE_FIELD(uint64_t, intercept)
     // uint16_t intercept_cr_read;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, intercept_cr_read)
+    __CRETE_CPU_STATE_FIELD(uint16_t, intercept_cr_read)
     // uint16_t intercept_cr_write;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, intercept_cr_write)
+    __CRETE_CPU_STATE_FIELD(uint16_t, intercept_cr_write)
     // uint16_t intercept_dr_read;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, intercept_dr_read)
+    __CRETE_CPU_STATE_FIELD(uint16_t, intercept_dr_read)
     // uint16_t intercept_dr_write;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint16_t, intercept_dr_write)
+    __CRETE_CPU_STATE_FIELD(uint16_t, intercept_dr_write)
     // uint32_t intercept_exceptions;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint32_t, intercept_exceptions)
+    __CRETE_CPU_STATE_FIELD(uint32_t, intercept_exceptions)
     // uint8_t v_tpr;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint8_t, v_tpr)
+    __CRETE_CPU_STATE_FIELD(uint8_t, v_tpr)
 
     /* KVM states, automatically cleared on reset */
     // uint8_t nmi_injected;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint8_t, nmi_injected)
+    __CRETE_CPU_STATE_FIELD(uint8_t, nmi_injected)
     // uint8_t nmi_pending;
-    __CRETE_CALC_CPU_SIDE_EFFECT(uint8_t, nmi_pending)
+    __CRETE_CPU_STATE_FIELD(uint8_t, nmi_pending)
 
 // TODO: xxx not traced
 //    CPU_COMMON
@@ -2630,6 +2827,125 @@ static vector<CPUStateElement> x86_cpuState_compuate_side_effect(const CPUArchSt
     return ret;
 }
 
+static const uint64_t CRETE_CPU_STATE_DIFF_BLOCK_SIZE = 64;
+
+static bool cpuState_field_less(const CPUStateField& lhs, const CPUStateField& rhs)
+{
+    return lhs.m_offset < rhs.m_offset;
+}
+
+// Traced cpu state fields sorted by offset, with the index of the first field
+// overlapping each 8-byte word of [m_begin, m_end), so that two cpu states are
+// compared word by word and only the fields of differing words are looked at.
+class CPUStateFieldTable
+{
+public:
+    CPUStateFieldTable()
+    : m_fields(x86_cpuState_fields())
+    {
+        assert(!m_fields.empty());
+        sort(m_fields.begin(), m_fields.end(), cpuState_field_less);
+
+        m_begin = m_fields.front().m_offset & ~(uint64_t)(sizeof(uint64_t) - 1);
+        m_end = (m_fields.back().m_offset + m_fields.back().m_size + sizeof(uint64_t) - 1) &
+                ~(uint64_t)(sizeof(uint64_t) - 1);
+        assert(m_end <= sizeof(CPUArchState));
+
+        uint32_t field = 0;
+        for(uint64_t word = m_begin; word < m_end; word += sizeof(uint64_t)) {
+            while(m_fields[field].m_offset + m_fields[field].m_size <= word) {
+                assert(field + 1 < m_fields.size() &&
+                        m_fields[field].m_offset + m_fields[field].m_size <= m_fields[field + 1].m_offset);
+                ++field;
+            }
+
+            m_word_first_field.push_back(field);
+        }
+    }
+
+    // Appends the fields of target that differ from reference to deltas,
+    // with their values in target to data
+    void diff(const uint8_t *reference, const uint8_t *target,
+            vector<CPUStateDelta>& deltas, vector<uint8_t>& data) const
+    {
+        uint64_t next_field = 0;
+
+        for(uint64_t block = m_begin; block < m_end; block += CRETE_CPU_STATE_DIFF_BLOCK_SIZE) {
+            uint64_t block_end = min(block + CRETE_CPU_STATE_DIFF_BLOCK_SIZE, m_end);
+
+            // Most blocks are unchanged, which memcmp() checks with vector instructions
+            if(memcmp(reference + block, target + block, block_end - block) == 0)
+                continue;
+
+            for(uint64_t word = block; word < block_end; word += sizeof(uint64_t)) {
+                uint64_t reference_word;
+                uint64_t target_word;
+                memcpy(&reference_word, reference + word, sizeof(uint64_t));
+                memcpy(&target_word, target + word, sizeof(uint64_t));
+
+                if(reference_word == target_word)
+                    continue;
+
+                uint64_t field = max(next_field,
+                        (uint64_t)m_word_first_field[(word - m_begin) / sizeof(uint64_t)]);
+
+                for(; field < m_fields.size() && m_fields[field].m_offset < word + sizeof(uint64_t); ++field) {
+                    const CPUStateField& f = m_fields[field];
+
+                    if(memcmp(reference + f.m_offset, target + f.m_offset, f.m_size) != 0) {
+                        CPUStateDelta delta = {(uint32_t)field, (uint32_t)data.size()};
+                        deltas.push_back(delta);
+                        data.insert(data.end(), target + f.m_offset, target + f.m_offset + f.m_size);
+                    }
+                }
+
+                next_field = field;
+            }
+        }
+    }
+
+    CPUStateElement element(const CPUStateDelta& delta, const vector<uint8_t>& data) const
+    {
+        const CPUStateField& f = m_fields[delta.m_field];
+
+        stringstream name;
+        name << f.m_name;
+        if(f.m_index >= 0) {
+            name << "[" << dec << f.m_index << "]";
+        }
+
+        const uint8_t *value = &data[delta.m_data_offset];
+
+        return CPUStateElement(f.m_offset, f.m_size, name.str(),
+                vector<uint8_t>(value, value + f.m_size));
+    }
+
+private:
+    vector<CPUStateField> m_fields;
+    vector<uint32_t> m_word_first_field;
+    uint64_t m_begin;
+    uint64_t m_end;
+};
+
+static const CPUStateFieldTable& x86_cpuState_field_table()
+{
+    static const CPUStateFieldTable table;
+    return table;
+}
+
+// Compare two cpu states, append the different elements of target cpu state
+static void x86_cpuState_diff(const uint8_t *reference, const uint8_t *target,
+        vector<CPUStateDelta>& deltas, vector<uint8_t>& data)
+{
+    x86_cpuState_field_table().diff(reference, target, deltas, data);
+}
+
+static CPUStateElement x86_cpuState_delta_element(const CPUStateDelta& delta,
+        const vector<uint8_t>& data)
+{
+    return x86_cpuState_field_table().element(delta, data);
+}
+
 void clear_current_tb_br_taken()
 {
     runtime_env->clear_current_tb_br_taken();
@@ -98,6 +98,7 @@ int  crete_flags_is_true(struct CreteFlags *cf);
 #include <crete/trace_tag.h>
 #include <crete/guest_data_post_exec.hpp>
 #include <crete/test_case.h>
+#include <crete/trace_container.h>
 
 using namespace std;
 
@@ -190,8 +191,16 @@ struct QemuInterruptInfo {
     }
 };
 
-// <address, value>
-typedef boost::unordered_map<uint64_t, uint8_t> memoSyncTable_ty;
+// A range of memory loaded by interested TBs, with the values of its first loads
+// stored at m_data_offset in RuntimeEnv::m_memoSyncData
+struct MemoSyncRecord {
+    uint64_t m_addr;
+    uint64_t m_size;
+    uint64_t m_data_offset;
+};
+
+// [begin, end) of the records of a memoSyncTable in RuntimeEnv::m_memoSyncRecords
+typedef pair<uint64_t, uint64_t> memoSyncTable_ty;
 typedef vector<memoSyncTable_ty> memoSyncTables_ty;
 
 typedef map<uint64_t, CreteMemoInfo> debug_memoSyncTable_ty;
@@ -201,6 +210,26 @@ typedef vector<debug_memoSyncTable_ty> debug_memoSyncTables_ty;
 // vector<>: contents
 typedef pair<bool, vector<CPUStateElement> > cpuStateSyncTable_ty;
 
+// A traced CPUState field (or array element), see x86_cpuState_fields()
+struct CPUStateField {
+    uint32_t m_offset;
+    uint32_t m_size;
+    const char *m_name;
+    int32_t m_index; // Array index, or -1
+};
+
+// A changed CPUState field captured at runtime, whose bytes are stored at
+// m_data_offset in RuntimeEnv::m_cpuStateDeltaData. It is expanded into a
+// CPUStateElement only when the sync tables are written.
+struct CPUStateDelta {
+    uint32_t m_field;
+    uint32_t m_data_offset;
+};
+
+// bool: valid table or not
+// uint64_t: end of its deltas in RuntimeEnv::m_cpuStateDeltas
+typedef pair<bool, uint64_t> cpuStateDeltaTable_ty;
+
 typedef pair<QemuInterruptInfo, bool> interruptState_ty;
 
 //<name, concolic_memo>
@@ -213,11 +242,16 @@ private:
 	// Instruction sequence and its translation context
     TCGLLVMOfflineContext m_tcg_llvm_offline_ctx;
     void *m_tlo_ctx_cpuState;
+    // <TranslationBlock::crete_tb_id, index of its captured llvm tb>, for tbs captured in this trace
+    boost::unordered_map<uint64_t, uint64_t> m_captured_tbs;
 
     // Initial CPU state
     vector<uint8_t> m_initial_CpuState;
-    // CpuState Side-effects
-    vector<cpuStateSyncTable_ty> m_cpuStateSyncTables;
+    // CpuState Side-effects, one table per tb, with the deltas of all tables
+    // kept in two arenas
+    vector<cpuStateDeltaTable_ty> m_cpuStateDeltaTables;
+    vector<CPUStateDelta> m_cpuStateDeltas;
+    vector<uint8_t> m_cpuStateDeltaData;
     // Two CPU States for tracing the side effects on CPUState
     // A CPUState right after  a set of consecutive interested TBs,
     // which will be compared with a CPUState right before a set of
@@ -229,8 +263,14 @@ private:
     vector<cpuStateSyncTable_ty> m_debug_cpuStateSyncTables;
 
     memoSyncTables_ty m_memoSyncTables;
-    memoSyncTable_ty m_currentMemoSyncTable;
+    // Append-only logs of the records of all memoSyncTables and of their values.
+    // Records from m_committed_memoSyncRecords on belong to the current TB.
+    vector<MemoSyncRecord> m_memoSyncRecords;
+    vector<uint8_t> m_memoSyncData;
+    uint64_t m_committed_memoSyncRecords;
     uint64_t m_mergePoint_memoSyncTables;
+    // Record count of the merge point table that triggers its compaction
+    uint64_t m_compact_memoSyncRecords;
 
     // Memory state, being captured on-the-fly by monitoring memory operations of interested TBs
     // Each entry stores all load memory operations for each unique addr for each interested TB
@@ -271,6 +311,9 @@ private:
     vector<string> m_make_concolic_order;
 
     string m_outputDirectory;
+    // Holds the trace data consumed by the translator and vm-node, see
+    // crete/trace_container.h; other outputs are separate files
+    crete::TraceContainerWriter *m_trace_container;
 
     crete::TestCase m_input_tc;
 
@@ -301,8 +344,10 @@ public:
     // Instruction sequence in terms of TB sequences
 	void addTBExecSequ(uint64_t index_captured_llvm_tb, uint64_t tb_pc);
     //x86-llvm context for offline traslation
-	void dump_tloCtx(void * cpuState, TranslationBlock *tb,
+	uint64_t dump_tloCtx(void * cpuState, TranslationBlock *tb,
 	        uint64_t crete_interrupted_pc);
+	int64_t get_captured_tb_index(const TranslationBlock *tb) const;
+	void set_captured_tb_index(const TranslationBlock *tb, uint64_t index);
 
 	// CPU state and its side-effect
     void addInitialCpuState();
@@ -384,13 +429,20 @@ private:
     void dump_tloTbInstCount(const uint64_t inst_count);
 
     void writeTcgLlvmCtx();
+    void writeChunkReady();
+    void writeTraceComplete();
 
     string getOutputFilename(const string &fileName) const;
+    void addTraceSection(const string &name, const string &data);
+    void closeTraceContainer();
 
     void writeConcolics();
 
     // Memory Monitoring
     void writeMemoSyncTables();
+    void resolveMemoSyncRecords(const memoSyncTable_ty& table,
+            vector<MemoSyncRecord>& records, vector<uint8_t>& data) const;
+    void compactMergePointMemoSyncTable();
     // Old MM
     void debug_mergeMemoSyncTables();
     void debug_writeMemoSyncTables();
@@ -403,7 +455,7 @@ private:
     void print_memoSyncTables();
 
     void writeInitialCpuState();
-    void checkEmptyCPUStateSyncTables();
+    void checkEmptyCPUStateSyncTables(vector<cpuStateSyncTable_ty>& cpuStateSyncTables) const;
     void writeCPUStateSyncTables();
     void writeDebugCPUStateSyncTables();
     void writeDebugCpuStateOffsets();
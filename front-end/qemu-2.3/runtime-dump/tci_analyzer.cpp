@@ -44,6 +44,272 @@ struct vCPUReg{
     :m_offset(offset), m_size(size), m_name(name) {}
 };
 
+// Taint shadow of the guest memory: one taint bit and the tainted value for
+// every guest byte. It is a two-level page table: the directory maps a 16MB
+// region to a table of 4KB shadow pages, allocated on first taint.
+class ShadowMemory
+{
+public:
+    ShadowMemory();
+    ~ShadowMemory();
+
+    // Taint bits of [addr, addr + size), bit i for byte addr + i. size <= 8.
+    uint64_t get_taint(uint64_t addr, uint64_t size) const;
+    uint8_t get_value(uint64_t addr) const;
+
+    // Taint [addr, addr + size) with the bytes of data. size <= 8.
+    void set(uint64_t addr, uint64_t size, uint64_t data);
+    void clear(uint64_t addr, uint64_t size);
+    // Clear the taint of all bytes below addr
+    void clear_below(uint64_t addr);
+
+    // Whether any byte of the pages [addr, addr + size) lies in is tainted
+    bool is_page_tainted(uint64_t addr, uint64_t size) const;
+
+    std::vector<uint64_t> get_tainted_addrs() const;
+
+private:
+    static const uint64_t PAGE_BITS = 12;
+    static const uint64_t PAGE_SIZE = 1ULL << PAGE_BITS;
+    static const uint64_t TABLE_BITS = 12;
+    static const uint64_t TABLE_SIZE = 1ULL << TABLE_BITS;
+    static const uint64_t WORDS_PER_PAGE = PAGE_SIZE / 64;
+
+    struct Page
+    {
+        uint64_t taint[WORDS_PER_PAGE];
+        uint8_t value[PAGE_SIZE];
+        uint64_t nb_tainted;
+    };
+
+    struct Table
+    {
+        Page *pages[TABLE_SIZE];
+    };
+
+    // Indexed by addr >> (PAGE_BITS + TABLE_BITS)
+    typedef boost::unordered_map<uint64_t, Table *> directory_ty;
+
+    Page *find_page(uint64_t page_num) const;
+    Page *get_page(uint64_t page_num);
+
+    directory_ty directory_;
+
+    // Most accesses hit the page of the previous one
+    mutable uint64_t last_page_num_;
+    mutable Page *last_page_;
+};
+
+ShadowMemory::ShadowMemory()
+    : last_page_num_(0)
+    , last_page_(NULL)
+{
+}
+
+ShadowMemory::~ShadowMemory()
+{
+    for(directory_ty::iterator it = directory_.begin(); it != directory_.end(); ++it) {
+        for(uint64_t i = 0; i < TABLE_SIZE; ++i)
+            delete it->second->pages[i];
+
+        delete it->second;
+    }
+}
+
+ShadowMemory::Page *ShadowMemory::find_page(uint64_t page_num) const
+{
+    if(last_page_ && page_num == last_page_num_)
+        return last_page_;
+
+    directory_ty::const_iterator it = directory_.find(page_num >> TABLE_BITS);
+    if(it == directory_.end())
+        return NULL;
+
+    Page *page = it->second->pages[page_num & (TABLE_SIZE - 1)];
+    if(page) {
+        last_page_num_ = page_num;
+        last_page_ = page;
+    }
+
+    return page;
+}
+
+ShadowMemory::Page *ShadowMemory::get_page(uint64_t page_num)
+{
+    Page *page = find_page(page_num);
+    if(page)
+        return page;
+
+    Table *&table = directory_[page_num >> TABLE_BITS];
+    if(!table) {
+        table = new Table;
+        memset(table->pages, 0, sizeof(table->pages));
+    }
+
+    page = new Page;
+    memset(page->taint, 0, sizeof(page->taint));
+    page->nb_tainted = 0;
+    table->pages[page_num & (TABLE_SIZE - 1)] = page;
+
+    last_page_num_ = page_num;
+    last_page_ = page;
+
+    return page;
+}
+
+uint64_t ShadowMemory::get_taint(uint64_t addr, uint64_t size) const
+{
+    assert(size <= 8);
+
+    uint64_t offset = addr & (PAGE_SIZE - 1);
+
+    // Access crossing a page boundary
+    if(offset + size > PAGE_SIZE) {
+        uint64_t first = PAGE_SIZE - offset;
+        return get_taint(addr, first) |
+                (get_taint(addr + first, size - first) << first);
+    }
+
+    const Page *page = find_page(addr >> PAGE_BITS);
+    if(!page)
+        return 0;
+
+    uint64_t mask = (1ULL << size) - 1;
+    uint64_t word = offset / 64;
+    uint64_t shift = offset % 64;
+
+    uint64_t bits = page->taint[word] >> shift;
+    if(shift + size > 64)
+        bits |= page->taint[word + 1] << (64 - shift);
+
+    return bits & mask;
+}
+
+uint8_t ShadowMemory::get_value(uint64_t addr) const
+{
+    const Page *page = find_page(addr >> PAGE_BITS);
+    assert(page);
+
+    return page->value[addr & (PAGE_SIZE - 1)];
+}
+
+void ShadowMemory::set(uint64_t addr, uint64_t size, uint64_t data)
+{
+    assert(size <= 8);
+
+    for(uint64_t i = 0; i < size; ++i) {
+        uint64_t a = addr + i;
+        uint64_t offset = a & (PAGE_SIZE - 1);
+        Page *page = get_page(a >> PAGE_BITS);
+        uint64_t bit = 1ULL << (offset % 64);
+
+        if(!(page->taint[offset / 64] & bit)) {
+            page->taint[offset / 64] |= bit;
+            ++page->nb_tainted;
+        }
+        page->value[offset] = (data >> i*8) & 0xff;
+    }
+}
+
+void ShadowMemory::clear(uint64_t addr, uint64_t size)
+{
+    assert(size <= 8);
+
+    if(!get_taint(addr, size))
+        return;
+
+    for(uint64_t i = 0; i < size; ++i) {
+        uint64_t a = addr + i;
+        uint64_t offset = a & (PAGE_SIZE - 1);
+        Page *page = find_page(a >> PAGE_BITS);
+        uint64_t bit = 1ULL << (offset % 64);
+
+        if(page && (page->taint[offset / 64] & bit)) {
+            page->taint[offset / 64] &= ~bit;
+            --page->nb_tainted;
+        }
+    }
+}
+
+bool ShadowMemory::is_page_tainted(uint64_t addr, uint64_t size) const
+{
+    const Page *page = find_page(addr >> PAGE_BITS);
+    if(page && page->nb_tainted)
+        return true;
+
+    if(((addr + size - 1) >> PAGE_BITS) == (addr >> PAGE_BITS))
+        return false;
+
+    page = find_page((addr + size - 1) >> PAGE_BITS);
+    return page && page->nb_tainted;
+}
+
+void ShadowMemory::clear_below(uint64_t addr)
+{
+    last_page_ = NULL;
+
+    uint64_t limit_page_num = addr >> PAGE_BITS;
+
+    for(directory_ty::iterator it = directory_.begin(); it != directory_.end();) {
+        Table *table = it->second;
+        bool empty = true;
+
+        for(uint64_t i = 0; i < TABLE_SIZE; ++i) {
+            Page *page = table->pages[i];
+            if(!page)
+                continue;
+
+            uint64_t page_num = (it->first << TABLE_BITS) | i;
+
+            if(page_num < limit_page_num) {
+                delete page;
+                table->pages[i] = NULL;
+            } else if(page_num == limit_page_num) {
+                for(uint64_t offset = 0; offset < (addr & (PAGE_SIZE - 1)); ++offset) {
+                    uint64_t bit = 1ULL << (offset % 64);
+
+                    if(page->taint[offset / 64] & bit) {
+                        page->taint[offset / 64] &= ~bit;
+                        --page->nb_tainted;
+                    }
+                }
+
+                empty = false;
+            } else {
+                empty = false;
+            }
+        }
+
+        if(empty) {
+            delete table;
+            it = directory_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<uint64_t> ShadowMemory::get_tainted_addrs() const
+{
+    std::vector<uint64_t> addrs;
+
+    for(directory_ty::const_iterator it = directory_.begin(); it != directory_.end(); ++it) {
+        for(uint64_t i = 0; i < TABLE_SIZE; ++i) {
+            const Page *page = it->second->pages[i];
+            if(!page)
+                continue;
+
+            uint64_t page_addr = ((it->first << TABLE_BITS) | i) << PAGE_BITS;
+            for(uint64_t offset = 0; offset < PAGE_SIZE; ++offset) {
+                if(page->taint[offset / 64] & (1ULL << (offset % 64)))
+                    addrs.push_back(page_addr + offset);
+            }
+        }
+    }
+
+    return addrs;
+}
+
 /* Pitfalls:
  * 1. guest_vcpu_regs_: TA and CPUState tracing monitors different part of CPU State,
  *      a) they have different blacklist:
@@ -83,6 +349,8 @@ public:
     void make_host_mem_concrete(uint64_t base_addr, uint64_t offset, uint64_t size);
 
     bool is_within_vcpu(uint64_t addr, uint64_t size);
+    bool is_host_mem_tainted(uint64_t base_addr, uint64_t offset, uint64_t size) const;
+    bool is_guest_page_tainted(uint64_t addr, uint64_t size) const;
 
     bool is_block_symbolic();
     bool is_previous_block_symbolic();
@@ -99,11 +367,12 @@ public:
 private:
     Block current_block_;
 
-    taintedMem_ty guest_mem_;
+    ShadowMemory guest_mem_;
 
     // <tainted, value>
     std::pair<bool, uint8_t> guest_vcpu_regs_[CRETE_TCG_ENV_SIZE];
     uint64_t guest_vcpu_addr_; // The address of the guest virtual cpu
+    uint64_t nb_tainted_vcpu_bytes_;
 
     // <tainted, value>
     std::pair<bool, uint64_t> tcg_regs_[TCG_TARGET_NB_REGS];
@@ -122,6 +391,7 @@ private:
 
 Analyzer::Analyzer()
     : guest_vcpu_addr_(0)
+    , nb_tainted_vcpu_bytes_(0)
     , tcg_sp_value_(0)
     , previous_block_symbolic_(false)
     , initialized_(false)
@@ -210,32 +480,34 @@ void Analyzer::make_tcg_reg_concrete(uint64_t index, uint64_t data)
 
 bool Analyzer::is_guest_mem_symbolic(uint64_t addr, uint64_t size, uint64_t data)
 {
+    uint64_t taint = guest_mem_.get_taint(addr, size);
+    if(!taint)
+        return false;
+
     bool ret = false;
 
-    taintedMem_ty::iterator it;
     uint8_t byte_value = 0;
     for(uint64_t i = 0; i < size; ++i) {
-        it = guest_mem_.find(addr + i);
-        if(it == guest_mem_.end())
+        if(!(taint & (1ULL << i)))
             continue;
 
         byte_value = (data >> i*8) & 0xff;
-        if(it->second == byte_value) {
+        if(guest_mem_.get_value(addr + i) == byte_value) {
             ret = true;
 
 #if defined(CRETE_DBG_TA)
             if(is_in_list_crete_dbg_ta_guest_addr(addr+i))
                 fprintf(stderr, "is_guest_mem_symbolic() is true for address %p, value = %d\n",
-                        (void *)(addr+i), guest_mem_[addr+i]);
+                        (void *)(addr+i), guest_mem_.get_value(addr+i));
 #endif
         } else {
             CRETE_DBG_GEN(
             fprintf(stderr, "[CRETE Warning] TA: is_guest_mem_symbolic() "
                     "potential under-taint-analysis: (%p) is changed (from %d to %d)"
-                    "while is tainted.\n", (void *)(addr + i), guest_mem_[addr+i], byte_value);
+                    "while is tainted.\n", (void *)(addr + i), guest_mem_.get_value(addr+i), byte_value);
             );
 
-            guest_mem_.erase(it);
+            guest_mem_.clear(addr + i, 1);
         }
     }
 
@@ -244,30 +516,30 @@ bool Analyzer::is_guest_mem_symbolic(uint64_t addr, uint64_t size, uint64_t data
 
 void Analyzer::make_guest_mem_symbolic(uint64_t addr, uint64_t size, uint64_t data)
 {
-    for(uint64_t i = 0; i < size; ++i) {
-        guest_mem_[addr+i] = (data >> i*8) & 0xff;
+    guest_mem_.set(addr, size, data);
 
 #if defined(CRETE_DBG_TA)
+    for(uint64_t i = 0; i < size; ++i) {
         if(is_in_list_crete_dbg_ta_guest_addr(addr+i))
             fprintf(stderr, "make_guest_mem_symbolic() for address %p, value = %d\n",
-                    (void *)(addr+i), (int)guest_mem_[addr+i]);
-#endif
+                    (void *)(addr+i), (int)guest_mem_.get_value(addr+i));
     }
+#endif
 
     mark_block_symbolic();
 }
 
 void Analyzer::make_guest_mem_concrete(uint64_t addr, uint64_t size, uint64_t data)
 {
-    for(uint64_t i = 0; i < size; ++i) {
-        guest_mem_.erase(addr + i);
+    guest_mem_.clear(addr, size);
 
 #if defined(CRETE_DBG_TA)
+    for(uint64_t i = 0; i < size; ++i) {
         if(is_in_list_crete_dbg_ta_guest_addr(addr+i))
             fprintf(stderr, "make_guest_mem_concrete() for address %p\n",
                     (void *)(addr+i));
-#endif
     }
+#endif
 }
 
 bool Analyzer::is_block_symbolic()
@@ -323,6 +595,7 @@ bool Analyzer::is_host_mem_symbolic(uint64_t base_addr, uint64_t offset, uint64_
 
             } else {
                 guest_vcpu_regs_[offset + i].first = false;
+                --nb_tainted_vcpu_bytes_;
 
                 CRETE_DBG_GEN(
                 fprintf(stderr, "[CRETE Warning] TA: vcpu in is_host_mem_symbolic() "
@@ -399,6 +672,9 @@ void Analyzer::make_host_mem_symbolic(uint64_t base_addr, uint64_t offset, uint6
         assert( (offset + size -1) < CRETE_TCG_ENV_SIZE);
         const uint8_t *current_cpuState = (const uint8_t *)guest_vcpu_addr_;
         for(uint64_t i = 0; i < size; ++i){
+            if(!guest_vcpu_regs_[offset + i].first)
+                ++nb_tainted_vcpu_bytes_;
+
             guest_vcpu_regs_[offset + i].second = current_cpuState[offset + i];
             guest_vcpu_regs_[offset + i].first = true;
         }
@@ -437,8 +713,12 @@ void Analyzer::make_host_mem_concrete(uint64_t base_addr, uint64_t offset, uint6
         }
 
         assert( (offset + size -1) < CRETE_TCG_ENV_SIZE);
-        for(uint64_t i = 0; i < size; ++i)
+        for(uint64_t i = 0; i < size; ++i) {
+            if(guest_vcpu_regs_[offset + i].first)
+                --nb_tainted_vcpu_bytes_;
+
             guest_vcpu_regs_[offset + i].first = false;
+        }
     } else if (base_addr == tcg_sp_value_) {
         assert(((offset >> 63) & 1)  && "[CRETE ERROR] when base addr is not vcpu, "
                 "its offset should always be negative.\n ");
@@ -464,15 +744,44 @@ bool Analyzer::is_within_vcpu(uint64_t addr, uint64_t size)
         return false;
 }
 
+// Conservative and cheap: whether the access may touch a tainted byte, without
+// checking the tainted values against the current ones as is_host_mem_symbolic()
+// does. Bases other than the vcpu and the tcg call stack are left to
+// is_host_mem_symbolic() to report.
+bool Analyzer::is_host_mem_tainted(uint64_t base_addr, uint64_t offset, uint64_t size) const
+{
+    if(base_addr == guest_vcpu_addr_) {
+        if(nb_tainted_vcpu_bytes_ == 0 || offset == (uint64_t)(-4))
+            return false;
+
+        for(uint64_t i = 0; i < size; ++i) {
+            if(offset + i < CRETE_TCG_ENV_SIZE && guest_vcpu_regs_[offset + i].first)
+                return true;
+        }
+
+        return (offset + size) > CRETE_TCG_ENV_SIZE;
+    } else if (base_addr == tcg_sp_value_) {
+        return !tcg_call_stack_mem_.empty();
+    }
+
+    return true;
+}
+
+bool Analyzer::is_guest_page_tainted(uint64_t addr, uint64_t size) const
+{
+    return guest_mem_.is_page_tainted(addr, size);
+}
+
 void Analyzer::dbg_print()
 {
-    for(taintedMem_ty::const_iterator it = guest_mem_.begin();
-    it != guest_mem_.end();
+    std::vector<uint64_t> tainted_addrs = guest_mem_.get_tainted_addrs();
+    for(std::vector<uint64_t>::const_iterator it = tainted_addrs.begin();
+    it != tainted_addrs.end();
     ++it)
     {
         std::cerr << "tained guest mem: "
         << std::hex
-        << it->first
+        << *it
         << std::dec
         << std::endl;
     }
@@ -826,22 +1135,13 @@ void Analyzer::void_target_pid(const uint64_t kernel_code_start_addr)
 {
     current_block_.symbolic_block_ = false;
 
-    for(taintedMem_ty::const_iterator it = guest_mem_.cbegin(); it != guest_mem_.cend();)
-    {
-        if(it->first < kernel_code_start_addr)
-        {
-            guest_mem_.erase(it++);
-        }
-        else
-        {
-            ++it;
-        }
-    }
+    guest_mem_.clear_below(kernel_code_start_addr);
 
     for(uint32_t i = 0; i < CRETE_TCG_ENV_SIZE; ++i)
     {
         guest_vcpu_regs_[i].first = false;
     }
+    nb_tainted_vcpu_bytes_ = 0;
 
     for(uint32_t i = 0; i < TCG_TARGET_NB_REGS; ++i)
     {
@@ -882,6 +1182,16 @@ using namespace crete::tci;
 static
 bool crete_read_was_symbolic = false;
 
+bool crete_tci_is_host_mem_tainted(uint64_t base_addr, uint64_t offset, uint64_t size)
+{
+    return analyzer.is_host_mem_tainted(base_addr, offset, size);
+}
+
+bool crete_tci_is_guest_page_tainted(uint64_t addr, uint64_t size)
+{
+    return analyzer.is_guest_page_tainted(addr, size);
+}
+
 bool crete_tci_is_current_block_symbolic()
 {
     return is_current_block_symbolic();
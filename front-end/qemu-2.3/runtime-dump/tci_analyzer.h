@@ -18,6 +18,8 @@ bool crete_tci_get_crete_read_was_symbolic(void);
 void crete_tci_set_crete_read_was_symbolic(bool input);
 
 bool crete_tci_is_current_block_symbolic(void);
+bool crete_tci_is_host_mem_tainted(uint64_t base_addr, uint64_t offset, uint64_t size);
+bool crete_tci_is_guest_page_tainted(uint64_t addr, uint64_t size);
 bool crete_tci_is_previous_block_symbolic(void);
 void crete_tci_mark_block_symbolic(void);
 void crete_tci_next_iteration(void); // reset for taint analysis
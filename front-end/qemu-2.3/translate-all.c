@@ -725,8 +725,10 @@ static TranslationBlock *tb_alloc(target_ulong pc)
     tb->cflags = 0;
 
 #if defined(CONFIG_CRETE) || 1
-    tb->tcg_ctx_captured = 0;
-    tb->index_captured_llvm_tb = -1;
+    {
+        static uint64_t crete_next_tb_id = 0;
+        tb->crete_tb_id = crete_next_tb_id++;
+    }
 #endif
 
     return tb;
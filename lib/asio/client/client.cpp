@@ -65,6 +65,11 @@ void Client::write(const PacketInfo& pktinfo)
     pimpl_->write(pktinfo);
 }
 
+void Client::write_file(int fd, uint64_t size)
+{
+    pimpl_->write_file(fd, size);
+}
+
 PacketInfo Client::read(std::vector<char>& buf)
 {
     return pimpl_->read(buf);
@@ -80,6 +85,11 @@ PacketInfo Client::read()
     return pimpl_->read();
 }
 
+void Client::read_file(int fd, uint64_t size)
+{
+    pimpl_->read_file(fd, size);
+}
+
 PacketInfo Client::read(boost::posix_time::time_duration timeout)
 {
     return pimpl_->read(timeout);
@@ -178,6 +178,11 @@ void ClientImpl::write(const PacketInfo& pktinfo)
         throw runtime_error("failed to send entire stream");
 }
 
+void ClientImpl::write_file(int fd, uint64_t size)
+{
+    send_file(socket_, fd, size);
+}
+
 PacketInfo ClientImpl::read(std::vector<char>& buf)
 {
     boost::system::error_code error;
@@ -241,6 +246,11 @@ PacketInfo ClientImpl::read()
     return pktinfo;
 }
 
+void ClientImpl::read_file(int fd, uint64_t size)
+{
+    receive_file(socket_, fd, size);
+}
+
 PacketInfo ClientImpl::read(boost::posix_time::time_duration timeout)
 {
     boost::system::error_code ec = boost::asio::error::would_block;
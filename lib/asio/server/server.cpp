@@ -1,6 +1,7 @@
 #include <crete/asio/server.h>
 #include <crete/exception.h>
 
+#include <array>
 #include <iostream>
 
 #include <boost/filesystem/operations.hpp>
@@ -92,14 +93,24 @@ string Server::read_message()
 
 size_t Server::write(const std::vector<char>& buf, const PacketInfo& pkinfo)
 {
-    write(pkinfo);
-
     CRETE_EXCEPTION_ASSERT(buf.size() >= pkinfo.size,
                            err::msg("buffer smaller than size to be read from"));
 
-    return boost::asio::write(socket_,
-                              boost::asio::buffer(buf.data(),
-                                                  pkinfo.size));
+    // Header and payload go out in a single gather write, so large payloads
+    // (e.g., image blocks) cost one syscall rather than two.
+    std::array<boost::asio::const_buffer, 2> bufs = {{
+        boost::asio::buffer(reinterpret_cast<const uint8_t*>(&pkinfo),
+                            sizeof(PacketInfo)),
+        boost::asio::buffer(buf.data(),
+                            pkinfo.size)
+    }};
+
+    size_t nsent = boost::asio::write(socket_, bufs);
+
+    if(nsent != sizeof(PacketInfo) + pkinfo.size)
+        throw runtime_error("failed to send entire stream");
+
+    return nsent - sizeof(PacketInfo);
 }
 
 void Server::write(boost::asio::streambuf& sbuf,
@@ -148,6 +159,11 @@ void Server::write(const PacketInfo& pktinfo)
         throw runtime_error("failed to send entire stream");
 }
 
+void Server::write_file(int fd, uint64_t size)
+{
+    send_file(socket_, fd, size);
+}
+
 PacketInfo Server::read(std::vector<char>& buf)
 {
     boost::system::error_code error;
@@ -211,6 +227,11 @@ PacketInfo Server::read()
     return pktinfo;
 }
 
+void Server::read_file(int fd, uint64_t size)
+{
+    receive_file(socket_, fd, size);
+}
+
 void crete::Server::update_directory(const boost::filesystem::path& from, const boost::filesystem::path& to)
 {
     namespace fs = boost::filesystem;
@@ -3,6 +3,7 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/uuid/name_generator.hpp> // Brings in boost::uuids::detail::sha1 across Boost versions.
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/iostreams/filtering_streambuf.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
@@ -15,6 +16,7 @@
 
 #include <boost/process.hpp>
 
+#include <algorithm>
 #include <iostream> // testing.
 
 namespace fs = boost::filesystem;
@@ -32,13 +34,83 @@ ImageInfo::ImageInfo(const boost::filesystem::path& image) :
 {
 }
 
+ImageManifest::ImageManifest(const boost::filesystem::path& image,
+                             uint64_t block_size) :
+    size_{fs::file_size(image)},
+    block_size_{block_size}
+{
+    CRETE_EXCEPTION_ASSERT(block_size_ > 0,
+                           err::msg("image block size must be nonzero"));
+
+    fs::ifstream ifs(image, std::ios::in | std::ios::binary);
+
+    CRETE_EXCEPTION_ASSERT(ifs.good(),
+                           err::file_open_failed(image.string()));
+
+    auto buf = std::vector<char>(block_size_);
+
+    digests_.reserve((size_ + block_size_ - 1) / block_size_);
+
+    for(auto remaining = size_; remaining > 0;)
+    {
+        auto len = std::min(remaining, block_size_);
+
+        ifs.read(buf.data(), static_cast<std::streamsize>(len));
+
+        CRETE_EXCEPTION_ASSERT(static_cast<uint64_t>(ifs.gcount()) == len,
+                               err::msg("short read of image: " + image.string()));
+
+        bui::detail::sha1 sha;
+        bui::detail::sha1::digest_type digest;
+
+        sha.process_bytes(buf.data(), len);
+        sha.get_digest(digest);
+
+        auto& hash = *digests_.emplace(digests_.end(), sizeof(digest), '\0');
+
+        for(auto i = 0u; i < sizeof(digest) / sizeof(digest[0]); ++i)
+        {
+            for(auto b = 0u; b < sizeof(digest[0]); ++b)
+            {
+                hash[i * sizeof(digest[0]) + b] = static_cast<char>(digest[i] >> (8 * b));
+            }
+        }
+
+        remaining -= len;
+    }
+}
+
+/**
+ * @brief differing_image_blocks lists the blocks of 'source' that 'destination' lacks.
+ * @return indices of blocks to send. All blocks, if the block sizes disagree.
+ */
+auto differing_image_blocks(const ImageManifest& source,
+                            const ImageManifest& destination) -> std::vector<uint64_t>
+{
+    auto blocks = std::vector<uint64_t>{};
+    auto comparable = source.block_size_ == destination.block_size_;
+
+    for(auto i = uint64_t{0}; i < source.digests_.size(); ++i)
+    {
+        if(!comparable ||
+           i >= destination.digests_.size() ||
+           source.digests_[i] != destination.digests_[i])
+        {
+            blocks.emplace_back(i);
+        }
+    }
+
+    return blocks;
+}
+
 /**
  * @brief archive_directory archives a directory into a single archived file
  *        of the same name. Please note that this is done in-place.
  * @param dir - path to the directory to be archived, in-place.
- * @note Compression is also done on the archive.
+ * @param compressor - program the archive is piped through (e.g., zstd), if any.
  */
-auto archive_directory(const boost::filesystem::path& dir) -> void
+auto archive_directory(const boost::filesystem::path& dir,
+                       const std::string& compressor) -> void
 {
     auto tmp = fs::path{dir}.replace_extension("tmp");
 
@@ -49,11 +121,16 @@ auto archive_directory(const boost::filesystem::path& dir) -> void
     ctx.environment = bp::self::get_environment();
     auto exe = bp::find_executable_in_path("tar");
     auto args = std::vector<std::string>{fs::path{exe}.filename().string(),
-                                         "-zcf",
+                                         "-cf",
                                          tmp.filename().string(),
                                          dir.filename().string()
                                          };
 
+    if(!compressor.empty())
+    {
+        args.emplace_back("--use-compress-program=" + compressor);
+    }
+
     auto proc = bp::launch(exe, args, ctx);
     auto status = proc.wait();
 
@@ -71,9 +148,10 @@ auto archive_directory(const boost::filesystem::path& dir) -> void
  * @brief restore_directory restores a previously archived directory via archive_directory().
  *        Please note that this is done in-place.
  * @param dir - path to the directory to be restored, in-place.
- * @note Archive is decompressed.
+ * @param compressor - the compressor given to archive_directory().
  */
-auto restore_directory(const boost::filesystem::path& dir) -> void
+auto restore_directory(const boost::filesystem::path& dir,
+                       const std::string& compressor) -> void
 {
     auto tmp = fs::path{dir}.replace_extension("tmp");
 
@@ -91,6 +169,11 @@ auto restore_directory(const boost::filesystem::path& dir) -> void
                                          tmp.filename().string(),
                                          };
 
+    if(!compressor.empty())
+    {
+        args.emplace_back("--use-compress-program=" + compressor);
+    }
+
     auto proc = bp::launch(exe, args, ctx);
     auto status = proc.wait();
 
@@ -1,7 +1,6 @@
 #include <crete/cluster/dispatch.h>
 #include <crete/exception.h>
 #include <crete/logger.h>
-#include <crete/async_task.h>
 #include <crete/guest_data_post_exec.hpp>
 
 #include <boost/property_tree/ptree.hpp>
@@ -14,11 +13,19 @@
 #include <boost/msm/front/euml/operator.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/unordered_set.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/thread.hpp>
 
 #include <chrono>
 #include <deque>
+#include <map>
 #include <algorithm>
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 
 namespace bpt = boost::property_tree;
 namespace bui = boost::uuids;
@@ -37,18 +44,24 @@ auto filter_vm(const NodeRegistrar::Nodes& nodes) -> NodeRegistrar::Nodes;
 auto filter_svm(const NodeRegistrar::Nodes& nodes) -> NodeRegistrar::Nodes;
 auto sort_by_trace(NodeRegistrar::Nodes& nodes) -> void;
 auto sort_by_test(NodeRegistrar::Nodes& nodes) -> void;
+auto node_server(NodeRegistrar::Node& node) -> Server&;
+auto node_id(NodeRegistrar::Node& node) -> uint64_t;
 auto receive_trace(NodeRegistrar::Node& node,
                    const boost::filesystem::path& traces_dir) -> boost::filesystem::path;
 auto receive_tests(NodeRegistrar::Node& node) -> std::vector<TestCase>;
 auto receive_errors(NodeRegistrar::Node& node) -> std::vector<log::NodeError>;
 auto receive_image_info(NodeRegistrar::Node& node) -> ImageInfo;
+auto receive_image_manifest(NodeRegistrar::Node& node) -> ImageManifest;
 auto transmit_trace(NodeRegistrar::Node& node,
                     const boost::filesystem::path& traces) -> void;
 auto transmit_tests(NodeRegistrar::Node& node,
-                    const std::vector<TestCase>& tcs) -> void;
+                    const std::vector<TestCase>& tcs) -> NodeStatus;
 auto transmit_commencement(NodeRegistrar::Node& node) -> void;
 auto transmit_image_info(NodeRegistrar::Node& node,
                          const ImageInfo& ii) -> void;
+auto transmit_image(NodeRegistrar::Node& node,
+                    const boost::filesystem::path& image_path) -> void;
+auto image_manifest(const boost::filesystem::path& image_path) -> ImageManifest;
 auto transmit_config(NodeRegistrar::Node& node,
                      const option::Dispatch& options) -> void;
 auto register_node_fsm(NodeRegistrar::Node& node,
@@ -59,6 +72,55 @@ auto register_node_fsm(NodeRegistrar::Node& node,
 auto make_dispatch_root() -> boost::filesystem::path;
 auto extract_initial_test(const config::RunConfiguration& config) -> TestCase;
 
+/**
+ * @brief Tracks the single event a node FSM may have in flight on Dispatch's io_service.
+ *
+ * The events of a node FSM, and with them all I/O to its node, run on the node's strand,
+ * so they never run concurrently. The dispatch thread also posts only while the FSM is
+ * idle, so that it reads the flags of a settled FSM.
+ * The dispatch thread also uses it to space out the status polls of an idle node.
+ */
+class PendingEvent
+{
+public:
+    auto strand(boost::asio::io_service& io_service) -> boost::asio::io_service::strand&
+    {
+        if(!strand_)
+        {
+            strand_.reset(new boost::asio::io_service::strand{io_service});
+        }
+
+        return *strand_;
+    }
+    auto is_busy() const -> bool { return busy_; }
+    auto is_poll_due() const -> bool
+    {
+        return std::chrono::steady_clock::now() >= poll_due_time();
+    }
+    auto poll_due_time() const -> std::chrono::steady_clock::time_point
+    {
+        return polled_ + dispatch_node_poll_interval;
+    }
+    auto polled() -> void { polled_ = std::chrono::steady_clock::now(); }
+    auto busy(bool p) -> void { busy_ = p; }
+    auto is_exception_thrown() const -> bool { return static_cast<bool>(exception_); }
+    auto rethrow_exception() -> void
+    {
+        auto e = exception_;
+
+        exception_ = nullptr;
+
+        std::rethrow_exception(e);
+    }
+    auto exception(std::exception_ptr e) -> void { exception_ = e; }
+
+private:
+    std::unique_ptr<boost::asio::io_service::strand> strand_;
+    std::atomic<bool> busy_{false};
+    std::exception_ptr exception_;
+    std::chrono::steady_clock::time_point polled_;
+};
+
 namespace vm
 {
 // +--------------------------------------------------+
@@ -77,6 +139,7 @@ namespace flag
     struct error_rxed {};
     struct guest_data_rxed {};
     struct status_rxed {};
+    struct rx_status {};
     struct active {}; // Use in the target state of an 'active' operation. TS is entered, then the action is fired.
     struct error {};
 }
@@ -99,7 +162,7 @@ class VMNodeFSM_ : public boost::msm::front::state_machine_def<VMNodeFSM_>
 public:
     VMNodeFSM_();
 
-    auto node_status() const -> const NodeStatus&;
+    auto node_status() const -> NodeStatus;
     auto get_trace() const -> const fs::path&;
     auto errors() const -> const std::deque<log::NodeError>&;
     auto pop_error() -> log::NodeError;
@@ -154,7 +217,6 @@ public:
     // +--------------------------------------------------+
     // + Gaurds                                           +
     // +--------------------------------------------------+
-    struct is_prev_task_finished;
     struct is_distributed;
     struct do_update;
     struct is_first_vm_node;
@@ -198,10 +260,8 @@ public:
                                                                        update_image,
                                                                        update_image_info>> ,none              >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<Commence          ,poll              ,RxGuestData       ,commence             ,And_<is_prev_task_finished,
-                                                                                            is_first_vm_node> >,
-      Row<Commence          ,poll              ,RxStatus          ,commence             ,And_<is_prev_task_finished,
-                                                                                          Not_<is_first_vm_node>> >,
+      Row<Commence          ,poll              ,RxGuestData       ,commence             ,is_first_vm_node     >,
+      Row<Commence          ,poll              ,RxStatus          ,commence             ,Not_<is_first_vm_node>>,
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<RxGuestData       ,poll              ,GuestDataRxed     ,rx_guest_data        ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
@@ -214,13 +274,11 @@ public:
       Row<RxTrace           ,poll              ,TxTest            ,none                 ,Not_<has_trace>      >,
       Row<RxTrace           ,poll              ,TraceRxed         ,rx_trace             ,has_trace            >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<TraceRxed         ,trace             ,TxTest            ,none                 ,is_prev_task_finished>,
+      Row<TraceRxed         ,trace             ,TxTest            ,none                 ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<TxTest            ,test              ,TestTxed          ,ActionSequence_<mpl::vector<
-                                                                       tx_test,
-                                                                       rx_status>>      ,none                 >,
+      Row<TxTest            ,test              ,TestTxed          ,tx_test              ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<TestTxed          ,poll              ,RxStatus          ,none                 ,Not_<has_error>      >,
+      Row<TestTxed          ,poll              ,StatusRxed        ,none                 ,Not_<has_error>      >,
       Row<TestTxed          ,poll              ,ErrorRxed         ,rx_error             ,has_error            >,
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<ErrorRxed         ,poll              ,RxStatus          ,none                 ,none                 >
@@ -228,6 +286,7 @@ public:
 
 private:
     NodeRegistrar::Node node_;
+    std::shared_ptr<AtomicGuard<NodeStatus>> status_ = std::make_shared<AtomicGuard<NodeStatus>>(); // Last known; read without the node lock.
     bool first_vm_node_{false};
     fs::path traces_dir_;
     std::shared_ptr<fs::path> trace_ = std::make_shared<fs::path>();
@@ -293,9 +352,9 @@ VMNodeFSM_::VMNodeFSM_()
 //    return node_;
 //}
 
-auto VMNodeFSM_::node_status() const -> const NodeStatus&
+auto VMNodeFSM_::node_status() const -> NodeStatus
 {
-    return node_->acquire()->status;
+    return static_cast<NodeStatus>(status_->acquire());
 }
 
 auto VMNodeFSM_::get_trace() const -> const fs::path&
@@ -411,12 +470,12 @@ struct VMNodeFSM_::Commence : public msm::front::state<>
     template <class Event,class FSM>
     void on_exit(Event const&,FSM& ) {std::cout << "leaving: Commence" << std::endl;}
 #endif // defined(CRETE_DEBUG)
-
-    std::unique_ptr<AsyncTask> async_task_{new AsyncTask{}};
 };
 
 struct VMNodeFSM_::RxStatus : public msm::front::state<>
 {
+    using flag_list = mpl::vector1<flag::rx_status>;
+
 #if defined(CRETE_DEBUG)
     template <class Event,class FSM>
     void on_entry(Event const& ,FSM&) {std::cout << "entering: RxStatus" << std::endl;}
@@ -469,8 +528,6 @@ struct VMNodeFSM_::TraceRxed : public msm::front::state<>
     template <class Event,class FSM>
     void on_exit(Event const&,FSM& ) {std::cout << "leaving: TraceRxed" << std::endl;}
 #endif // defined(CRETE_DEBUG)
-
-    std::unique_ptr<AsyncTask> async_task_;
 };
 
 struct VMNodeFSM_::TestTxed : public msm::front::state<>
@@ -519,6 +576,7 @@ struct VMNodeFSM_::init
     auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState&) -> void
     {
         fsm.node_ = ev.node_;
+        fsm.status_->acquire() = ev.node_->acquire()->status;
         fsm.first_vm_node_ = ev.first_vm_node_;
         fsm.update_image_ = ev.update_image_;
         fsm.distributed_ = ev.distributed_;
@@ -549,37 +607,10 @@ struct VMNodeFSM_::update_image_info
 struct VMNodeFSM_::update_image
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState& ts) -> void
+    auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState&) -> void
     {
-        ts.async_task_.reset(new AsyncTask{[]( NodeRegistrar::Node node
-                                             , const fs::path image_path)
-        {
-            if(!fs::exists(image_path))
-            {
-                BOOST_THROW_EXCEPTION(Exception{} << err::file_missing{image_path.string()});
-            }
-
-            fs::ifstream ifs(image_path);
-
-            CRETE_EXCEPTION_ASSERT(ifs.good(), err::file_open_failed{image_path.string()});
-
-            auto pkinfo = PacketInfo{0,0,0};
-            auto lock = node->acquire();
-
-            pkinfo.id = lock->status.id;
-            pkinfo.type = packet_type::cluster_image;
-
-            lock->server.write(pkinfo);
-
-            std::cout << "Sending OS image to VM Node..." << std::endl;
-
-            write(lock->server,
-                  ifs,
-                  default_chunk_size);
-
-        }
-        , fsm.node_
-        , ev.image_path_});
+        transmit_image(fsm.node_,
+                       ev.image_path_);
     }
 };
 
@@ -589,15 +620,15 @@ struct VMNodeFSM_::rx_guest_data
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
     {
-        auto lock = fsm.node_->acquire();
+        auto& server = node_server(fsm.node_);
 
         auto pkinfo = PacketInfo{0,0,0};
-        pkinfo.id = lock->status.id;
+        pkinfo.id = node_id(fsm.node_);
         pkinfo.type = packet_type::cluster_request_guest_data;
 
-        lock->server.write(pkinfo);
+        server.write(pkinfo);
 
-        read_serialized_binary(lock->server,
+        read_serialized_binary(server,
                                fsm.guest_data_,
                                packet_type::cluster_tx_guest_data);
     }
@@ -617,39 +648,29 @@ struct VMNodeFSM_::rx_status
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
     {
-        cluster::poll(fsm.node_);
+        fsm.status_->acquire() = cluster::poll(fsm.node_);
     }
 };
 
 struct VMNodeFSM_::rx_trace
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState& ts) -> void
+    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
     {
-        ts.async_task_.reset(new AsyncTask{[]( NodeRegistrar::Node node
-                                             , const fs::path traces_dir
-                                             , std::shared_ptr<fs::path> trace
-                                             , std::shared_ptr<GuestDataPostExec> guest_data_post_exec)
-        {
-            *trace = receive_trace(node,
-                                  traces_dir);
+        *fsm.trace_ = receive_trace(fsm.node_,
+                                    fsm.traces_dir_);
 
-            // Read guest_data_post_exec_ from vm-node
-            auto lock = node->acquire();
+        // Read guest_data_post_exec_ from vm-node
+        auto& server = node_server(fsm.node_);
 
-            auto pkinfo = PacketInfo{0,0,0};
-            pkinfo.id = lock->status.id;
-            pkinfo.type = packet_type::cluster_request_guest_data_post_exec;
-            lock->server.write(pkinfo);
+        auto pkinfo = PacketInfo{0,0,0};
+        pkinfo.id = node_id(fsm.node_);
+        pkinfo.type = packet_type::cluster_request_guest_data_post_exec;
+        server.write(pkinfo);
 
-            read_serialized_binary(lock->server,
-                                   *guest_data_post_exec,
-                                   packet_type::cluster_tx_guest_data_post_exec);
-        }
-        , fsm.node_
-        , fsm.traces_dir_
-        , fsm.trace_
-        , fsm.guest_data_post_exec_});
+        read_serialized_binary(server,
+                               *fsm.guest_data_post_exec_,
+                               packet_type::cluster_tx_guest_data_post_exec);
     }
 };
 
@@ -658,13 +679,16 @@ struct VMNodeFSM_::tx_test
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState&) -> void
     {
+        // The node acknowledges a batch with its status, so only poll when there is nothing to send.
         if(ev.tests_.empty())
         {
+            fsm.status_->acquire() = cluster::poll(fsm.node_);
+
             return;
         }
 
-        transmit_tests(fsm.node_,
-                       ev.tests_);
+        fsm.status_->acquire() = transmit_tests(fsm.node_,
+                                                ev.tests_);
     }
 };
 
@@ -684,22 +708,6 @@ struct VMNodeFSM_::rx_error
 // + Gaurds                                           +
 // +--------------------------------------------------+
 
-struct VMNodeFSM_::is_prev_task_finished // TODO: this struct should be a general utility available to all FSMs, not belonging to any FSM struct.
-{
-    template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const&, FSM&, SourceState& ss, TargetState&) -> bool
-    {
-        if(ss.async_task_->is_exception_thrown())
-        {
-            auto e = ss.async_task_->release_exception();
-
-            std::rethrow_exception(e);
-        }
-
-        return ss.async_task_->is_finished();
-    }
-};
-
 struct VMNodeFSM_::is_distributed
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
@@ -760,7 +768,7 @@ struct VMNodeFSM_::has_trace
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&,TargetState&) -> bool
     {
-        return fsm.node_->acquire()->status.trace_count > 0;
+        return fsm.status_->acquire()->trace_count > 0;
     }
 };
 
@@ -769,7 +777,7 @@ struct VMNodeFSM_::has_error
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&,TargetState&) -> bool
     {
-        return fsm.node_->acquire()->status.error_count > 0;
+        return fsm.status_->acquire()->error_count > 0;
     }
 };
 
@@ -777,6 +785,7 @@ struct VMNodeFSM_::has_error
 // but needed a way to hide the impl. in source file, so as to avoid namespace troubles.
 // This seems to work.
 class NodeFSM : public boost::msm::back::state_machine<VMNodeFSM_>
+             , public PendingEvent
 {
 };
 
@@ -794,6 +803,7 @@ namespace svm
 namespace flag
 {
     using status_rxed = vm::flag::status_rxed;
+    using rx_status = vm::flag::rx_status;
     struct test_rxed {};
     struct tx_trace {};
     using active = vm::flag::active;
@@ -816,6 +826,7 @@ class SVMNodeFSM_ : public boost::msm::front::state_machine_def<SVMNodeFSM_>
 {
 private:
     NodeRegistrar::Node node_;
+    std::shared_ptr<AtomicGuard<NodeStatus>> status_ = std::make_shared<AtomicGuard<NodeStatus>>(); // Last known; read without the node lock.
     std::vector<TestCase> tests_;
     std::deque<log::NodeError> errors_;
 
@@ -824,7 +835,7 @@ private:
 public:
     SVMNodeFSM_();
 
-    auto node_status() -> const NodeStatus&;
+    auto node_status() const -> NodeStatus;
     auto tests() -> const std::vector<TestCase>&;
     auto errors() -> const std::deque<log::NodeError>&;
     auto pop_error() -> const log::NodeError;
@@ -870,7 +881,6 @@ public:
     // +--------------------------------------------------+
     // + Gaurds                                           +
     // +--------------------------------------------------+
-    using is_prev_task_finished = vm::NodeFSM::is_prev_task_finished;
     struct has_tests;
     using has_error = vm::NodeFSM::has_error;
 
@@ -908,7 +918,7 @@ public:
       Row<TxTrace           ,trace             ,TraceTxed         ,tx_trace             ,none                 >,
       Row<TxTrace           ,poll              ,RxTest            ,none                 ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
-      Row<TraceTxed         ,poll              ,RxTest            ,rx_status            ,is_prev_task_finished>,
+      Row<TraceTxed         ,poll              ,RxTest            ,rx_status            ,none                 >,
     //   +------------------+------------------+------------------+---------------------+------------------+
       Row<RxTest            ,poll              ,RxStatus          ,none                 ,And_<Not_<has_tests>,
                                                                                               Not_<has_error>>>,
@@ -941,9 +951,9 @@ SVMNodeFSM_::SVMNodeFSM_()
 {
 }
 
-auto SVMNodeFSM_::node_status() -> const NodeStatus&
+auto SVMNodeFSM_::node_status() const -> NodeStatus
 {
-    return node_->acquire()->status;
+    return static_cast<NodeStatus>(status_->acquire());
 }
 
 auto SVMNodeFSM_::tests() -> const std::vector<TestCase>&
@@ -1013,8 +1023,6 @@ struct SVMNodeFSM_::TraceTxed : public msm::front::state<>
     template <class Event,class FSM>
     void on_exit(Event const&,FSM& ) {std::cout << "leaving: TraceTxed" << std::endl;}
 #endif // defined(CRETE_DEBUG)
-
-    std::unique_ptr<AsyncTask> async_task_;
 };
 
 struct SVMNodeFSM_::RxTest : public msm::front::state<>
@@ -1061,6 +1069,7 @@ struct SVMNodeFSM_::init
     auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState&) -> void
     {
         fsm.node_ = ev.node_;
+        fsm.status_->acquire() = ev.node_->acquire()->status;
     }
 };
 
@@ -1076,17 +1085,10 @@ struct SVMNodeFSM_::commence
 struct SVMNodeFSM_::tx_trace
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState& ts) -> void
+    auto operator()(EVT const& ev, FSM& fsm, SourceState&, TargetState&) -> void
     {
-        ts.async_task_.reset(new AsyncTask{[]( NodeRegistrar::Node node
-                                             , const fs::path trace)
-        {
-            transmit_trace(node,
-                           trace);
-        }
-        , fsm.node_
-        , ev.trace_});
-
+        transmit_trace(fsm.node_,
+                       ev.trace_);
     }
 };
 
@@ -1108,7 +1110,7 @@ struct SVMNodeFSM_::has_tests
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> bool
     {
-        return fsm.node_->acquire()->status.test_case_count > 0;
+        return fsm.status_->acquire()->test_case_count > 0;
     }
 };
 
@@ -1116,6 +1118,7 @@ struct SVMNodeFSM_::has_tests
 // but needed a way to hide the impl. in source file, so as to avoid namespace troubles.
 // This seems to work.
 class NodeFSM : public boost::msm::back::state_machine<SVMNodeFSM_>
+             , public PendingEvent
 {
 };
 
@@ -1170,6 +1173,7 @@ public:
     auto set_up_root_dir() -> void;
     auto launch_node_registrar(Port master) -> void;
     auto elapsed_time() -> uint64_t;
+    auto node_statuses() -> std::vector<std::pair<uint32_t, NodeStatus>>;
     auto are_node_queues_empty() -> bool;
     auto are_all_queues_empty() -> bool;
     auto are_nodes_inactive() -> bool;
@@ -1180,6 +1184,15 @@ public:
     auto set_update_time_last_new_tb(const GuestDataPostExec& data) -> void;
     auto no_new_tb_time() -> uint64_t;
 
+    template <typename NodeFSMPtr, typename Event>
+    auto post_event(NodeFSMPtr nfsm,
+                    const Event& ev) -> void;
+    auto notify_node_event() -> void;
+    auto wait_for_node_event() -> void;
+    auto wait_for_node_event(std::chrono::steady_clock::time_point deadline) -> void;
+    auto wait_for_idle_nodes() -> void;
+    auto target_deadline() -> std::chrono::steady_clock::time_point;
+
     // +--------------------------------------------------+
     // + Entry & Exit                                     +
     // +--------------------------------------------------+
@@ -1293,6 +1306,13 @@ private:
 
     boost::unordered_set<uint64_t> explored_tbs_;
     std::chrono::time_point<std::chrono::system_clock> update_time_last_new_tb_ = std::chrono::system_clock::now();
+
+    boost::asio::io_service io_service_;
+    std::unique_ptr<boost::asio::io_service::work> io_work_{new boost::asio::io_service::work{io_service_}};
+    boost::thread_group io_threads_;
+    std::mutex node_event_mutex_;
+    std::condition_variable node_event_cond_;
+    bool node_event_pending_{false};
 };
 
 struct start
@@ -1454,6 +1474,7 @@ struct DispatchFSM_::init
             assert(fsm.next_target_seeds_queue_.size() == fsm.next_target_queue_.size()); // FIXME: xxx use exception
         }
 
+        fsm.test_pool_ = TestPool{fsm.root_, fsm.options_.test.fingerprint_spill};
         fsm.trace_pool_ = TracePool{fsm.options_};
 
         fsm.launch_node_registrar(fsm.master_port_);
@@ -1470,9 +1491,11 @@ struct DispatchFSM_::reset
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
     {
+        fsm.wait_for_idle_nodes();
+
         fsm.set_up_root_dir();
 
-        fsm.test_pool_ = TestPool{fsm.root_};
+        fsm.test_pool_ = TestPool{fsm.root_, fsm.options_.test.fingerprint_spill};
         fsm.trace_pool_ = TracePool{fsm.options_};
 
         fsm.vm_node_fsms_.acquire()->clear();
@@ -1546,6 +1569,8 @@ struct DispatchFSM_::dispatch
     template <class EVT,class FSM,class SourceState,class TargetState>
     auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState&) -> void
     {
+        auto wake = fsm.target_deadline();
+
         {
             auto vmns_lock = fsm.vm_node_fsms_.acquire();
 
@@ -1553,6 +1578,16 @@ struct DispatchFSM_::dispatch
                           vmns_lock->end(),
                           [&] (VMNodeFSM& nfsm)
             {
+                if(nfsm->is_busy()) // A slow node must not hold up the others.
+                {
+                    return;
+                }
+
+                if(nfsm->is_exception_thrown())
+                {
+                    nfsm->rethrow_exception();
+                }
+
                 if(nfsm->is_flag_active<vm::flag::trace_rxed>())
                 {
                     using boost::msm::back::HANDLED_TRUE;
@@ -1567,13 +1602,15 @@ struct DispatchFSM_::dispatch
                         fsm.to_trace_pool(nfsm->get_trace());
                         fsm.set_update_time_last_new_tb(nfsm->get_guest_data_post_exec());
                     }
+
+                    fsm.notify_node_event(); // Moved on without a posted event; send its tests next.
                 }
                 else if(nfsm->is_flag_active<vm::flag::tx_test>())
                 {
                     auto tests = std::vector<TestCase>{};
-                    auto tc_count = nfsm->node_status().test_case_count;
+                    auto credit = nfsm->node_status().test_case_credit; // Scales with the node's VM instances.
 
-                    while(tc_count < (1*vm_test_multiplier)) // TODO: should be num_vm_insts*vm_test_multiplier. Also, should verify bandwidth, though I doubt this would be a problem.
+                    while(tests.size() < credit)
                     {
                         auto next = fsm.next_test();
 
@@ -1581,11 +1618,22 @@ struct DispatchFSM_::dispatch
                             break;
 
                         tests.emplace_back(*next);
+                    }
 
-                        ++tc_count;
+                    // Without tests to send, the event merely polls the node.
+                    if(tests.empty())
+                    {
+                        if(!nfsm->is_poll_due())
+                        {
+                            wake = std::min(wake, nfsm->poll_due_time());
+
+                            return;
+                        }
+
+                        nfsm->polled();
                     }
 
-                    nfsm->process_event(vm::test{tests});
+                    fsm.post_event(nfsm, vm::test{tests});
                 }
                 else if(nfsm->is_flag_active<vm::flag::error_rxed>())
                 {
@@ -1598,15 +1646,15 @@ struct DispatchFSM_::dispatch
                                             <<  err.log << "\n";
                     }
 
-                    nfsm->process_event(vm::poll{});
+                    fsm.post_event(nfsm, vm::poll{});
                 }
                 else if(nfsm->is_flag_active<vm::flag::tx_config>())
                 {
-                    nfsm->process_event(vm::config{fsm.options_});
+                    fsm.post_event(nfsm, vm::config{fsm.options_});
                 }
                 else if(nfsm->is_flag_active<vm::flag::image>())
                 {
-                    nfsm->process_event(vm::image{fsm.options_.vm.image.path});
+                    fsm.post_event(nfsm, vm::image{fsm.options_.vm.image.path});
                 }
                 else if(nfsm->is_flag_active<vm::flag::guest_data_rxed>())
                 {
@@ -1634,11 +1682,24 @@ struct DispatchFSM_::dispatch
                         fsm.test_pool_.insert_initial_tcs(seeds);
                     }
 
-                    nfsm->process_event(vm::poll{});
+                    fsm.post_event(nfsm, vm::poll{});
+                }
+                else if(nfsm->is_flag_active<vm::flag::rx_status>())
+                {
+                    if(nfsm->is_poll_due()) // Not on every wakeup caused by another node.
+                    {
+                        nfsm->polled();
+
+                        fsm.post_event(nfsm, vm::poll{});
+                    }
+                    else
+                    {
+                        wake = std::min(wake, nfsm->poll_due_time());
+                    }
                 }
                 else
                 {
-                    nfsm->process_event(vm::poll{});
+                    fsm.post_event(nfsm, vm::poll{});
                 }
             });
         }
@@ -1650,11 +1711,21 @@ struct DispatchFSM_::dispatch
                           svmns_lock->end(),
                           [&] (SVMNodeFSM& nfsm)
             {
+                if(nfsm->is_busy()) // A slow node must not hold up the others.
+                {
+                    return;
+                }
+
+                if(nfsm->is_exception_thrown())
+                {
+                    nfsm->rethrow_exception();
+                }
+
                 if(nfsm->is_flag_active<svm::flag::test_rxed>())
                 {
                     fsm.test_pool_.insert(nfsm->tests());
 
-                    nfsm->process_event(svm::test{});
+                    fsm.post_event(nfsm, svm::test{});
                 }
                 else if(nfsm->is_flag_active<svm::flag::tx_trace>())
                 {
@@ -1684,11 +1755,11 @@ struct DispatchFSM_::dispatch
 
                     if(next)
                     {
-                        nfsm->process_event(svm::trace{*next});
+                        fsm.post_event(nfsm, svm::trace{*next});
                     }
                     else
                     {
-                        nfsm->process_event(svm::poll{});
+                        fsm.post_event(nfsm, svm::poll{});
                     }
                 }
                 else if(nfsm->is_flag_active<vm::flag::error_rxed>())
@@ -1702,21 +1773,36 @@ struct DispatchFSM_::dispatch
                                             <<  err.log << "\n";
                     }
 
-                    nfsm->process_event(svm::poll{});
+                    fsm.post_event(nfsm, svm::poll{});
                 }
                 else if(nfsm->is_flag_active<vm::flag::tx_config>())
                 {
-                    nfsm->process_event(vm::config{fsm.options_});
+                    fsm.post_event(nfsm, vm::config{fsm.options_});
+                }
+                else if(nfsm->is_flag_active<svm::flag::rx_status>())
+                {
+                    if(nfsm->is_poll_due()) // Not on every wakeup caused by another node.
+                    {
+                        nfsm->polled();
+
+                        fsm.post_event(nfsm, svm::poll{});
+                    }
+                    else
+                    {
+                        wake = std::min(wake, nfsm->poll_due_time());
+                    }
                 }
                 else
                 {
-                    nfsm->process_event(svm::poll{});
+                    fsm.post_event(nfsm, svm::poll{});
                 }
             });
         }
 
         fsm.first_ = false;
 
+        fsm.wait_for_node_event(wake);
+
         fsm.display_status(std::cout);
         fsm.write_statistics();
     }
@@ -1797,16 +1883,126 @@ struct DispatchFSM_::finish
     }
 };
 
+// A node only occupies a thread while one of its events runs, so the pool is not sized by the node count.
 DispatchFSM_::DispatchFSM_()
 {
+    for(auto i = 0u; i < dispatch_io_thread_count; ++i)
+    {
+        io_threads_.create_thread([this] { io_service_.run(); });
+    }
 }
 
 DispatchFSM_::~DispatchFSM_()
 {
+    io_work_.reset();
+    io_service_.stop();
+    io_threads_.join_all();
+
     if(node_registrar_driver_thread_.joinable())
     {
         node_registrar_driver_thread_.join();
     }
+
+    // Their strands must go before io_service_.
+    vm_node_fsms_.acquire()->clear();
+    svm_node_fsms_.acquire()->clear();
+}
+
+template <typename NodeFSMPtr, typename Event>
+auto DispatchFSM_::post_event(NodeFSMPtr nfsm,
+                              const Event& ev) -> void
+{
+    nfsm->busy(true);
+
+    nfsm->strand(io_service_).post([this, nfsm, ev]
+    {
+        try
+        {
+            nfsm->process_event(ev);
+        }
+        catch(...)
+        {
+            nfsm->exception(std::current_exception());
+        }
+
+        nfsm->busy(false);
+
+        notify_node_event();
+    });
+}
+
+auto DispatchFSM_::notify_node_event() -> void
+{
+    {
+        std::lock_guard<std::mutex> lock{node_event_mutex_};
+
+        node_event_pending_ = true;
+    }
+
+    node_event_cond_.notify_one();
+}
+
+// Sleeps until a node FSM finishes its posted event, or a node registers.
+auto DispatchFSM_::wait_for_node_event() -> void
+{
+    std::unique_lock<std::mutex> lock{node_event_mutex_};
+
+    node_event_cond_.wait(lock,
+                          [this] { return node_event_pending_; });
+
+    node_event_pending_ = false;
+}
+
+// As above, but no later than deadline, when something is due that no node signals.
+auto DispatchFSM_::wait_for_node_event(std::chrono::steady_clock::time_point deadline) -> void
+{
+    std::unique_lock<std::mutex> lock{node_event_mutex_};
+
+    node_event_cond_.wait_until(lock,
+                                deadline,
+                                [this] { return node_event_pending_; });
+
+    node_event_pending_ = false;
+}
+
+auto DispatchFSM_::wait_for_idle_nodes() -> void
+{
+    auto is_busy = [this]
+    {
+        auto vmns_lock = vm_node_fsms_.acquire();
+        auto svmns_lock = svm_node_fsms_.acquire();
+
+        return std::any_of(vmns_lock->begin(),
+                           vmns_lock->end(),
+                           [](const VMNodeFSM& nfsm) { return nfsm->is_busy(); })
+            || std::any_of(svmns_lock->begin(),
+                           svmns_lock->end(),
+                           [](const SVMNodeFSM& nfsm) { return nfsm->is_busy(); });
+    };
+
+    while(is_busy())
+    {
+        wait_for_node_event();
+    }
+}
+
+/**
+ * @brief target_deadline returns when the target expires by time, if nothing else happens first.
+ * @note The intervals are in whole seconds, and unset ones are the maximum; capped, so that the
+ *       deadline stays representable.
+ */
+auto DispatchFSM_::target_deadline() -> std::chrono::steady_clock::time_point
+{
+    auto remaining = [](uint64_t interval, uint64_t elapsed)
+    {
+        return interval > elapsed ? interval - elapsed : 0;
+    };
+
+    auto seconds = std::min({remaining(options_.test.interval.time, elapsed_time()),
+                             remaining(options_.test.interval.new_inst_wait_time, no_new_tb_time()),
+                             uint64_t{3600}});
+
+    return std::chrono::steady_clock::now() + std::chrono::seconds{seconds};
 }
 
 auto DispatchFSM_::to_trace_pool(const fs::path& trace) -> void
@@ -1837,6 +2033,8 @@ auto DispatchFSM_::launch_node_registrar(Port master) -> void
                           root_,
                           vm_node_fsms_,
                           svm_node_fsms_);
+
+        notify_node_event();
     }}};
 }
 
@@ -1859,18 +2057,49 @@ auto DispatchFSM_::no_new_tb_time() -> uint64_t
 }
 
 
-auto DispatchFSM_::are_node_queues_empty() -> bool
+/**
+ * @brief node_statuses returns the node types and last known statuses, VM nodes first.
+ * @note Reads the FSMs' status snapshots rather than taking the node locks, which the io threads
+ *       may hold for as long as a node takes to respond.
+ */
+auto DispatchFSM_::node_statuses() -> std::vector<std::pair<uint32_t, NodeStatus>>
 {
-    auto lock = node_registrar_.acquire();
-    auto& nodes = lock->nodes();
+    auto statuses = std::vector<std::pair<uint32_t, NodeStatus>>{};
 
-    auto nonempty = true;
+    {
+        auto vmns_lock = vm_node_fsms_.acquire();
+
+        std::for_each(vmns_lock->begin(),
+                      vmns_lock->end(),
+                      [&] (const VMNodeFSM& nfsm)
+        {
+            statuses.emplace_back(packet_type::cluster_request_vm_node,
+                                  nfsm->node_status());
+        });
+    }
 
-    for(const auto& n : nodes)
     {
-        auto nl = n->acquire();
+        auto svmns_lock = svm_node_fsms_.acquire();
+
+        std::for_each(svmns_lock->begin(),
+                      svmns_lock->end(),
+                      [&] (const SVMNodeFSM& nfsm)
+        {
+            statuses.emplace_back(packet_type::cluster_request_svm_node,
+                                  nfsm->node_status());
+        });
+    }
+
+    return statuses;
+}
+
+auto DispatchFSM_::are_node_queues_empty() -> bool
+{
+    auto nonempty = true;
 
-        const auto& st = nl->status;
+    for(const auto& n : node_statuses())
+    {
+        const auto& st = n.second;
 
         if(st.test_case_count != 0 || st.trace_count != 0)
         {
@@ -1893,16 +2122,11 @@ auto DispatchFSM_::are_all_queues_empty() -> bool
 
 auto DispatchFSM_::are_nodes_inactive() -> bool
 {
-    auto lock = node_registrar_.acquire();
-    auto& nodes = lock->nodes();
-
     auto inactive = true;
 
-    for(const auto& n : nodes)
+    for(const auto& n : node_statuses())
     {
-        auto nl = n->acquire();
-
-        const auto& st = nl->status;
+        const auto& st = n.second;
 
         if(st.active)
         {
@@ -1919,7 +2143,7 @@ auto DispatchFSM_::are_nodes_inactive() -> bool
                       vmns_lock->end(),
                       [&] (VMNodeFSM& nfsm)
         {
-            if(nfsm->is_flag_active<vm::flag::active>())
+            if(nfsm->is_busy() || nfsm->is_flag_active<vm::flag::active>())
             {
                 inactive = false;
 
@@ -1935,7 +2159,7 @@ auto DispatchFSM_::are_nodes_inactive() -> bool
                       svmns_lock->end(),
                       [&] (SVMNodeFSM& nfsm)
         {
-            if(nfsm->is_flag_active<svm::flag::active>())
+            if(nfsm->is_busy() || nfsm->is_flag_active<svm::flag::active>())
             {
                 inactive = false;
 
@@ -2121,16 +2345,17 @@ auto DispatchFSM_::display_status(std::ostream& os) -> void
          << setw(12) << "traces left"
          << "|";
 
+    const auto statuses = node_statuses();
+
     {
         auto count = 1u;
-        auto lock = node_registrar_.acquire();
-        for(const auto& node : lock->nodes())
+        for(const auto& node : statuses)
         {
             auto tt = std::string{};
 
             tt += to_string(count++);
 
-            if(node->acquire()->type == packet_type::cluster_request_vm_node)
+            if(node.first == packet_type::cluster_request_vm_node)
                 tt += "-[vm]";
             else
                 tt += "-[svm]";
@@ -2161,15 +2386,13 @@ auto DispatchFSM_::display_status(std::ostream& os) -> void
          << "|";
 
     {
-        auto lock = node_registrar_.acquire();
-        for(const auto& node : lock->nodes())
+        for(const auto& node : statuses)
         {
             auto tt = std::string{};
-            auto lock = node->acquire();
 
-            tt += to_string(lock->status.test_case_count) +
+            tt += to_string(node.second.test_case_count) +
                   "/" +
-                  to_string(lock->status.trace_count);
+                  to_string(node.second.trace_count);
             os << setw(14) << tt
                  << "|";
         }
@@ -2275,7 +2498,11 @@ auto Dispatch::run() -> bool
 
     // TODO: Is this appropriate here? Wouldn't it be better to leave the decision to act to the FSM?
     if(!has_nodes() && !dispatch_fsm_->is_flag_active<fsm::flag::terminated>())
+    {
+        dispatch_fsm_->wait_for_node_event(); // Until a node registers.
+
         return ret;
+    }
 
     if(dispatch_fsm_->is_flag_active<fsm::flag::terminated>())
     {
@@ -2351,54 +2578,62 @@ auto sort_by_test(NodeRegistrar::Nodes& nodes) -> void
     });
 }
 
+/**
+ * @brief node_server returns the connection to node, for I/O without holding the node lock.
+ * @note A node is only talked to by the actions of its FSM, whose events all run on the node's
+ *       strand (see DispatchFSM_::post_event()), or by the dispatch thread while no event is in
+ *       flight. Its I/O is thus serialized by the strand, and the lock is only taken to reach the
+ *       server, so that a node slow to respond holds up no thread other than the one running it.
+ */
+auto node_server(NodeRegistrar::Node& node) -> Server&
+{
+    return node->acquire()->server;
+}
+
+auto node_id(NodeRegistrar::Node& node) -> uint64_t
+{
+    return node->acquire()->status.id;
+}
+
 auto receive_trace(NodeRegistrar::Node& node,
                    const fs::path& traces_dir) -> fs::path
 {
-    auto lock = node->acquire();
+    auto& server = node_server(node);
 
     auto pkinfo = PacketInfo{0,0,0};
-    pkinfo.id = lock->status.id;
+    pkinfo.id = node_id(node);
     pkinfo.type = packet_type::cluster_trace_request;
 
-    lock->server.write(pkinfo);
+    server.write(pkinfo);
 
     auto trace_name = std::string{};
 
-    read_serialized_binary(lock->server,
+    read_serialized_binary(server,
                            trace_name,
                            packet_type::cluster_trace);
 
     auto trace = traces_dir / trace_name;
 
-    {
-        fs::ofstream ofs{trace,
-                         std::ios::out | std::ios::binary};
-
-        CRETE_EXCEPTION_ASSERT(ofs.good(),
-                               err::file_open_failed{trace.string()});
-
-        read(lock->server,
-             ofs);
-    }
-
-//    restore_directory(trace);
+    // Kept archived: it is only relayed to an svm-node.
+    read_file(server,
+              trace);
 
     return trace;
 }
 
 auto receive_tests(NodeRegistrar::Node& node) -> std::vector<TestCase>
 {
-    auto lock = node->acquire();
+    auto& server = node_server(node);
 
     auto pkinfo = PacketInfo{0,0,0};
-    pkinfo.id = lock->status.id;
+    pkinfo.id = node_id(node);
     pkinfo.type = packet_type::cluster_test_case_request;
 
-    lock->server.write(pkinfo);
+    server.write(pkinfo);
 
     auto tcs = std::vector<TestCase>{};
 
-    read_serialized_binary(lock->server,
+    read_serialized_binary(server,
                            tcs,
                            packet_type::cluster_test_case);
 
@@ -2407,17 +2642,17 @@ auto receive_tests(NodeRegistrar::Node& node) -> std::vector<TestCase>
 
 auto receive_errors(NodeRegistrar::Node& node) -> std::vector<log::NodeError>
 {
-    auto lock = node->acquire();
+    auto& server = node_server(node);
 
     auto pkinfo = PacketInfo{0,0,0};
-    pkinfo.id = lock->status.id;
+    pkinfo.id = node_id(node);
     pkinfo.type = packet_type::cluster_error_log_request;
 
-    lock->server.write(pkinfo);
+    server.write(pkinfo);
 
     auto errs = std::vector<log::NodeError>{};
 
-    read_serialized_binary(lock->server,
+    read_serialized_binary(server,
                            errs,
                            packet_type::cluster_test_case);
 
@@ -2428,15 +2663,15 @@ auto receive_image_info(NodeRegistrar::Node& node) -> ImageInfo
 {
     auto pkinfo = PacketInfo{0,0,0};
     auto image_info = ImageInfo{};
-    auto lock = node->acquire();
+    auto& server = node_server(node);
 
-    pkinfo.id = lock->status.id;
+    pkinfo.id = node_id(node);
     pkinfo.size = 0;
     pkinfo.type = packet_type::cluster_image_info_request;
 
-    lock->server.write(pkinfo);
+    server.write(pkinfo);
 
-    read_serialized_binary(lock->server,
+    read_serialized_binary(server,
                            image_info,
                            packet_type::cluster_image_info);
 
@@ -2446,79 +2681,184 @@ auto receive_image_info(NodeRegistrar::Node& node) -> ImageInfo
 auto transmit_trace(NodeRegistrar::Node& node,
                     const fs::path& trace) -> void
 {
-    auto lock = node->acquire();
+    auto& server = node_server(node);
 
     auto pkinfo = PacketInfo{0,0,0};
-    pkinfo.id = lock->status.id;
+    pkinfo.id = node_id(node);
     pkinfo.type = packet_type::cluster_trace;
 
-//    archive_directory(trace);
-
-    fs::ifstream ifs{trace,
-                     std::ios::in | std::ios::binary};
-
-    CRETE_EXCEPTION_ASSERT(ifs.good(),
-                           err::file_open_failed{trace.string()});
-
-    write_serialized_binary(lock->server,
+    write_serialized_binary(server,
                             pkinfo,
                             trace.filename().string());
 
-    write(lock->server,
-          ifs,
-          default_chunk_size);
+    write_file(server,
+               trace,
+               pkinfo);
+
+    fs::remove(trace); // Owned by the svm-node from now on.
 }
 
 auto transmit_tests(NodeRegistrar::Node& node,
-                   const std::vector<TestCase>& tcs) -> void
+                   const std::vector<TestCase>& tcs) -> NodeStatus
 {
     if(tcs.empty())
     {
-        return;
+        return node->acquire()->status;
     }
 
-    auto lock = node->acquire();
+    auto& server = node_server(node);
 
     auto pkinfo = PacketInfo{0,0,0};
-    pkinfo.id = lock->status.id;
+    pkinfo.id = node_id(node);
     pkinfo.type = packet_type::cluster_test_case;
 
-    write_serialized_binary(lock->server,
+    write_serialized_binary(server,
                             pkinfo,
                             tcs);
+
+    auto status = NodeStatus{};
+
+    read_serialized_binary(server,
+                           status,
+                           packet_type::cluster_status);
+
+    node->acquire()->status = status;
+
+    return status;
 }
 
 auto transmit_commencement(NodeRegistrar::Node& node) -> void
 {
-    auto lock = node->acquire();
-    lock->server.write(lock->status.id,
-                       packet_type::cluster_commence);
+    node_server(node).write(node_id(node),
+                            packet_type::cluster_commence);
 }
 
 auto transmit_image_info(NodeRegistrar::Node& node,
                          const ImageInfo& ii) -> void
 {
-    auto lock = node->acquire();
-
     auto pkinfo = PacketInfo{0,0,0};
-    pkinfo.id = lock->status.id;
+    pkinfo.id = node_id(node);
     pkinfo.type = packet_type::cluster_image_info;
 
-    write_serialized_binary(lock->server,
+    write_serialized_binary(node_server(node),
                             pkinfo,
                             ii);
 }
 
+/**
+ * @brief receive_image_manifest waits on the node to digest its image, which can take a while;
+ *        the node lock is not held meanwhile (see node_server()).
+ */
+auto receive_image_manifest(NodeRegistrar::Node& node) -> ImageManifest
+{
+    auto pkinfo = PacketInfo{0,0,0};
+    auto manifest = ImageManifest{};
+    auto& server = node_server(node);
+
+    pkinfo.id = node_id(node);
+    pkinfo.size = 0;
+    pkinfo.type = packet_type::cluster_image_manifest_request;
+
+    server.write(pkinfo);
+
+    read_serialized_binary(server,
+                           manifest,
+                           packet_type::cluster_image_manifest);
+
+    return manifest;
+}
+
+/**
+ * @brief transmit_image sends only the blocks of the image that the node does not already hold
+ *        (from a previous image or an interrupted transfer).
+ * @note Runs on the node's strand, without the node lock (see node_server()).
+ */
+auto transmit_image(NodeRegistrar::Node& node,
+                    const fs::path& image_path) -> void
+{
+    if(!fs::exists(image_path))
+    {
+        BOOST_THROW_EXCEPTION(Exception{} << err::file_missing{image_path.string()});
+    }
+
+    auto update = ImageUpdate{};
+
+    update.manifest_ = image_manifest(image_path);
+    update.blocks_ = differing_image_blocks(update.manifest_,
+                                            receive_image_manifest(node));
+
+    fs::ifstream ifs(image_path, std::ios::in | std::ios::binary);
+
+    CRETE_EXCEPTION_ASSERT(ifs.good(), err::file_open_failed{image_path.string()});
+
+    auto& server = node_server(node);
+    auto pkinfo = PacketInfo{0,0,0};
+
+    pkinfo.id = node_id(node);
+    pkinfo.type = packet_type::cluster_image;
+
+    write_serialized_binary(server,
+                            pkinfo,
+                            update);
+
+    std::cout << "Sending OS image to VM Node: "
+              << update.blocks_.size() << "/" << update.manifest_.digests_.size()
+              << " blocks differ" << std::endl;
+
+    const auto block_size = update.manifest_.block_size_;
+    auto buf = std::vector<char>(block_size);
+
+    for(const auto& block : update.blocks_)
+    {
+        auto offset = block * block_size;
+        auto len = std::min(block_size, update.manifest_.size_ - offset);
+
+        ifs.seekg(static_cast<std::streamoff>(offset));
+        ifs.read(buf.data(), static_cast<std::streamsize>(len));
+
+        CRETE_EXCEPTION_ASSERT(static_cast<uint64_t>(ifs.gcount()) == len,
+                               err::file(image_path.string()));
+
+        pkinfo.id = block;
+        pkinfo.size = len;
+        pkinfo.type = packet_type::cluster_image_block;
+
+        server.write(buf,
+                     pkinfo);
+    }
+}
+
+/**
+ * @brief image_manifest digests the image once per modification, rather than once per node.
+ */
+auto image_manifest(const fs::path& image_path) -> ImageManifest
+{
+    static std::mutex mutex;
+    static auto cache = std::map<std::string, std::pair<std::time_t, ImageManifest>>{};
+
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto last_write_time = fs::last_write_time(image_path);
+    auto& entry = cache[fs::canonical(image_path).string()];
+
+    if(entry.second.digests_.empty() ||
+       entry.first != last_write_time)
+    {
+        entry = std::make_pair(last_write_time,
+                               ImageManifest{image_path});
+    }
+
+    return entry.second;
+}
+
 auto transmit_config(NodeRegistrar::Node& node,
                      const option::Dispatch& options) -> void
 {
-    auto lock = node->acquire();
-
     auto pkinfo = PacketInfo{0,0,0};
-    pkinfo.id = lock->status.id;
+    pkinfo.id = node_id(node);
     pkinfo.type = packet_type::cluster_config;
 
-    write_serialized_binary(lock->server,
+    write_serialized_binary(node_server(node),
                             pkinfo,
                             options);
 
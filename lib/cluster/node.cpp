@@ -40,6 +40,9 @@ auto Node::status() const -> NodeStatus
     status.trace_count = traces_.size();
     status.error_count = errors_.size();
     status.active = active_;
+    status.test_case_credit = test_window_ > test_cases_.size()
+                              ? test_window_ - test_cases_.size()
+                              : 0;
 
     return status;
 }
@@ -151,6 +154,11 @@ auto Node::is_active() -> bool
     return active_;
 }
 
+auto Node::test_window(uint32_t n) -> void
+{
+    test_window_ = n;
+}
+
 auto Node::master_options() const -> const option::Dispatch&
 {
     return master_options_;
@@ -159,18 +159,23 @@ auto NodeRegistrarDriver::call_back(NodeRegistrar::Node& node) -> void
     }
 }
 
+/**
+ * @brief poll requests the node's status.
+ * @note The node lock is not held while waiting on the node. The node's I/O must be serialized
+ *       by the caller (Dispatch has one node FSM talk to each node).
+ */
 auto poll(NodeRegistrar::Node& node) -> NodeStatus
 {
-    auto lock = node->acquire();
-    lock->server.write(lock->status.id, // id of the node. For sanity check on the client (superfluous).
-                       packet_type::cluster_status_request);
+    auto& server = node->acquire()->server;
+    server.write(node->acquire()->status.id, // id of the node. For sanity check on the client (superfluous).
+                 packet_type::cluster_status_request);
 
     cluster::NodeStatus status;
-    read_serialized_binary(lock->server,
+    read_serialized_binary(server,
                            status,
                            packet_type::cluster_status);
 
-    lock->status = status;
+    node->acquire()->status = status;
 
     return status;
 }
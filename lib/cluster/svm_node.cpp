@@ -204,20 +204,13 @@ auto receive_trace(AtomicGuard<SVMNode>& node,
 
     auto trace = node.acquire()->traces_directory() / trace_name;
 
-    {
-        fs::ofstream ofs{trace,
-                         std::ios::out | std::ios::binary};
-
-        CRETE_EXCEPTION_ASSERT(ofs.good(),
-                               err::file_open_failed{trace.string()});
-
-        read(client,
-             ofs);
-    }
+    read_file(client,
+              trace);
 
     try
     {
-        restore_directory(trace);
+        restore_directory(trace,
+                          node.acquire()->master_options().trace.transfer_compressor());
     }
     catch(std::exception& e)
     {
@@ -28,6 +28,8 @@
 #include <boost/process.hpp>
 
 #include <memory>
+#include <future>
+#include <set>
 
 namespace bp = boost::process;
 namespace fs = boost::filesystem;
@@ -48,6 +50,8 @@ namespace svm
 
 const auto concolic_log_name = std::string{"concolic.log"};
 const auto symbolic_log_name = std::string{"klee-run.log"};
+const auto symbolic_shard_dir_prefix = std::string{"shard-"};
+const auto symbolic_min_branches_per_shard = 16u; // Below this, a shard's KLEE start-up dominates its solving.
 
 // +--------------------------------------------------+
 // + Exceptions                                       +
@@ -216,7 +220,7 @@ private:
     crete::log::Logger exception_log_;
     log::NodeError error_log_;
     std::shared_ptr<AtomicGuard<pid_t> > translator_child_pid_ = std::make_shared<AtomicGuard<pid_t> >(-1);
-    std::shared_ptr<AtomicGuard<pid_t> > klee_child_pid_ = std::make_shared<AtomicGuard<pid_t> >(-1);
+    std::shared_ptr<AtomicGuard<std::set<pid_t>> > klee_child_pids_ = std::make_shared<AtomicGuard<std::set<pid_t>> >();
 };
 
 template <class FSM,class Event>
@@ -538,101 +542,353 @@ static bool is_klee_log_correct(const boost::filesystem::path& file)
     return true;
 }
 
-struct KleeFSM_::execute_symbolic
+// Splits the trace-tag branches still to be negated (the semi-explored node followed by the new nodes)
+// into at most 'shards' contiguous groups of similar branch count, one base test per group.
+// Nodes preceding a group are marked explored and nodes following it are dropped, so each
+// crete-klee instance negates only its own group. Tag indices are unchanged from the original
+// base test, so the patches generated by every shard apply to it.
+static auto shard_trace_tag(const TestCase& base,
+                            uint32_t shards) -> std::vector<TestCase>
 {
-    template <class EVT,class FSM,class SourceState,class TargetState>
-    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState& ts) -> void
+    auto explored = base.get_traceTag_explored_nodes();
+    auto semi = base.get_traceTag_semi_explored_node();
+    auto fresh = base.get_traceTag_new_nodes();
+
+    // Unit 0 is the semi-explored node, if any; the rest are the new nodes.
+    auto units = creteTraceTag_ty{semi};
+    units.insert(units.end(), fresh.begin(), fresh.end());
+
+    auto total = size_t{0};
+    for(const auto& n : units)
     {
-        ts.async_task_.reset(new AsyncTask{[](fs::path trace_dir
-                                             ,cluster::option::Dispatch dispatch_options
-                                             ,option::SVMNode node_options
-                                             ,std::shared_ptr<AtomicGuard<pid_t>> child_pid)
+        total += n.m_br_taken.size();
+    }
+
+    shards = std::min<size_t>(shards, total / symbolic_min_branches_per_shard);
+
+    if(shards <= 1)
+    {
+        return std::vector<TestCase>{base};
+    }
+
+    auto explored_full = explored;
+    if(!semi.empty())
+    {
+        assert(!explored_full.empty());
+
+        auto& br = explored_full.back().m_br_taken;
+        br.insert(br.end(), semi.front().m_br_taken.begin(), semi.front().m_br_taken.end());
+    }
+
+    auto tests = std::vector<TestCase>{};
+    auto per_shard = (total + shards - 1) / shards;
+    auto begin = size_t{0};
+
+    while(begin < units.size())
+    {
+        auto end = begin;
+        auto count = size_t{0};
+
+        while(end < units.size() && (count < per_shard || end == begin))
         {
-            auto kdir = trace_dir / klee_dir_name;
+            count += units[end].m_br_taken.size();
+            ++end;
+        }
+
+        if(tests.size() + 1 == shards)
+        {
+            end = units.size();
+        }
+
+        auto tc = base;
+        auto semi_count = semi.size(); // 0 or 1
+
+        if(begin < semi_count)
+        {
+            tc.set_traceTag(explored,
+                            semi,
+                            creteTraceTag_ty(fresh.begin(), fresh.begin() + (end - semi_count)));
+        }
+        else
+        {
+            auto shard_explored = explored_full;
+            shard_explored.insert(shard_explored.end(),
+                                  fresh.begin(),
+                                  fresh.begin() + (begin - semi_count));
+
+            tc.set_traceTag(shard_explored,
+                            creteTraceTag_ty{},
+                            creteTraceTag_ty(fresh.begin() + (begin - semi_count),
+                                             fresh.begin() + (end - semi_count)));
+        }
+
+        tests.emplace_back(tc);
+
+        begin = end;
+    }
+
+    return tests;
+}
+
+static auto symbolic_executable(const option::SVMNode& node_options) -> std::string
+{
+    if(!node_options.svm.path.symbolic.empty())
+    {
+        return node_options.svm.path.symbolic;
+    }
+
+    return bp::find_executable_in_path("crete-klee");
+}
+
+static auto symbolic_args(const std::string& exe,
+                          const cluster::option::Dispatch& dispatch_options) -> std::vector<std::string>
+{
+    auto args = std::vector<std::string>{fs::path{exe}.filename().string()};
+
+    auto add_args = std::vector<std::string>{};
+
+    boost::split(add_args
+                ,dispatch_options.svm.args.symbolic
+                ,boost::is_any_of(" \t\n"));
+
+    add_args.erase(std::remove_if(add_args.begin(),
+                                  add_args.end(),
+                                  [](const std::string& s)
+                                  {
+                                      return s.empty();
+                                  }),
+                   add_args.end());
+
+    args.insert(args.end()
+               ,add_args.begin()
+               ,add_args.end());
+
+    args.emplace_back("run.bc");
+
+    return args;
+}
+
+// Runs crete-klee in 'kdir', logging its output to 'kdir'/klee-run.log.
+static auto run_symbolic(const fs::path& kdir,
+                         const std::string& exe,
+                         const std::vector<std::string>& args,
+                         std::shared_ptr<AtomicGuard<std::set<pid_t>>> child_pids) -> void
+{
+    bp::context ctx;
+    ctx.work_directory = kdir.string();
+    ctx.environment = bp::self::get_environment();
+    ctx.stdout_behavior = bp::capture_stream();
+    ctx.stderr_behavior = bp::redirect_stream_to_stdout();
+
+    auto proc = bp::launch(exe, args, ctx);
+    auto pid = static_cast<pid_t>(proc.get_id());
+
+    child_pids->acquire()->insert(pid);
+
+    auto log_path = kdir / symbolic_log_name;
+
+    {
+        fs::ofstream ofs(log_path);
+        if(!ofs.good())
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{log_path.string()});
+        }
+
+        bp::pistream& is = proc.get_stdout();
+        std::string line;
+        while(std::getline(is, line))
+        {
+            ofs << line << '\n';
+        }
+    }
+
+    auto status = proc.wait();
+
+    // FIXME: xxx Between 'auto status = proc.wait();' and this statement,
+    //           there is a chance this pid is reclaimed by other process.
+    child_pids->acquire()->erase(pid);
+
+    if(!process::is_exit_status_zero(status))
+    {
+        BOOST_THROW_EXCEPTION(SymbolicExecException{retrieve_tests_serialized((kdir / std::string(CRETE_SVM_TEST_FOLDER)).string())} << err::process_exit_status{exe});
+    }
 
-            bp::context ctx;
-            ctx.work_directory = kdir.string();
-            ctx.environment = bp::self::get_environment();
-            ctx.stdout_behavior = bp::capture_stream();
-            ctx.stderr_behavior = bp::redirect_stream_to_stdout();
+    if(!is_klee_log_correct(log_path))
+    {
+        BOOST_THROW_EXCEPTION(SymbolicExecException{retrieve_tests_serialized((kdir / std::string(CRETE_SVM_TEST_FOLDER)).string())} << err::process{exe});
+    }
+}
+
+static auto symbolic_shard_dirs(const fs::path& kdir) -> std::vector<fs::path>
+{
+    auto dirs = std::vector<fs::path>{};
+
+    for(fs::directory_iterator it(kdir), end; it != end; ++it)
+    {
+        if(fs::is_directory(it->path()) &&
+           it->path().filename().string().find(symbolic_shard_dir_prefix) == 0)
+        {
+            dirs.emplace_back(it->path());
+        }
+    }
 
-            auto exe = std::string{};
+    std::sort(dirs.begin(), dirs.end());
 
-            if(!node_options.svm.path.symbolic.empty())
+    return dirs;
+}
+
+// Each shard replays the whole trace in its own directory, sharing the prepared files via hard links.
+static auto execute_symbolic_shards(const fs::path& kdir,
+                                    const std::vector<TestCase>& shard_tests,
+                                    const std::string& exe,
+                                    const std::vector<std::string>& args,
+                                    std::shared_ptr<AtomicGuard<std::set<pid_t>>> child_pids) -> void
+{
+    auto futures = std::vector<std::future<void>>{};
+    auto shard_dirs = std::vector<fs::path>{};
+
+    for(const auto& i : boost::irange(size_t(0), shard_tests.size()))
+    {
+        auto sdir = kdir / (symbolic_shard_dir_prefix + std::to_string(i));
+
+        fs::create_directory(sdir);
+
+        for(fs::directory_iterator it(kdir), end; it != end; ++it)
+        {
+            auto filename = it->path().filename().string();
+
+            if(fs::is_regular_file(it->path()) &&
+               filename != "concrete_inputs.bin" &&
+               filename != symbolic_log_name)
             {
-                exe = node_options.svm.path.symbolic;
+                fs::create_hard_link(it->path(), sdir / filename);
             }
-            else
+        }
+
+        {
+            fs::ofstream ofs(sdir / "concrete_inputs.bin", std::ios_base::out | std::ios_base::binary);
+            if(!ofs.good())
             {
-                exe = bp::find_executable_in_path("crete-klee");
+                BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{(sdir / "concrete_inputs.bin").string()});
             }
 
-            auto args = std::vector<std::string>{fs::path{exe}.filename().string()};
+            write_serialized(ofs, shard_tests[i]);
+        }
 
-            auto add_args = std::vector<std::string>{};
+        shard_dirs.emplace_back(sdir);
+        futures.emplace_back(std::async(std::launch::async,
+                                        run_symbolic,
+                                        sdir,
+                                        exe,
+                                        args,
+                                        child_pids));
+    }
 
-            boost::split(add_args
-                        ,dispatch_options.svm.args.symbolic
-                        ,boost::is_any_of(" \t\n"));
+    auto exception = std::exception_ptr{};
+    auto tests = std::vector<TestCase>{};
 
-            add_args.erase(std::remove_if(add_args.begin(),
-                                          add_args.end(),
-                                          [](const std::string& s)
-                                          {
-                                              return s.empty();
-                                          }),
-                           add_args.end());
+    for(auto& f : futures)
+    {
+        try
+        {
+            f.get();
+        }
+        catch(SymbolicExecException& e)
+        {
+            tests.insert(tests.end(), e.tests_.begin(), e.tests_.end());
 
-            args.insert(args.end()
-                       ,add_args.begin()
-                       ,add_args.end());
+            if(!exception)
+            {
+                exception = std::current_exception();
+            }
+        }
+        catch(...)
+        {
+            if(!exception)
+            {
+                exception = std::current_exception();
+            }
+        }
+    }
 
-            args.emplace_back("run.bc");
+    // Gather the shard logs where the error report expects the log of a single run.
+    {
+        fs::ofstream ofs(kdir / symbolic_log_name);
 
-            for(auto& e : args)
-                std::cerr << e << std::endl;
+        for(const auto& sdir : shard_dirs)
+        {
+            fs::ifstream ifs(sdir / symbolic_log_name);
 
-            auto proc = bp::launch(exe, args, ctx);
+            if(ifs.good() && ifs.peek() != std::ifstream::traits_type::eof())
+            {
+                ofs << ifs.rdbuf();
+            }
+        }
+    }
 
-            child_pid->acquire() = proc.get_id();
+    if(!exception)
+    {
+        return;
+    }
 
-            auto log_path = kdir / symbolic_log_name;
+    try
+    {
+        std::rethrow_exception(exception);
+    }
+    catch(SymbolicExecException& e)
+    {
+        e.tests_ = tests; // Report the tests of all shards, not only the failed one.
 
-            {
-                fs::ofstream ofs(log_path);
-                if(!ofs.good())
-                {
-                    BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{log_path.string()});
-                }
+        throw;
+    }
+}
 
-                bp::pistream& is = proc.get_stdout();
-                std::string line;
-                while(std::getline(is, line))
-                {
-                    ofs << line << '\n';
-                }
-            }
+struct KleeFSM_::execute_symbolic
+{
+    template <class EVT,class FSM,class SourceState,class TargetState>
+    auto operator()(EVT const&, FSM& fsm, SourceState&, TargetState& ts) -> void
+    {
+        ts.async_task_.reset(new AsyncTask{[](fs::path trace_dir
+                                             ,cluster::option::Dispatch dispatch_options
+                                             ,option::SVMNode node_options
+                                             ,std::shared_ptr<AtomicGuard<std::set<pid_t>>> child_pids)
+        {
+            auto kdir = trace_dir / klee_dir_name;
 
-            auto status = proc.wait();
+            auto exe = symbolic_executable(node_options);
+            auto args = symbolic_args(exe, dispatch_options);
 
-            // FIXME: xxx Between 'auto status = proc.wait();' and this statement,
-            //           there is a chance this pid is reclaimed by other process.
-            child_pid->acquire() = -1;
+            for(auto& e : args)
+                std::cerr << e << std::endl;
 
-            if(!process::is_exit_status_zero(status))
+            auto shard_tests = std::vector<TestCase>{};
+
+            if(node_options.svm.shards > 1)
             {
-                BOOST_THROW_EXCEPTION(SymbolicExecException{retrieve_tests_serialized((kdir / std::string(CRETE_SVM_TEST_FOLDER)).string())} << err::process_exit_status{exe});
+                shard_tests = shard_trace_tag(retrieve_test_serialized((kdir / "concrete_inputs.bin").string()),
+                                              node_options.svm.shards);
             }
 
-            if(!is_klee_log_correct(log_path))
+            if(shard_tests.size() > 1)
             {
-                BOOST_THROW_EXCEPTION(SymbolicExecException{retrieve_tests_serialized((kdir / std::string(CRETE_SVM_TEST_FOLDER)).string())} << err::process{exe});
+                execute_symbolic_shards(kdir,
+                                        shard_tests,
+                                        exe,
+                                        args,
+                                        child_pids);
+            }
+            else
+            {
+                run_symbolic(kdir,
+                             exe,
+                             args,
+                             child_pids);
             }
         }
         , fsm.trace_dir_
         , fsm.dispatch_options_
         , fsm.node_options_
-        , fsm.klee_child_pid_});
+        , fsm.klee_child_pids_});
     }
 };
 
@@ -648,6 +904,13 @@ struct KleeFSM_::retrieve_result
 
             std::vector<TestCase> tmp_tsts = retrieve_tests_serialized((kdir / std::string(CRETE_SVM_TEST_FOLDER)).string());
 
+            for(const auto& sdir : symbolic_shard_dirs(kdir))
+            {
+                auto shard_tsts = retrieve_tests_serialized((sdir / std::string(CRETE_SVM_TEST_FOLDER)).string());
+
+                tmp_tsts.insert(tmp_tsts.end(), shard_tsts.begin(), shard_tsts.end());
+            }
+
             tests->clear();
             // Retrieve the base test case at first
             tests->push_back(retrieve_test_serialized((trace_dir / "concrete_inputs.bin").string()));
@@ -719,21 +982,24 @@ struct KleeFSM_::terminate
         }
 
         {
-            assert(fsm.klee_child_pid_);
-            auto lock = fsm.klee_child_pid_->acquire();
-            auto pid = static_cast<pid_t>(lock);
-            if(pid != -1 &&
-                    process::is_running(pid))
+            assert(fsm.klee_child_pids_);
+            auto lock = fsm.klee_child_pids_->acquire();
+            for(auto it = lock->begin(); it != lock->end(); ++it)
             {
-                if(::kill(pid, SIGKILL) != 0)
+                auto pid = *it;
+
+                if(process::is_running(pid))
                 {
-                    BOOST_THROW_EXCEPTION(Exception{} << err::process{"failed to kill crete-klee instance"}
-                    << err::process_error{pid}
-                    << err::c_errno{errno});
+                    if(::kill(pid, SIGKILL) != 0)
+                    {
+                        BOOST_THROW_EXCEPTION(Exception{} << err::process{"failed to kill crete-klee instance"}
+                        << err::process_error{pid}
+                        << err::c_errno{errno});
+                    }
+
+                    while(process::is_running(pid)) {} // TODO: is this check necessary?
                 }
-
-                while(process::is_running(pid)) {} // TODO: is this check necessary?
-            };
+            }
         }
 
         {
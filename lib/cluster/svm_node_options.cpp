@@ -36,6 +36,7 @@ SVM::SVM(const pt::ptree& tree)
         path.concolic = svm.get<std::string>("path.concolic", path.concolic);
         path.symbolic = svm.get<std::string>("path.symbolic", path.symbolic);
         count = svm.get<uint32_t>("count", count);
+        shards = svm.get<uint32_t>("shards", shards);
 
         if(!path.concolic.empty())
         {
@@ -54,6 +55,11 @@ SVM::SVM(const pt::ptree& tree)
         {
             BOOST_THROW_EXCEPTION(Exception{} << err::arg_invalid_str{"crete.svm.count"});
         }
+
+        if(shards == 0)
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::arg_invalid_str{"crete.svm.shards"});
+        }
     }
 }
 
@@ -0,0 +1,106 @@
+#include <boost/test/unit_test.hpp>
+
+#include <crete/memo_sync.h>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(crete_memo_sync)
+
+BOOST_AUTO_TEST_CASE(memo_sync_round_trip)
+{
+    using namespace crete;
+
+    const auto values = std::vector<uint8_t>{1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+    std::ostringstream os{std::ios_base::binary};
+
+    write_memo_sync_count(os, 3);
+    // Table 0: two ranges
+    write_memo_sync_count(os, 2);
+    write_memo_sync_range(os, 0x1000, 4, values.data());
+    write_memo_sync_range(os, 0x2000, 5, values.data() + 4);
+    // Table 1: none
+    write_memo_sync_count(os, 0);
+    // Table 2: an empty range
+    write_memo_sync_count(os, 1);
+    write_memo_sync_range(os, 0x3000, 0, values.data());
+
+    const auto data = os.str();
+
+    BOOST_CHECK_EQUAL(data.size(), 8*4 + (16 + 4) + (16 + 5) + 16);
+
+    MemoSyncReader reader{data.data(), data.size()};
+    auto addr = uint64_t{0};
+    auto size = uint64_t{0};
+
+    BOOST_REQUIRE_EQUAL(reader.read_count(), 3u);
+
+    BOOST_REQUIRE_EQUAL(reader.read_count(), 2u);
+    auto range = reader.read_range(addr, size);
+    BOOST_CHECK_EQUAL(addr, 0x1000u);
+    BOOST_REQUIRE_EQUAL(size, 4u);
+    BOOST_CHECK(std::equal(range, range + size, values.begin()));
+    range = reader.read_range(addr, size);
+    BOOST_CHECK_EQUAL(addr, 0x2000u);
+    BOOST_REQUIRE_EQUAL(size, 5u);
+    BOOST_CHECK(std::equal(range, range + size, values.begin() + 4));
+
+    BOOST_CHECK_EQUAL(reader.read_count(), 0u);
+
+    BOOST_REQUIRE_EQUAL(reader.read_count(), 1u);
+    reader.read_range(addr, size);
+    BOOST_CHECK_EQUAL(addr, 0x3000u);
+    BOOST_CHECK_EQUAL(size, 0u);
+
+    BOOST_CHECK(reader.at_end());
+}
+
+BOOST_AUTO_TEST_CASE(memo_sync_truncated)
+{
+    using namespace crete;
+
+    const auto values = std::vector<uint8_t>(16, 0xff);
+
+    std::ostringstream os{std::ios_base::binary};
+
+    write_memo_sync_count(os, 1);
+    write_memo_sync_count(os, 1);
+    write_memo_sync_range(os, 0x1000, values.size(), values.data());
+
+    const auto data = os.str();
+    auto addr = uint64_t{0};
+    auto size = uint64_t{0};
+
+    // Cut within the values
+    {
+        MemoSyncReader reader{data.data(), data.size() - 1};
+
+        reader.read_count();
+        reader.read_count();
+
+        BOOST_CHECK_THROW(reader.read_range(addr, size), std::runtime_error);
+    }
+
+    // Cut within the range header
+    {
+        MemoSyncReader reader{data.data(), 8*2 + 12};
+
+        reader.read_count();
+        reader.read_count();
+
+        BOOST_CHECK_THROW(reader.read_range(addr, size), std::runtime_error);
+    }
+
+    // Cut within a count
+    {
+        MemoSyncReader reader{data.data(), 4};
+
+        BOOST_CHECK_THROW(reader.read_count(), std::runtime_error);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
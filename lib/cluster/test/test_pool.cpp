@@ -0,0 +1,155 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <crete/cluster/test_pool.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+struct TempDir
+{
+    TempDir() :
+        path{boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()}
+    {
+    }
+    ~TempDir()
+    {
+        boost::filesystem::remove_all(path);
+    }
+
+    boost::filesystem::path path;
+};
+
+auto make_test(uint64_t issue_index,
+               std::size_t size) -> crete::TestCase
+{
+    auto elem = crete::TestCaseElement{};
+    elem.name = {'a'};
+    elem.name_size = 1;
+    elem.data = std::vector<uint8_t>(size, static_cast<uint8_t>(issue_index));
+    elem.data_size = size;
+
+    auto tc = crete::TestCase{};
+    tc.add_element(elem);
+    tc.set_issue_index(issue_index);
+
+    return tc;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(crete_cluster_test_pool)
+
+BOOST_AUTO_TEST_CASE(test_log_rollover_and_read_back)
+{
+    using namespace crete;
+    using namespace crete::cluster;
+
+    TempDir dir;
+    auto records = std::vector<TestLogRecord>{};
+    const auto count = 80u; // Of 1MB each, so the log rolls over to a second segment.
+
+    {
+        TestLog log{dir.path};
+
+        for(auto i = 1u; i <= count; ++i)
+        {
+            records.push_back(log.append(make_test(i, 1 << 20)));
+        }
+
+        BOOST_CHECK_EQUAL(records.front().segment, 0u);
+        BOOST_CHECK_EQUAL(records.back().segment, 1u);
+
+        // Out of order, across the sealed and the current segment
+        for(auto i = 0u; i < count; i += 7)
+        {
+            const auto& record = records[count - 1 - i];
+
+            log.prefetch(record);
+
+            auto tc = log.read(record);
+
+            BOOST_CHECK_EQUAL(tc.get_issue_index(), count - i);
+            BOOST_CHECK_EQUAL(tc.get_elements()[0].data.size(), 1u << 20);
+            BOOST_CHECK_EQUAL(tc.get_elements()[0].data.back(), static_cast<uint8_t>(count - i));
+        }
+    }
+
+    auto tcs = retrieve_tests_log(dir.path.string());
+
+    BOOST_REQUIRE_EQUAL(tcs.size(), count);
+
+    for(auto i = 0u; i < count; ++i)
+    {
+        BOOST_CHECK_EQUAL(tcs[i].get_issue_index(), i + 1);
+    }
+
+    auto index = index_tests_log(dir.path.string());
+
+    BOOST_REQUIRE_EQUAL(index.size(), count);
+    BOOST_CHECK_EQUAL(retrieve_test_log(index.at(count)).get_issue_index(), count);
+}
+
+BOOST_AUTO_TEST_CASE(fingerprint_set_spill_and_merge)
+{
+    using namespace crete::cluster;
+
+    TempDir dir;
+    // 50 spills, enough to have the runs merged several times
+    TestFingerprintSet set{dir.path, 100};
+    std::mt19937_64 rng{1};
+    auto fps = std::vector<TestFingerprint>{};
+
+    for(auto i = 0u; i < 5000; ++i)
+    {
+        auto fp = TestFingerprint{rng() | 1, rng()};
+
+        fps.push_back(fp);
+
+        BOOST_CHECK(set.insert(fp));
+    }
+
+    BOOST_CHECK_EQUAL(set.size(), fps.size());
+
+    for(const auto& fp : fps)
+    {
+        BOOST_CHECK(!set.insert(fp));
+    }
+
+    BOOST_CHECK_EQUAL(set.size(), fps.size());
+    BOOST_CHECK(set.insert(TestFingerprint{rng() | 1, rng()}));
+}
+
+BOOST_AUTO_TEST_CASE(base_test_cache_lru_eviction)
+{
+    using namespace crete::cluster;
+
+    BaseTestCache cache{300};
+
+    for(auto i = 1u; i <= 3; ++i)
+    {
+        cache.insert(make_test(i, 1), 100);
+    }
+
+    BOOST_CHECK(cache.contains(1) && cache.contains(2) && cache.contains(3));
+
+    // A hit makes 1 the most recently used, so 2 goes first.
+    BOOST_CHECK(cache.find(1));
+    cache.insert(make_test(4, 1), 100);
+
+    BOOST_CHECK(cache.contains(1));
+    BOOST_CHECK(!cache.contains(2));
+    BOOST_CHECK(cache.contains(3) && cache.contains(4));
+    BOOST_CHECK(!cache.find(2));
+
+    // Kept even though it alone exceeds the capacity, evicting all others
+    cache.insert(make_test(5, 1), 1000);
+
+    BOOST_CHECK(cache.contains(5));
+    BOOST_CHECK(!cache.contains(1) && !cache.contains(3) && !cache.contains(4));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
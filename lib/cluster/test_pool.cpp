@@ -1,9 +1,17 @@
 #include <crete/cluster/test_pool.h>
 
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <sstream>
 #include <stdexcept>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 
@@ -16,16 +24,19 @@ namespace crete
 namespace cluster
 {
 
-const static uint64_t BASE_TEST_CACHE_SIZE = 200;
+const static uint64_t base_test_cache_size = 64 * 1024 * 1024; // Serialized bytes of cached base tcs.
+const static size_t base_test_prefetch_count = 16; // Queue entries whose base tcs are prefetched.
+const static uint64_t test_log_segment_size = 64 * 1024 * 1024; // A new segment is started beyond this.
+const static uint64_t test_log_sync_size = 4 * 1024 * 1024; // Unsynced appends beyond this are fdatasync'ed.
 
-bool TestPriority::operator() (const TestCase& lhs, const TestCase& rhs) const
+bool TestPriority::operator() (const TestQueueEntry& lhs, const TestQueueEntry& rhs) const
 {
   if (m_tc_sched_strat == FIFO)
   {
       return false;
   } else if (m_tc_sched_strat == BFS) {
-      if(lhs.get_tt_last_node_index()
-              > rhs.get_tt_last_node_index())
+      if(lhs.tt_last_node_index
+              > rhs.tt_last_node_index)
       {
           return true;
       } else {
@@ -38,10 +49,624 @@ bool TestPriority::operator() (const TestCase& lhs, const TestCase& rhs) const
   }
 }
 
-TestPool::TestPool(const fs::path& root)
+// +--------------------------------------------------+
+// + Test fingerprints                                +
+// +--------------------------------------------------+
+
+const static uint64_t fingerprint_table_initial_size = 1024; // Power of 2.
+const static uint64_t fingerprint_max_runs = 8; // Runs are merged beyond this, bounding the lookup cost.
+const static auto fingerprint_dir_name = std::string{"test-fingerprint"};
+
+static inline uint64_t rotl64(uint64_t x, int8_t r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+
+    return k;
+}
+
+// MurmurHash3_x64_128 (public domain, Austin Appleby)
+static auto murmur3_128(const uint8_t* data, uint64_t size) -> TestFingerprint
+{
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    const uint64_t nblocks = size / 16;
+
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+
+    for(uint64_t i = 0; i < nblocks; ++i)
+    {
+        uint64_t k1;
+        uint64_t k2;
+        memcpy(&k1, data + i * 16, sizeof(k1));
+        memcpy(&k2, data + i * 16 + 8, sizeof(k2));
+
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const uint8_t* tail = data + nblocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+
+    switch(size & 15)
+    {
+    case 15: k2 ^= uint64_t(tail[14]) << 48; // fallthrough
+    case 14: k2 ^= uint64_t(tail[13]) << 40; // fallthrough
+    case 13: k2 ^= uint64_t(tail[12]) << 32; // fallthrough
+    case 12: k2 ^= uint64_t(tail[11]) << 24; // fallthrough
+    case 11: k2 ^= uint64_t(tail[10]) << 16; // fallthrough
+    case 10: k2 ^= uint64_t(tail[ 9]) << 8; // fallthrough
+    case  9: k2 ^= uint64_t(tail[ 8]);
+             k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2; // fallthrough
+    case  8: k1 ^= uint64_t(tail[ 7]) << 56; // fallthrough
+    case  7: k1 ^= uint64_t(tail[ 6]) << 48; // fallthrough
+    case  6: k1 ^= uint64_t(tail[ 5]) << 40; // fallthrough
+    case  5: k1 ^= uint64_t(tail[ 4]) << 32; // fallthrough
+    case  4: k1 ^= uint64_t(tail[ 3]) << 24; // fallthrough
+    case  3: k1 ^= uint64_t(tail[ 2]) << 16; // fallthrough
+    case  2: k1 ^= uint64_t(tail[ 1]) << 8; // fallthrough
+    case  1: k1 ^= uint64_t(tail[ 0]);
+             k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= size;
+    h2 ^= size;
+
+    h1 += h2;
+    h2 += h1;
+
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+
+    h1 += h2;
+    h2 += h1;
+
+    return TestFingerprint{h1, h2};
+}
+
+template <typename T>
+static auto append_bytes(std::vector<uint8_t>& buf, const T& value) -> void
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    buf.insert(buf.end(), bytes, bytes + sizeof(value));
+}
+
+/**
+ * @brief Fingerprint of the fields compared by TestCaseElement::operator==, each
+ *        vector prefixed by its length so element boundaries are unambiguous.
+ */
+auto fingerprint(const TestCaseElements& elems) -> TestFingerprint
+{
+    static thread_local std::vector<uint8_t> buf;
+    buf.clear();
+
+    append_bytes(buf, static_cast<uint64_t>(elems.size()));
+
+    for(const auto& e : elems)
+    {
+        append_bytes(buf, e.name_size);
+        append_bytes(buf, static_cast<uint64_t>(e.name.size()));
+        buf.insert(buf.end(), e.name.begin(), e.name.end());
+        append_bytes(buf, e.data_size);
+        append_bytes(buf, static_cast<uint64_t>(e.data.size()));
+        buf.insert(buf.end(), e.data.begin(), e.data.end());
+    }
+
+    auto fp = murmur3_128(buf.data(), buf.size());
+
+    if(fp.lo == 0 && fp.hi == 0) // Reserved for empty slots.
+    {
+        fp.lo = 1;
+    }
+
+    return fp;
+}
+
+/**
+ * @brief Sorted fingerprints in a file, mapped read-only. The file is removed with the run.
+ */
+class TestFingerprintSet::Run
+{
+public:
+    Run(const fs::path& path,
+        const std::vector<TestFingerprint>& sorted)
+        : path_(path)
+        , size_(sorted.size())
+    {
+        {
+            fs::ofstream ofs(path_, std::ios_base::out | std::ios_base::binary);
+
+            ofs.write(reinterpret_cast<const char*>(sorted.data()),
+                      sorted.size() * sizeof(TestFingerprint));
+
+            if(!ofs.good())
+            {
+                BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{path_.string()});
+            }
+        }
+
+        if(size_ == 0)
+        {
+            return;
+        }
+
+        auto fd = ::open(path_.string().c_str(), O_RDONLY | O_CLOEXEC);
+
+        if(fd < 0)
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{path_.string()});
+        }
+
+        auto map = ::mmap(nullptr, size_ * sizeof(TestFingerprint), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        if(map == MAP_FAILED)
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::file_open_failed{path_.string()});
+        }
+
+        fps_ = static_cast<const TestFingerprint*>(map);
+    }
+
+    ~Run()
+    {
+        if(fps_)
+        {
+            ::munmap(const_cast<TestFingerprint*>(fps_), size_ * sizeof(TestFingerprint));
+        }
+
+        boost::system::error_code ec;
+        fs::remove(path_, ec);
+    }
+
+    Run(const Run&) = delete;
+    Run& operator=(const Run&) = delete;
+
+    auto contains(const TestFingerprint& fp) const -> bool
+    {
+        return std::binary_search(begin(), end(), fp);
+    }
+
+    auto begin() const -> const TestFingerprint* { return fps_; }
+    auto end() const -> const TestFingerprint* { return fps_ + size_; }
+
+private:
+    fs::path path_;
+    uint64_t size_;
+    const TestFingerprint* fps_{nullptr};
+};
+
+TestFingerprintSet::TestFingerprintSet(const fs::path& spill_dir,
+                                       uint64_t spill_size)
+    : spill_dir_(spill_dir)
+    , spill_size_(spill_size)
+    , table_(fingerprint_table_initial_size, TestFingerprint{0, 0})
+{
+}
+
+auto TestFingerprintSet::insert(const TestFingerprint& fp) -> bool
+{
+    assert(fp.lo != 0 || fp.hi != 0);
+
+    auto i = slot(fp);
+
+    if(table_[i] == fp)
+    {
+        return false;
+    }
+
+    for(const auto& run : runs_)
+    {
+        if(run->contains(fp))
+        {
+            return false;
+        }
+    }
+
+    table_[i] = fp;
+    ++table_count_;
+    ++size_;
+
+    if(spill_size_ != 0 && table_count_ >= spill_size_)
+    {
+        spill();
+    }
+    else if(table_count_ * 2 > table_.size())
+    {
+        grow();
+    }
+
+    return true;
+}
+
+auto TestFingerprintSet::size() const -> uint64_t
+{
+    return size_;
+}
+
+// Slot holding fp, or the empty slot where it goes (linear probing)
+auto TestFingerprintSet::slot(const TestFingerprint& fp) const -> uint64_t
+{
+    const auto mask = table_.size() - 1;
+    auto i = fp.lo & mask;
+
+    while(table_[i] != fp && (table_[i].lo != 0 || table_[i].hi != 0))
+    {
+        i = (i + 1) & mask;
+    }
+
+    return i;
+}
+
+auto TestFingerprintSet::grow() -> void
+{
+    auto old = std::vector<TestFingerprint>(table_.size() * 2, TestFingerprint{0, 0});
+    old.swap(table_);
+
+    for(const auto& fp : old)
+    {
+        if(fp.lo != 0 || fp.hi != 0)
+        {
+            table_[slot(fp)] = fp;
+        }
+    }
+}
+
+auto TestFingerprintSet::spill() -> void
+{
+    auto sorted = std::vector<TestFingerprint>{};
+    sorted.reserve(table_count_);
+
+    for(auto& fp : table_)
+    {
+        if(fp.lo != 0 || fp.hi != 0)
+        {
+            sorted.push_back(fp);
+            fp = TestFingerprint{0, 0};
+        }
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+
+    runs_.push_back(new_run(sorted));
+    table_count_ = 0;
+
+    if(runs_.size() > fingerprint_max_runs)
+    {
+        merge_runs();
+    }
+}
+
+auto TestFingerprintSet::merge_runs() -> void
+{
+    auto merged = std::vector<TestFingerprint>{};
+    merged.reserve(size_ - table_count_);
+
+    for(const auto& run : runs_)
+    {
+        auto middle = merged.size();
+
+        merged.insert(merged.end(), run->begin(), run->end());
+        std::inplace_merge(merged.begin(), merged.begin() + middle, merged.end());
+    }
+
+    runs_.clear();
+    runs_.push_back(new_run(merged));
+}
+
+auto TestFingerprintSet::new_run(const std::vector<TestFingerprint>& sorted) -> std::shared_ptr<Run>
+{
+    if(!fs::exists(spill_dir_))
+    {
+        fs::create_directories(spill_dir_);
+    }
+
+    return std::make_shared<Run>(spill_dir_ / fs::unique_path("run-%%%%-%%%%-%%%%"),
+                                 sorted);
+}
+
+// +--------------------------------------------------+
+// + TestLog                                          +
+// +--------------------------------------------------+
+
+class TestLog::Segment
+{
+public:
+    Segment(const fs::path& path)
+        : path_(path)
+    {
+        fd_ = ::open(path_.string().c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+        if(fd_ < 0)
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::file_create{path_.string()});
+        }
+    }
+
+    ~Segment()
+    {
+        if(map_)
+        {
+            ::munmap(const_cast<char*>(map_), size_);
+        }
+
+        ::fdatasync(fd_);
+        ::close(fd_);
+    }
+
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    auto write(const void* data, uint64_t size) -> void
+    {
+        auto p = static_cast<const char*>(data);
+
+        while(size > 0)
+        {
+            auto n = ::write(fd_, p, size);
+
+            if(n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if(n <= 0)
+            {
+                BOOST_THROW_EXCEPTION(Exception{} << err::file{path_.string()});
+            }
+
+            p += n;
+            size -= n;
+            size_ += n;
+        }
+    }
+
+    auto read(void* data, uint64_t size, uint64_t offset) const -> void
+    {
+        if(map_)
+        {
+            assert(offset + size <= size_);
+            memcpy(data, map_ + offset, size);
+
+            return;
+        }
+
+        auto p = static_cast<char*>(data);
+
+        while(size > 0)
+        {
+            auto n = ::pread(fd_, p, size, offset);
+
+            if(n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if(n <= 0)
+            {
+                BOOST_THROW_EXCEPTION(Exception{} << err::file{path_.string()});
+            }
+
+            p += n;
+            size -= n;
+            offset += n;
+        }
+    }
+
+    auto prefetch(uint64_t size, uint64_t offset) const -> void
+    {
+        if(map_)
+        {
+            const auto page_mask = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE)) - 1;
+            const auto begin = offset & ~page_mask;
+
+            ::madvise(const_cast<char*>(map_) + begin, offset + size - begin, MADV_WILLNEED);
+        }
+        else
+        {
+            ::posix_fadvise(fd_, offset, size, POSIX_FADV_WILLNEED);
+        }
+    }
+
+    auto sync() -> void
+    {
+        if(::fdatasync(fd_) != 0)
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::file{path_.string()});
+        }
+    }
+
+    // No more writes; reads go through a read-only mapping from now on
+    auto seal() -> void
+    {
+        if(size_ == 0)
+        {
+            return;
+        }
+
+        auto map = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+
+        if(map == MAP_FAILED)
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::file{path_.string()});
+        }
+
+        map_ = static_cast<const char*>(map);
+    }
+
+    auto size() const -> uint64_t
+    {
+        return size_;
+    }
+
+private:
+    fs::path path_;
+    int fd_;
+    uint64_t size_{0};
+    const char* map_{nullptr};
+};
+
+TestLog::TestLog(const fs::path& dir)
+    : dir_(dir)
+{
+}
+
+auto TestLog::append(const TestCase& tc) -> TestLogRecord
+{
+    std::ostringstream oss(std::ios_base::out | std::ios_base::binary);
+    write_serialized(oss, tc);
+
+    const auto data = oss.str();
+    const auto size = static_cast<uint64_t>(data.size());
+
+    if(segments_.empty() || segments_.back()->size() >= test_log_segment_size)
+    {
+        roll();
+    }
+
+    auto& segment = *segments_.back();
+
+    segment.write(&size, sizeof(size));
+
+    auto record = TestLogRecord{static_cast<uint32_t>(segments_.size() - 1),
+                                segment.size(),
+                                size};
+
+    segment.write(data.data(), size);
+
+    unsynced_ += sizeof(size) + size;
+
+    if(unsynced_ >= test_log_sync_size)
+    {
+        sync();
+    }
+
+    return record;
+}
+
+auto TestLog::read(const TestLogRecord& record) const -> TestCase
+{
+    assert(record.segment < segments_.size());
+
+    auto data = std::string(record.size, '\0');
+
+    segments_[record.segment]->read(&data[0], record.size, record.offset);
+
+    std::istringstream iss(data, std::ios_base::in | std::ios_base::binary);
+
+    return read_serialized(iss);
+}
+
+auto TestLog::prefetch(const TestLogRecord& record) const -> void
+{
+    assert(record.segment < segments_.size());
+
+    segments_[record.segment]->prefetch(record.size, record.offset);
+}
+
+auto TestLog::sync() -> void
+{
+    if(unsynced_ != 0)
+    {
+        segments_.back()->sync();
+        unsynced_ = 0;
+    }
+}
+
+// Earlier segments are complete, so only the current one ever needs syncing
+auto TestLog::roll() -> void
+{
+    sync();
+
+    if(segments_.empty())
+    {
+        if(!fs::exists(dir_))
+        {
+            fs::create_directories(dir_);
+        }
+    }
+    else
+    {
+        segments_.back()->seal();
+    }
+
+    segments_.push_back(std::make_shared<Segment>(dir_ / (std::to_string(segments_.size()) + ".log")));
+}
+
+// +--------------------------------------------------+
+// + BaseTestCache                                    +
+// +--------------------------------------------------+
+
+BaseTestCache::BaseTestCache(uint64_t capacity)
+    : capacity_(capacity)
+{
+}
+
+auto BaseTestCache::find(TestCaseIssueIndex index) -> const TestCase*
+{
+    auto it = index_.find(index);
+
+    if(it == index_.end())
+    {
+        return nullptr;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+
+    return &it->second->first;
+}
+
+auto BaseTestCache::contains(TestCaseIssueIndex index) const -> bool
+{
+    return index_.find(index) != index_.end();
+}
+
+auto BaseTestCache::insert(const TestCase& tc, uint64_t size) -> const TestCase&
+{
+    assert(!contains(tc.get_issue_index()));
+
+    lru_.emplace_front(tc, size);
+    index_.emplace(tc.get_issue_index(), lru_.begin());
+    size_ += size;
+
+    while(size_ > capacity_ && lru_.size() > 1)
+    {
+        const auto& lru = lru_.back();
+
+        size_ -= lru.second;
+        index_.erase(lru.first.get_issue_index());
+        lru_.pop_back();
+    }
+
+    return lru_.front().first;
+}
+
+// +--------------------------------------------------+
+// + TestPool                                         +
+// +--------------------------------------------------+
+
+TestPool::TestPool(const fs::path& root,
+                   uint64_t fingerprint_spill)
     : root_(root)
     ,tc_count_(0)
+    ,log_(root / "test-case")
     ,next_(TestPriority(BFS))
+    ,issued_tests_(root / fingerprint_dir_name, fingerprint_spill)
+    ,base_log_(root / "test-case-base-cache")
+    ,base_tc_cache_(base_test_cache_size)
     ,m_duplicated_tc_count(0) {}
 
 auto TestPool::next() -> boost::optional<TestCase>
@@ -49,10 +674,18 @@ auto TestPool::next() -> boost::optional<TestCase>
     boost::optional<TestCase> ret;
     assert(!ret);
 
+    if(initial_tc_)
+    {
+        ret = get_complete_tc(*initial_tc_);
+        initial_tc_ = boost::none;
+    }
+
+    prefetch_base_tcs();
+
     // XXX: Iterate until a non-duplicate test case is found
     while(!next_.empty() && !ret)
     {
-        ret = get_complete_tc(next_.top());
+        ret = get_complete_tc(log_.read(next_.top().record));
         next_.pop();
     }
 
@@ -64,16 +697,16 @@ auto TestPool::next() -> boost::optional<TestCase>
 // the target exec under test
 auto TestPool::insert_initial_tc_from_config(const TestCase& tc) -> bool
 {
-    assert(next_.empty());
+    assert(next_.empty() && !initial_tc_);
     assert(tc_count_ == 0);
 
-    next_.push(tc);
+    initial_tc_ = tc;
     return true;
 }
 
 auto TestPool::insert_initial_tcs(const std::vector<TestCase>& tcs) -> void
 {
-    assert(next_.empty());
+    assert(next_.empty() && !initial_tc_);
     assert(tc_count_ == 0);
 
     for(const auto& tc : tcs)
@@ -88,7 +721,8 @@ auto TestPool::insert(const std::vector<TestCase>& tcs) -> void
     if(tc_count_ == 0)
     {
         assert(!tcs.front().is_test_patch());
-        write_test_case(tcs.front(), root_ / "test-case" / std::to_string(++tc_count_));
+        log_.append(tcs.front());
+        ++tc_count_;
     }
 
     for(const auto& tc : tcs)
@@ -100,7 +734,6 @@ auto TestPool::insert(const std::vector<TestCase>& tcs) -> void
             insert_internal(tc);
         } else {
             insert_base_tc(tc);
-            write_test_case(tc, root_ / "test-case-base-cache" / std::to_string(tc.get_issue_index()));
         }
     }
 }
@@ -112,7 +745,7 @@ auto TestPool::count_all() const -> size_t
 
 auto TestPool::count_next() const -> size_t
 {
-    return next_.size();
+    return next_.size() + (initial_tc_ ? 1 : 0);
 }
 
 auto TestPool::write_log(std::ostream& os) -> void
@@ -122,58 +755,80 @@ auto TestPool::write_log(std::ostream& os) -> void
 
 auto TestPool::insert_internal(const TestCase& tc) -> bool
 {
-    next_.push(tc);
+    auto record = log_.append(tc);
+    ++tc_count_;
 
-    write_test_case(tc, root_ / "test-case" / std::to_string(++tc_count_));
+    next_.push(TestQueueEntry{tc.get_tt_last_node_index(),
+                              tc.is_test_patch() ? tc.get_base_tc_issue_index() : 0,
+                              record});
 
     return true;
 }
 
-auto TestPool::insert_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterator
+auto TestPool::insert_base_tc(const TestCase& tc) -> void
 {
-    issued_tc_hash_pool_.insert(tc.get_elements());
+    issued_tests_.insert(fingerprint(tc.get_elements()));
 
-    if(base_tc_cache_.size() >= BASE_TEST_CACHE_SIZE)
-    {
-        base_tc_cache_.clear();
-    }
-
-    std::pair<BaseTestCache_ty::const_iterator, bool> it =
-            base_tc_cache_.insert(std::make_pair(tc.get_issue_index(), tc));
+    BaseTestIndex_ty::const_iterator it = base_tc_index_.find(tc.get_issue_index());
 
-    if(!it.second)
+    if(it != base_tc_index_.end())
     {
-        fprintf(stderr, "TestPool::insert_base_tc() error: duplicate issue_index in base_tc_cache_ (issue index = %lu),\n",
-                it.first->first);
+        fprintf(stderr, "TestPool::insert_base_tc() error: duplicate issue_index in base_tc_index_ (issue index = %lu),\n",
+                it->first);
 
-        write_test_case(it.first->second, root_ / "test-case-base-error" / "existing_based_tc.bin" );
+        write_test_case(base_log_.read(it->second), root_ / "test-case-base-error" / "existing_based_tc.bin" );
         write_test_case(tc, root_ / "test-case-base-error" / "duplicate_base_tc.bin" );
 
         assert(0);
     }
 
-    return it.first;
+    auto record = base_log_.append(tc);
+
+    base_tc_index_.emplace(tc.get_issue_index(), record);
+    base_tc_cache_.insert(tc, record.size);
 }
 
-auto TestPool::get_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterator
+// The reference is valid until the next base tc is inserted into the cache
+auto TestPool::get_base_tc(const TestCase& tc) -> const TestCase&
 {
     assert(tc.is_test_patch());
 
     TestCaseIssueIndex tc_issue_index = tc.get_base_tc_issue_index();
-    BaseTestCache_ty::const_iterator base_tc_it = base_tc_cache_.find(tc_issue_index);
 
-    if(base_tc_it == base_tc_cache_.end())
+    if(const TestCase* base_tc = base_tc_cache_.find(tc_issue_index))
     {
-        fs::path base_tc_path = (root_ / "test-case-base-cache" / std::to_string(tc_issue_index));
-        assert(fs::is_regular(base_tc_path));
+        return *base_tc;
+    }
 
-        TestCase base_tc = retrieve_test_serialized(base_tc_path.string());
-        assert(base_tc.get_issue_index() == tc_issue_index);
+    BaseTestIndex_ty::const_iterator it = base_tc_index_.find(tc_issue_index);
+    assert(it != base_tc_index_.end());
 
-        base_tc_it = insert_base_tc(base_tc);
-    }
+    TestCase base_tc = base_log_.read(it->second);
+    assert(base_tc.get_issue_index() == tc_issue_index);
+
+    return base_tc_cache_.insert(base_tc, it->second.size);
+}
+
+// Hints the base tcs of the patches due soon into memory, so that a queue
+// interleaving many bases doesn't wait on the disk for each of them
+auto TestPool::prefetch_base_tcs() -> void
+{
+    auto head = next_.head(base_test_prefetch_count);
 
-    return base_tc_it;
+    for(auto it = head.first; it != head.second; ++it)
+    {
+        if(it->base_tc_issue_index == 0 || base_tc_cache_.contains(it->base_tc_issue_index))
+        {
+            continue;
+        }
+
+        BaseTestIndex_ty::const_iterator base = base_tc_index_.find(it->base_tc_issue_index);
+
+        if(base != base_tc_index_.end())
+        {
+            base_log_.prefetch(base->second);
+        }
+    }
 }
 
 auto TestPool::get_complete_tc(const TestCase& patch_tc) -> boost::optional<TestCase> const
@@ -183,16 +838,13 @@ auto TestPool::get_complete_tc(const TestCase& patch_tc) -> boost::optional<Test
     {
         complete_tc = patch_tc;
     } else {
-        BaseTestCache_ty::const_iterator base_tc = get_base_tc(patch_tc);
-        assert(base_tc != base_tc_cache_.end());
-
-        complete_tc = generate_complete_tc_from_patch(patch_tc, base_tc->second);
+        complete_tc = generate_complete_tc_from_patch(patch_tc, get_base_tc(patch_tc));
     }
 
     // check whether the new complete_tc duplicates with issued tcs
-    if(issued_tc_hash_pool_.insert(complete_tc.get_elements()).second)
+    if(issued_tests_.insert(fingerprint(complete_tc.get_elements())))
     {
-        complete_tc.set_issue_index(issued_tc_hash_pool_.size());
+        complete_tc.set_issue_index(issued_tests_.size());
         return boost::optional<TestCase>{complete_tc};
     } else {
         ++m_duplicated_tc_count;
@@ -37,6 +37,11 @@ VMNode::VMNode(const node::option::VMNode& node_options,
         BOOST_THROW_EXCEPTION(Exception{} << err::arg_invalid_uint(node_options_.vm.count));
     }
 
+    if(node_options_.translator.cache.empty())
+    {
+        node_options_.translator.cache = fs::absolute(pwd_ / translator_cache_dir_name).string();
+    }
+
     init_image_info();
     add_instances(node_options_.vm.count);
 }
@@ -56,6 +61,8 @@ auto VMNode::poll() -> void
     using namespace node::vm;
 
     auto any_active = false;
+    auto trace_ready_fds = std::vector<pollfd>{};
+    auto all_waiting = true;
 
     for(auto& vm : vms_)
     {
@@ -125,15 +132,34 @@ auto VMNode::poll() -> void
         any_active = any_active
                      || (!vm->is_flag_active<flag::next_test>()
                          && !vm->is_flag_active<flag::terminated>());
+
+        if(vm->is_flag_active<flag::testing>() && vm->trace_ready_fd() != -1)
+        {
+            trace_ready_fds.push_back(pollfd{vm->trace_ready_fd(), POLLIN, 0});
+        }
+        else if(!vm->is_flag_active<flag::terminated>())
+        {
+            all_waiting = false;
+        }
     }
 
     active(any_active);
+
+    // Nothing to do until a VM's test produces its trace: sleep until any of them signals.
+    if(all_waiting && !trace_ready_fds.empty())
+    {
+        ::poll(trace_ready_fds.data(),
+               trace_ready_fds.size(),
+               static_cast<int>(trace_signal_wait.count()));
+    }
 }
 
 auto VMNode::start_FSMs() -> void
 {
     using namespace node::vm;
 
+    launch_translator_daemon();
+
     auto vm_path = pwd_.string();
 
     if(master_options().mode.distributed)
@@ -173,6 +199,33 @@ auto VMNode::start_FSMs() -> void
     }
 }
 
+// The daemon keeps the translator's helper libraries linked in memory and
+// serves all traces of this node. It terminates along with the node.
+auto VMNode::launch_translator_daemon() -> void
+{
+    if(!node_options_.translator.daemon.empty())
+    {
+        return;
+    }
+
+    auto socket_path = fs::absolute(pwd_ / translator_socket_name).string();
+
+    bp::context ctx;
+    ctx.work_directory = pwd_.string();
+    ctx.environment = bp::self::get_environment();
+    ctx.stdout_behavior = bp::silence_stream();
+    ctx.stderr_behavior = bp::silence_stream();
+
+    auto exe = node::vm::fsm::translator_executable(master_options(), node_options_);
+    auto args = node::vm::fsm::translator_args(exe, node_options_);
+    args.push_back("--daemon");
+    args.push_back(socket_path);
+
+    bp::launch(exe, args, ctx);
+
+    node_options_.translator.daemon = socket_path;
+}
+
 auto VMNode::init_image_info() -> void
 {
     auto infop = pwd_ / node_image_dir / image_info_name;
@@ -302,8 +355,13 @@ auto process(AtomicGuard<VMNode>& node,
         receive_image_info(node,
                            request.sbuf_);
         return true;
+    case packet_type::cluster_image_manifest_request:
+        transmit_image_manifest(node,
+                                request.client_);
+        return true;
     case packet_type::cluster_image:
         receive_image(node,
+                      request.sbuf_,
                       request.client_);
         return true;
     case packet_type::cluster_next_target:
@@ -330,12 +388,48 @@ auto process(AtomicGuard<VMNode>& node,
         transmit_guest_data_post_exec(node,
                                       request.client_);
 
+        return true;
+    case packet_type::cluster_test_case:
+        receive_test_batch(node,
+                           request.sbuf_,
+                           request.client_);
+
         return true;
     }
 
     return false;
 }
 
+// Tests arrive in batches sized by the credit advertised in the previous status.
+// The updated status is returned as the acknowledgement, so dispatch need not poll for it.
+auto receive_test_batch(AtomicGuard<VMNode>& node,
+                        boost::asio::streambuf& sbuf,
+                        Client& client) -> void
+{
+    auto tcs = std::vector<TestCase>{};
+
+    read_serialized_binary(sbuf,
+                           tcs);
+
+    auto pkinfo = PacketInfo{0, 0, 0};
+    auto status = NodeStatus{};
+
+    {
+        auto lock = node.acquire();
+
+        lock->push(tcs);
+
+        pkinfo.id = lock->id();
+        pkinfo.type = packet_type::cluster_status;
+
+        status = lock->status();
+    }
+
+    write_serialized_binary(client,
+                            pkinfo,
+                            status);
+}
+
 auto transmit_guest_data(AtomicGuard<VMNode>& node,
                          Client& client) -> void
 {
@@ -405,29 +499,115 @@ auto receive_image_info(AtomicGuard<VMNode>& node,
     node.acquire()->update(ii);
 }
 
+/**
+ * @brief transmit_image_manifest reports the block digests of what this node already holds:
+ *        a partially received image if an earlier transfer was interrupted, or else the
+ *        current image. Dispatch then only sends the blocks that differ.
+ */
+auto transmit_image_manifest(AtomicGuard<VMNode>& node,
+                             Client& client) -> void
+{
+    auto pkinfo = PacketInfo{0,0,0};
+    auto image_path = fs::path{};
+
+    {
+        auto lock = node.acquire();
+
+        pkinfo.id = lock->id();
+        pkinfo.type = packet_type::cluster_image_manifest;
+
+        image_path = lock->image_path();
+    }
+
+    auto part_path = image_path.parent_path() / image_part_name;
+    auto manifest = ImageManifest{};
+
+    if(fs::exists(part_path))
+    {
+        manifest = ImageManifest{part_path};
+    }
+    else if(fs::exists(image_path))
+    {
+        manifest = ImageManifest{image_path};
+    }
+
+    write_serialized_binary(client,
+                            pkinfo,
+                            manifest);
+}
+
+/**
+ * @brief receive_image patches the image block-by-block in a side file, which is only
+ *        renamed into place once complete. An interrupted transfer leaves the side file
+ *        behind, so the next manifest exchange resumes from it.
+ */
 auto receive_image(AtomicGuard<VMNode>& node,
+                   boost::asio::streambuf& sbuf,
                    Client& client) -> void
 {
     auto image_path = node.acquire()->image_path();
+    auto part_path = image_path.parent_path() / image_part_name;
+    auto update = ImageUpdate{};
+
+    read_serialized_binary(sbuf,
+                           update);
 
-    std::cout << "receive_image: " << image_path.string() << std::endl;
+    std::cout << "receive_image: " << image_path.string()
+              << " (" << update.blocks_.size() << "/" << update.manifest_.digests_.size()
+              << " blocks)" << std::endl;
 
     if(!fs::exists(image_path.parent_path()))
     {
         fs::create_directories(image_path.parent_path());
     }
 
-    if(fs::exists(image_path))
+    if(!fs::exists(part_path))
     {
-        fs::remove(image_path);
+        if(fs::exists(image_path))
+        {
+            fs::rename(image_path, part_path);
+        }
+        else
+        {
+            fs::ofstream{part_path};
+        }
     }
 
-    fs::ofstream ofs{image_path};
+    fs::resize_file(part_path, update.manifest_.size_);
+
+    {
+        fs::fstream part{part_path, std::ios::in | std::ios::out | std::ios::binary};
+
+        CRETE_EXCEPTION_ASSERT(part.good(), err::file_open_failed{part_path.string()});
+
+        auto buf = std::vector<char>{};
+
+        for(const auto& block : update.blocks_)
+        {
+            auto pkinfo = client.read(buf);
+
+            CRETE_EXCEPTION_ASSERT(pkinfo.type == packet_type::cluster_image_block,
+                                   err::network_type_mismatch(pkinfo.type));
+            CRETE_EXCEPTION_ASSERT(pkinfo.id == block,
+                                   err::msg("image block received out of order"));
+            CRETE_EXCEPTION_ASSERT(block * update.manifest_.block_size_ + pkinfo.size <= update.manifest_.size_,
+                                   err::msg("image block exceeds image size"));
+
+            part.seekp(static_cast<std::streamoff>(block * update.manifest_.block_size_));
+            part.write(buf.data(), static_cast<std::streamsize>(pkinfo.size));
 
-    CRETE_EXCEPTION_ASSERT(ofs.good(), err::file_open_failed{image_path.string()});
+            CRETE_EXCEPTION_ASSERT(part.good(), err::file(part_path.string()));
+        }
 
-    read(client,
-         ofs);
+        part.flush();
+    }
+
+    if(fs::exists(image_path))
+    {
+        fs::remove(image_path);
+    }
+
+    fs::rename(part_path, image_path);
 
     std::cout << "receive_image: success" << std::endl;
 }
@@ -456,6 +636,8 @@ auto VMNode::add_instances(size_t count) -> void
 
         add_instance();
     }
+
+    test_window(vms_.size() * vm_test_credit_per_instance);
 }
 
 } // namespace cluster
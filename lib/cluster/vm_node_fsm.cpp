@@ -26,11 +26,19 @@
 #include <boost/property_tree/xml_parser.hpp>
 
 #include <boost/process.hpp>
+#include <boost/asio.hpp>
 
 #include <memory>
+#include <future>
+#include <atomic>
 
 #include <algorithm>
 
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace bp = boost::process;
 namespace fs = boost::filesystem;
 namespace msm = boost::msm;
@@ -52,6 +60,91 @@ namespace vm
 // +--------------------------------------------------+
 struct VMException : public Exception {};
 
+/**
+ * @brief One-byte notifications between QEMU and the node, through a FIFO in hostfile/.
+ *
+ * Both ends open the FIFO read-write, so neither blocks in open() nor sees EOF when
+ * the other goes away. The notification only means "look again": the hostfile
+ * (e.g., trace_ready) remains the source of truth, so lost or stale bytes are harmless.
+ */
+class HostfileSignal
+{
+public:
+    HostfileSignal(const fs::path& fifo)
+    {
+        struct stat st;
+
+        // An existing FIFO is kept: an already running QEMU may hold it open.
+        if(::stat(fifo.string().c_str(), &st) != 0 || !S_ISFIFO(st.st_mode))
+        {
+            fs::remove(fifo);
+
+            CRETE_EXCEPTION_ASSERT(::mkfifo(fifo.string().c_str(), 0666) == 0,
+                                   err::file_create{fifo.string()});
+        }
+
+        fd_ = ::open(fifo.string().c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+
+        CRETE_EXCEPTION_ASSERT(fd_ >= 0,
+                               err::file_open_failed{fifo.string()});
+    }
+    ~HostfileSignal()
+    {
+        ::close(fd_);
+    }
+    HostfileSignal(const HostfileSignal&) = delete;
+    auto operator=(const HostfileSignal&) -> HostfileSignal& = delete;
+
+    auto notify() -> void
+    {
+        auto c = char{0};
+
+        // A full pipe already holds pending notifications.
+        (void)::write(fd_, &c, sizeof(c));
+    }
+
+    /**
+     * @return true if notified since the last call. Doesn't block.
+     */
+    auto consume() -> bool
+    {
+        auto notified = false;
+        char buf[64];
+
+        while(::read(fd_, buf, sizeof(buf)) > 0)
+        {
+            notified = true;
+        }
+
+        return notified;
+    }
+
+    /**
+     * @brief Blocks until notified, consuming the notifications.
+     */
+    auto wait() -> void
+    {
+        struct pollfd pfd;
+        pfd.fd = fd_;
+        pfd.events = POLLIN;
+
+        while(!consume())
+        {
+            CRETE_EXCEPTION_ASSERT(::poll(&pfd, 1, -1) >= 0 || errno == EINTR,
+                                   err::c_errno{errno});
+        }
+    }
+
+    // Readable when notified, e.g., to poll() several signals at once
+    auto fd() const -> int
+    {
+        return fd_;
+    }
+
+private:
+    int fd_{-1};
+};
+
 // +--------------------------------------------------+
 // + Events                                           +
 // +--------------------------------------------------+
@@ -136,6 +229,7 @@ public:
     auto get_guest_data_post_exec() -> const GuestDataPostExec&;
     auto initial_test() -> const TestCase&;
     auto error() -> const log::NodeError&;
+    auto trace_ready_fd() const -> int; // -1 until the VM is started.
 
     // +--------------------------------------------------+
     // + Entry & Exit                                     +
@@ -287,6 +381,14 @@ private:
     std::shared_ptr<GuestDataPostExec> guest_data_post_exec_{std::make_shared<GuestDataPostExec>()};
 
     std::shared_ptr<AtomicGuard<pid_t> > translator_child_pid_ = std::make_shared<AtomicGuard<pid_t> >(-1);
+    std::shared_future<void> stream_translation_; // Translation overlapped with the running test.
+    std::shared_ptr<HostfileSignal> trace_ready_signal_;
+    std::shared_ptr<HostfileSignal> trace_consumed_signal_;
+    std::shared_ptr<HostfileSignal> trace_chunk_signal_; // Read by the streaming translation.
+    std::chrono::steady_clock::time_point trace_ready_checked_;
+    std::shared_ptr<std::atomic<bool>> stream_translation_cancelled_{std::make_shared<std::atomic<bool>>(false)}; // Of stream_translation_.
+
+    auto cancel_stream_translation() -> void;
 
     // Testing
     boost::thread qemu_stream_capture_thread_;
@@ -420,6 +522,41 @@ auto QemuFSM_::error() -> const log::NodeError&
     return error_log_;
 }
 
+inline
+auto QemuFSM_::trace_ready_fd() const -> int
+{
+    return trace_ready_signal_ ? trace_ready_signal_->fd() : -1;
+}
+
+// Stops the streaming translation, if any, and waits for it, so that the
+// next one does not overlap with it, nor block when its future is dropped.
+// The translator is killed until the stream returns, as its pid may only
+// be published after the cancellation.
+inline
+auto QemuFSM_::cancel_stream_translation() -> void
+{
+    if(!stream_translation_.valid())
+    {
+        return;
+    }
+
+    *stream_translation_cancelled_ = true;
+    // Wakes the stream if it's still waiting for the trace
+    trace_chunk_signal_->notify();
+
+    do
+    {
+        auto translator_pid = static_cast<pid_t>(translator_child_pid_->acquire());
+
+        if(translator_pid != -1)
+        {
+            ::kill(translator_pid, SIGKILL);
+        }
+    } while(stream_translation_.wait_for(std::chrono::milliseconds{10}) != std::future_status::ready);
+
+    stream_translation_ = std::shared_future<void>{};
+}
+
 // +--------------------------------------------------+
 // + States                                           +
 // +--------------------------------------------------+
@@ -484,6 +621,8 @@ struct QemuFSM_::NextTest : public msm::front::state<>
 };
 struct QemuFSM_::Testing : public msm::front::state<>
 {
+    using flag_list = mpl::vector1<flag::testing>;
+
     template <class Event,class FSM>
     void on_entry(Event const& ,FSM&) {std::cout << "entering: Testing" << std::endl;}
     template <class Event,class FSM>
@@ -567,6 +706,13 @@ struct QemuFSM_::init
         fs::create_directories(fsm.vm_dir_);
         fs::create_directories(fsm.vm_dir_ / hostfile_dir_name);
 
+        fsm.trace_ready_signal_ = std::make_shared<HostfileSignal>(fsm.vm_dir_ / hostfile_dir_name / trace_ready_fifo_name);
+        fsm.trace_consumed_signal_ = std::make_shared<HostfileSignal>(fsm.vm_dir_ / hostfile_dir_name / trace_consumed_fifo_name);
+        fsm.trace_chunk_signal_ = std::make_shared<HostfileSignal>(fsm.vm_dir_ / hostfile_dir_name / trace_chunk_fifo_name);
+
+        // clean() may have removed a trace_ready that a running QEMU waits on.
+        fsm.trace_consumed_signal_->notify();
+
         fsm.exception_log_.add_sink(fsm.vm_dir_ / log_dir_name / exception_log_file_name);
         fsm.exception_log_.auto_flush(true);
     }
@@ -741,6 +887,12 @@ struct QemuFSM_::start_vm
     }
 };
 
+static void stream_translate_trace(const fs::path vm_dir
+        ,const cluster::option::Dispatch dispatch_options
+        ,const option::VMNode node_options
+        ,std::shared_ptr<AtomicGuard<pid_t>> child_pid
+        ,std::shared_ptr<std::atomic<bool>> cancelled);
+
 struct QemuFSM_::start_test
 {
     template <class EVT,class FSM,class SourceState,class TargetState>
@@ -803,97 +955,272 @@ struct QemuFSM_::start_test
         {
             BOOST_THROW_EXCEPTION(VMException{} << err::msg{boost::diagnostic_information(e)});
         }
+
+        if(fsm.node_options_.translator.stream)
+        {
+            // Left over if the previous test was not stored
+            fsm.cancel_stream_translation();
+
+            fsm.stream_translation_cancelled_ = std::make_shared<std::atomic<bool>>(false);
+            fsm.stream_translation_ = std::async(std::launch::async,
+                                                 stream_translate_trace,
+                                                 fsm.vm_dir_,
+                                                 fsm.dispatch_options_,
+                                                 fsm.node_options_,
+                                                 fsm.translator_child_pid_,
+                                                 fsm.trace_chunk_signal_,
+                                                 fsm.stream_translation_cancelled_).share();
+        }
     }
 };
 
-static void translate_trace(const fs::path& trace_dir
+static auto translator_executable(const cluster::option::Dispatch& dispatch_options
+        ,const option::VMNode& node_options) -> std::string
+{
+    auto exe = std::string{};
+
+    if(dispatch_options.vm.arch == "x86")
+    {
+        if(!node_options.translator.path.x86.empty())
+        {
+            exe = node_options.translator.path.x86;
+        }
+        else
+        {
+            exe = bp::find_executable_in_path("crete-llvm-translator-qemu-2.3-i386");
+        }
+    }
+    else if(dispatch_options.vm.arch == "x64")
+    {
+        if(!node_options.translator.path.x64.empty())
+        {
+            exe = node_options.translator.path.x64;
+        }
+        else
+        {
+            exe = bp::find_executable_in_path("crete-llvm-translator-qemu-2.3-x86_64");
+        }
+    }
+    else
+    {
+        BOOST_THROW_EXCEPTION(Exception{} << err::arg_invalid_str{dispatch_options.vm.arch}
+        << err::arg_invalid_str{"vm.arch"});
+    }
+
+    return exe;
+}
+
+static auto translator_args(const std::string& exe
+        ,const option::VMNode& node_options) -> std::vector<std::string>
+{
+    auto args = std::vector<std::string>{fs::absolute(exe).string()}; // It appears our modified QEMU requires full path in argv[0]...
+
+    if(!node_options.translator.cache.empty())
+    {
+        args.push_back("--tb-cache");
+        args.push_back(node_options.translator.cache);
+        args.push_back("--tb-cache-size");
+        args.push_back(std::to_string(node_options.translator.cache_size));
+    }
+
+    if(node_options.translator.jobs > 1)
+    {
+        args.push_back("--jobs");
+        args.push_back(std::to_string(node_options.translator.jobs));
+    }
+
+    return args;
+}
+
+// Returns false if the translator daemon could not be reached, in which case
+// the caller falls back to launching the translator for this trace.
+// The daemon's child serving the request is published through child_pid,
+// so that it is killed as a launched translator would be.
+static auto translate_trace_with_daemon(const fs::path& trace_dir
+        ,const std::string& socket_path
+        ,const fs::path& stream_signal
+        ,std::shared_ptr<AtomicGuard<pid_t>> child_pid) -> bool
+{
+    namespace local = boost::asio::local;
+
+    boost::asio::io_service io_service;
+    local::stream_protocol::socket socket{io_service};
+
+    boost::system::error_code ec;
+    socket.connect(local::stream_protocol::endpoint{socket_path}, ec);
+
+    if(ec)
+    {
+        return false;
+    }
+
+    auto request = fs::absolute(trace_dir).string() + "\n";
+
+    if(!stream_signal.empty())
+    {
+        request = "--stream " + fs::absolute(stream_signal).string() + "\n" + request;
+    }
+    boost::asio::write(socket, boost::asio::buffer(request));
+
+    boost::asio::streambuf reply_buf;
+    std::istream reply{&reply_buf};
+    auto server_pid = pid_t{-1};
+
+    boost::asio::read_until(socket, reply_buf, '\n', ec);
+
+    if(ec || !(reply >> server_pid) || reply.get() != '\n')
+    {
+        BOOST_THROW_EXCEPTION(VMException{} << err::msg{"translator daemon: no pid in reply"});
+    }
+
+    child_pid->acquire() = server_pid;
+
+    boost::asio::read(socket, reply_buf, ec);
+
+    // Same caveat as in run_translator(): the pid may be reclaimed after this point.
+    child_pid->acquire() = -1;
+
+    if(ec && ec != boost::asio::error::eof)
+    {
+        BOOST_THROW_EXCEPTION(VMException{} << err::msg{"translator daemon: " + ec.message()});
+    }
+
+    std::string status;
+    std::getline(reply, status);
+
+    if(status != "0")
+    {
+        std::stringstream ss;
+        ss << reply.rdbuf();
+
+        BOOST_THROW_EXCEPTION(VMException{} << err::process_exit_status{socket_path}
+        << err::msg{ss.str()});
+    }
+
+    return true;
+}
+
+// Run the translator on dir, which leaves dump_llvm_offline.bc in it.
+// With a stream_signal, dir may still be being written by QEMU, which
+// notifies stream_signal on each chunk.
+static void run_translator(const fs::path& dir
         ,const cluster::option::Dispatch& dispatch_options
         ,const option::VMNode& node_options
-        ,std::shared_ptr<AtomicGuard<pid_t>> child_pid)
+        ,std::shared_ptr<AtomicGuard<pid_t>> child_pid
+        ,const fs::path& stream_signal)
 {
-    fs::path dir = trace_dir;
-    fs::path kdir = dir / klee_dir_name;
-
-    if(!fs::exists(dir))
+    if(!node_options.translator.daemon.empty() &&
+       translate_trace_with_daemon(dir, node_options.translator.daemon, stream_signal, child_pid))
     {
-        BOOST_THROW_EXCEPTION(VMException{} << err::file_missing{dir.string()});
+        return;
     }
 
-    // 1. Translate qemu-ir to llvm
     bp::context ctx;
     ctx.work_directory = dir.string();
     ctx.environment = bp::self::get_environment();
     ctx.stdout_behavior = bp::capture_stream();
     ctx.stderr_behavior = bp::redirect_stream_to_stdout();
 
+    auto exe = translator_executable(dispatch_options, node_options);
+    auto args = translator_args(exe, node_options);
+
+    if(!stream_signal.empty())
     {
-        auto exe = std::string{};
+        args.push_back("--stream");
+        args.push_back(fs::absolute(stream_signal).string());
+    }
 
-        if(dispatch_options.vm.arch == "x86")
-        {
-            if(!node_options.translator.path.x86.empty())
-            {
-                exe = node_options.translator.path.x86;
-            }
-            else
-            {
-                exe = bp::find_executable_in_path("crete-llvm-translator-qemu-2.3-i386");
-            }
-        }
-        else if(dispatch_options.vm.arch == "x64")
-        {
-            if(!node_options.translator.path.x64.empty())
-            {
-                exe = node_options.translator.path.x64;
-            }
-            else
-            {
-                exe = bp::find_executable_in_path("crete-llvm-translator-qemu-2.3-x86_64");
-            }
-        }
-        else
-        {
-            BOOST_THROW_EXCEPTION(Exception{} << err::arg_invalid_str{dispatch_options.vm.arch}
-            << err::arg_invalid_str{"vm.arch"});
-        }
+    auto proc = bp::launch(exe, args, ctx);
 
-        auto args = std::vector<std::string>{fs::absolute(exe).string()}; // It appears our modified QEMU requires full path in argv[0]...
+    child_pid->acquire() = proc.get_id();
 
-        auto proc = bp::launch(exe, args, ctx);
+    // TODO: xxx Work-around to resolve the deadlock happened within the child process
+    // when its output is redirected.
+    auto& pistream = proc.get_stdout();
+    std::stringstream ss;
+    std::string line;
 
-        child_pid->acquire() = proc.get_id();
+    while(std::getline(pistream, line))
+        ss << line;
 
-        // TODO: xxx Work-around to resolve the deadlock happened within the child process
-        // when its output is redirected.
-        auto& pistream = proc.get_stdout();
-        std::stringstream ss;
-        std::string line;
+    auto status = proc.wait();
 
-        while(std::getline(pistream, line))
-            ss << line;
+    // FIXME: xxx Between 'auto status = proc.wait();' and this statement,
+    //           there is a chance this pid is reclaimed by other process.
+    child_pid->acquire() = -1;
 
-        auto status = proc.wait();
+    if(!process::is_exit_status_zero(status))
+    {
+        BOOST_THROW_EXCEPTION(VMException{} << err::process_exit_status{exe}
+        << err::msg{ss.str()});
+    }
+}
 
-        // FIXME: xxx Between 'auto status = proc.wait();' and this statement,
-        //           there is a chance this pid is reclaimed by other process.
-        child_pid->acquire() = -1;
+static void finish_translation(const fs::path& dir)
+{
+    fs::rename(dir / "dump_llvm_offline.bc",
+            dir / "run.bc");
 
-        if(!process::is_exit_status_zero(status))
-        {
-            BOOST_THROW_EXCEPTION(VMException{} << err::process_exit_status{exe}
-            << err::msg{ss.str()});
-        }
+    for( fs::directory_iterator dir_iter(dir), end_iter ; dir_iter != end_iter ; ++dir_iter)
+    {
+        std::string filename = dir_iter->path().filename().string();
+        if(filename.find("dump_tcg_llvm_offline") != std::string::npos)
+            fs::remove(dir/filename);
+    }
+
+    // Only the translator and vm-node read the container
+    fs::remove(dir / CRETE_TRACE_CONTAINER_NAME);
+}
+
+static void translate_trace(const fs::path& trace_dir
+        ,const cluster::option::Dispatch& dispatch_options
+        ,const option::VMNode& node_options
+        ,std::shared_ptr<AtomicGuard<pid_t>> child_pid)
+{
+    fs::path dir = trace_dir;
 
-        fs::rename(dir / "dump_llvm_offline.bc",
-                dir / "run.bc");
+    if(!fs::exists(dir))
+    {
+        BOOST_THROW_EXCEPTION(VMException{} << err::file_missing{dir.string()});
+    }
+
+    // 1. Translate qemu-ir to llvm
+    run_translator(dir, dispatch_options, node_options, child_pid, fs::path{});
 
-        for( fs::directory_iterator dir_iter(dir), end_iter ; dir_iter != end_iter ; ++dir_iter)
+    finish_translation(dir);
+}
+
+// Translate the trace of the test being run while QEMU is still capturing
+// it. The translator consumes each chunk once QEMU marks it ready.
+// QEMU notifies chunk_signal on each chunk. It is waited on here until the
+// trace directory exists, then only by the translator.
+static void stream_translate_trace(const fs::path vm_dir
+        ,const cluster::option::Dispatch dispatch_options
+        ,const option::VMNode node_options
+        ,std::shared_ptr<AtomicGuard<pid_t>> child_pid
+        ,std::shared_ptr<HostfileSignal> chunk_signal
+        ,std::shared_ptr<std::atomic<bool>> cancelled)
+{
+    auto trace_last = vm_dir / trace_dir_name / "runtime-dump-last";
+
+    // Created by QEMU along with the trace directory, when the first chunk is written
+    while(!fs::exists(trace_last))
+    {
+        if(*cancelled)
         {
-            std::string filename = dir_iter->path().filename().string();
-            if(filename.find("dump_tcg_llvm_offline") != std::string::npos)
-                fs::remove(dir/filename);
+            BOOST_THROW_EXCEPTION(VMException{} << err::msg{"streaming translation cancelled"});
         }
+
+        chunk_signal->wait();
     }
+
+    if(*cancelled)
+    {
+        BOOST_THROW_EXCEPTION(VMException{} << err::msg{"streaming translation cancelled"});
+    }
+
+    run_translator(fs::canonical(trace_last), dispatch_options, node_options, child_pid,
+                   vm_dir / hostfile_dir_name / trace_chunk_fifo_name);
 }
 
 struct QemuFSM_::store_trace
@@ -906,7 +1233,9 @@ struct QemuFSM_::store_trace
                                               std::shared_ptr<GuestDataPostExec> guest_data_post_exec,
                                               const cluster::option::Dispatch dispatch_options,
                                               const node::option::VMNode node_options,
-                                              std::shared_ptr<AtomicGuard<pid_t>> child_pid)
+                                              std::shared_ptr<AtomicGuard<pid_t>> child_pid,
+                                              std::shared_future<void> stream_translation,
+                                              std::shared_ptr<HostfileSignal> trace_consumed_signal)
         {
             auto trace_ready = vm_dir / hostfile_dir_name / trace_ready_name;
             auto trace_dir = vm_dir / trace_dir_name;
@@ -949,18 +1278,46 @@ struct QemuFSM_::store_trace
             fs::rename(original_trace,
                        *trace);
 
-            *guest_data_post_exec = read_serialized_guest_data_post_exec((*trace) / CRETE_FILENAME_GUEST_DATA_POST_EXEC);
+            *guest_data_post_exec = read_serialized_guest_data_post_exec((*trace) / CRETE_TRACE_CONTAINER_NAME);
 
-            translate_trace(*trace, dispatch_options, node_options,child_pid);
+            auto streamed = false;
+
+            if(stream_translation.valid())
+            {
+                try
+                {
+                    stream_translation.get();
+                    streamed = true;
+                }
+                catch(std::exception& e)
+                {
+                    std::cerr << "[Warning] streaming translation failed, translating the complete trace:\n"
+                              << boost::diagnostic_information(e) << std::endl;
+                }
+            }
+
+            if(streamed)
+            {
+                finish_translation(*trace);
+            }
+            else
+            {
+                translate_trace(*trace, dispatch_options, node_options,child_pid);
+            }
 
             fs::remove(trace_ready);
+            trace_consumed_signal->notify();
         }
         , fsm.vm_dir_
         , fsm.trace_
         , fsm.guest_data_post_exec_
         , fsm.dispatch_options_
         , fsm.node_options_
-        , fsm.translator_child_pid_});
+        , fsm.translator_child_pid_
+        , fsm.stream_translation_
+        , fsm.trace_consumed_signal_});
+
+        fsm.stream_translation_ = std::shared_future<void>{};
     }
 };
 
@@ -1109,6 +1466,10 @@ struct QemuFSM_::terminate
 
             while(process::is_running(pid)) {} // TODO: is this check necessary?
         }
+
+        // The trace being streamed to the translator won't be completed.
+        // This also kills and waits for its translator.
+        fsm.cancel_stream_translation();
     }
 };
 
@@ -1169,6 +1530,19 @@ struct QemuFSM_::is_finished
                     err::msg{"timeout in vm-node-fsm for a test, likely to be crete-run crash"});
         }
 
+        // QEMU signals trace_ready once written; VMNode::poll() waits for the
+        // signals of all VMs at once. The file is still looked for now and then,
+        // in case a signal is lost.
+        auto now = std::chrono::steady_clock::now();
+
+        if(!fsm.trace_ready_signal_->consume() &&
+           now - fsm.trace_ready_checked_ < trace_ready_recheck)
+        {
+            return false;
+        }
+
+        fsm.trace_ready_checked_ = now;
+
         auto trace_ready_sig = fsm.vm_dir_ / hostfile_dir_name / trace_ready_name;
 
         return fs::exists(trace_ready_sig);
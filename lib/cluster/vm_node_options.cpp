@@ -95,6 +95,24 @@ Translator::Translator(const pt::ptree& tree)
 
         path.x86 = proc(path.x86);
         path.x64 = proc(path.x64);
+
+        cache = trans.get<std::string>("cache", cache);
+
+        if(!cache.empty())
+        {
+            cache = fs::absolute(cache).string();
+        }
+
+        cache_size = trans.get<uint64_t>("cache-size", cache_size);
+
+        jobs = trans.get<uint32_t>("jobs", jobs);
+
+        if(jobs == 0)
+        {
+            BOOST_THROW_EXCEPTION(Exception{} << err::arg_invalid_str{"crete.translator.jobs"});
+        }
+
+        stream = trans.get<bool>("stream", stream);
     }
 }
 
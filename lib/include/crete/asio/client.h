@@ -30,9 +30,11 @@ public:
     void write(const uint64_t& id,
                const uint32_t& type);
     void write(const PacketInfo& pktinfo);
+    void write_file(int fd, uint64_t size); // Payload of crete::write_file().
     PacketInfo read(std::vector<char>& buf);
     PacketInfo read(boost::asio::streambuf& sbuf);
     PacketInfo read();
+    void read_file(int fd, uint64_t size); // Payload of crete::read_file().
     PacketInfo read(boost::posix_time::time_duration timeout);
 
     void connect();
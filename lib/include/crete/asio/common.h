@@ -26,16 +26,25 @@
 #include <crete/util/util.h>
 #include <crete/exception.h>
 
+#include <algorithm>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 
 namespace crete
 {
 
 const size_t asio_max_msg_size = 32;
 const uint32_t default_chunk_size = 1024;
+const std::size_t file_transfer_buffer_size = 1024 * 1024; // Receive side of write_file()/read_file().
 
 typedef unsigned short Port;
 typedef std::string IPAddress;
@@ -74,6 +83,9 @@ const uint32_t cluster_request_guest_data = 29;
 const uint32_t cluster_tx_guest_data = 30;
 const uint32_t cluster_request_guest_data_post_exec = 31;
 const uint32_t cluster_tx_guest_data_post_exec = 32;
+const uint32_t cluster_image_manifest_request = 33;
+const uint32_t cluster_image_manifest = 34;
+const uint32_t cluster_image_block = 35;
 }
 
 struct PacketInfo
@@ -281,6 +293,152 @@ void read(Connection& connection,
     os.flush(); // Seems to be a bug in gcc-4.6. Destructor doesn't always call close/flush.
 }
 
+/**
+ * @brief Sends 'size' bytes of 'fd', from its current offset, on 'socket' with sendfile(2),
+ *        so file contents are not copied through user space.
+ *
+ * @note asio may have put the socket in non-blocking mode (e.g., after async_connect), so
+ *       EAGAIN is waited out with poll(2).
+ */
+inline void send_file(boost::asio::ip::tcp::socket& socket,
+                      int fd,
+                      uint64_t size)
+{
+    int sock = socket.native_handle();
+
+    while(size > 0)
+    {
+        ssize_t nsent = ::sendfile(sock, fd, NULL, size);
+
+        if(nsent < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                pollfd pfd = {sock, POLLOUT, 0};
+                ::poll(&pfd, 1, -1);
+
+                continue;
+            }
+
+            throw boost::system::system_error(errno, boost::system::system_category());
+        }
+
+        CRETE_EXCEPTION_ASSERT(nsent > 0, err::network("file truncated while being sent"));
+
+        size -= static_cast<uint64_t>(nsent);
+    }
+}
+
+/**
+ * @brief Receives 'size' bytes from 'socket' into 'fd' in blocks of file_transfer_buffer_size.
+ */
+inline void receive_file(boost::asio::ip::tcp::socket& socket,
+                         int fd,
+                         uint64_t size)
+{
+    std::vector<char> buf(std::min<uint64_t>(size, file_transfer_buffer_size));
+
+    while(size > 0)
+    {
+        std::size_t nrec = boost::asio::read(socket,
+                                             boost::asio::buffer(buf.data(),
+                                                                 std::min<uint64_t>(size, buf.size())));
+
+        for(std::size_t nwritten = 0; nwritten < nrec;)
+        {
+            ssize_t n = ::write(fd, buf.data() + nwritten, nrec - nwritten);
+
+            if(n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if(n < 0)
+            {
+                throw boost::system::system_error(errno, boost::system::system_category());
+            }
+
+            nwritten += static_cast<std::size_t>(n);
+        }
+
+        size -= nrec;
+    }
+}
+
+/**
+ * @brief Sends the file at 'path' as a single packet_type::file_stream packet of its size, rather
+ *        than as default_chunk_size chunks as write() does. Meant for bulk data, e.g., traces.
+ *
+ * @param pkinfo header of the packet; its size and type are set here.
+ */
+template<typename Connection>
+void write_file(Connection& connection,
+                const boost::filesystem::path& path,
+                PacketInfo pkinfo)
+{
+    int fd = ::open(path.string().c_str(), O_RDONLY | O_CLOEXEC);
+
+    CRETE_EXCEPTION_ASSERT(fd >= 0, err::file_open_failed(path.string()));
+
+    try
+    {
+        struct stat st;
+
+        if(::fstat(fd, &st) != 0)
+        {
+            throw boost::system::system_error(errno, boost::system::system_category());
+        }
+
+        pkinfo.size = static_cast<uint64_t>(st.st_size);
+        pkinfo.type = packet_type::file_stream;
+
+        connection.write(pkinfo);
+        connection.write_file(fd, pkinfo.size);
+    }
+    catch(...)
+    {
+        ::close(fd);
+        throw;
+    }
+
+    ::close(fd);
+}
+
+/**
+ * @brief Receives a file sent by write_file() into 'path', replacing it if it exists.
+ */
+template<typename Connection>
+PacketInfo read_file(Connection& connection,
+                     const boost::filesystem::path& path)
+{
+    PacketInfo pkinfo = connection.read();
+
+    CRETE_EXCEPTION_ASSERT(pkinfo.type == packet_type::file_stream, err::network_type_mismatch(pkinfo.type));
+
+    int fd = ::open(path.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    CRETE_EXCEPTION_ASSERT(fd >= 0, err::file_open_failed(path.string()));
+
+    try
+    {
+        connection.read_file(fd, pkinfo.size);
+    }
+    catch(...)
+    {
+        ::close(fd);
+        throw;
+    }
+
+    CRETE_EXCEPTION_ASSERT(::close(fd) == 0, err::file(path.string()));
+
+    return pkinfo;
+}
+
 typedef std::map<std::string, std::time_t> QueryFiles;
 
 class UpdateQuery
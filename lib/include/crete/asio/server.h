@@ -32,11 +32,13 @@ public:
     void write(const uint64_t& id,
                const uint32_t& type);
     void write(const PacketInfo& pktinfo);
+    void write_file(int fd, uint64_t size); // Payload of crete::write_file().
 //    size_t write(const boost::asio::buffer& buf,
 //                 const PacketInfo& pktinfo);
     PacketInfo read(std::vector<char>& buf);
     PacketInfo read(boost::asio::streambuf& sbuf);
     PacketInfo read();
+    void read_file(int fd, uint64_t size); // Payload of crete::read_file().
 
     /// Handler signature: void handler(const boost::system::error_code&);
     template <typename Handler>
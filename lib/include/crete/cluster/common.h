@@ -7,8 +7,12 @@
 
 #include <stdint.h>
 
+#include <chrono>
+
 #include <boost/filesystem/path.hpp>
 #include <boost/serialization/split_member.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_serialize.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -31,12 +35,22 @@ const auto hostfile_dir_name = std::string{"hostfile"};
 const auto image_info_name = std::string{"crete.img.info"};
 const auto input_args_name = std::string{"input_arguments.bin"};
 const auto trace_ready_name = std::string{"trace_ready"};
+const auto trace_ready_fifo_name = std::string{"trace_ready.fifo"}; // QEMU -> node: trace_ready was written.
+const auto trace_consumed_fifo_name = std::string{"trace_consumed.fifo"}; // Node -> QEMU: trace_ready was removed.
+const auto trace_chunk_fifo_name = std::string{"trace_chunk.fifo"}; // QEMU -> node, translator: a chunk of the trace was written.
 const auto vm_port_file_name = std::string{"port"};
 const auto vm_pid_file_name = std::string{"pid"};
 const auto log_dir_name = std::string{"log"};
 const auto klee_dir_name = std::string{"klee-run"};
+const auto translator_cache_dir_name = std::string{"translator-cache"};
+const auto translator_socket_name = std::string{"translator.sock"};
 const auto exception_log_file_name = std::string{"exception_caught.log"};
 const auto image_max_file_size = uint64_t{8000000000}; // 10 Gigabytes in bytes
+const auto vm_test_credit_per_instance = 5u; // Tests queued ahead of each VM instance.
+const auto trace_signal_wait = std::chrono::milliseconds{5}; // Longest a VM node's poll blocks for its VMs' trace-ready signals.
+const auto trace_ready_recheck = std::chrono::seconds{1}; // trace_ready is also checked this often without a signal.
+const auto image_block_size = uint64_t{4 * 1024 * 1024}; // Unit of image comparison and transfer.
+const auto image_part_name = std::string{"crete.img.part"}; // Partially received image, kept for resumption.
 
 struct NodeStatus
 {
@@ -45,6 +59,7 @@ struct NodeStatus
     uint32_t trace_count = 0;
     uint32_t error_count = 0; // Reported errors from node. To be retrieved, as tcs and traces.
     bool active = true; // Designates whether the node is currently doing things, or just waiting.
+    uint32_t test_case_credit = 0; // Number of tests the node is willing to accept in the next batch.
 
     template <typename Archive>
     void serialize(Archive& ar, const unsigned int version)
@@ -56,6 +71,7 @@ struct NodeStatus
         ar & trace_count;
         ar & error_count;
         ar & active;
+        ar & test_case_credit;
     }
 };
 
@@ -88,6 +104,51 @@ inline auto operator!=(const ImageInfo& lhs, const ImageInfo& rhs) -> bool
     return !(lhs == rhs);
 }
 
+/**
+ * Per-block digests of an image. Blocks that match on both ends are not sent.
+ */
+struct ImageManifest
+{
+    uint64_t size_{0u};
+    uint64_t block_size_{image_block_size};
+    std::vector<std::string> digests_; // SHA-1 of each block, in order.
+
+    ImageManifest() = default;
+    ImageManifest(const boost::filesystem::path& image,
+                  uint64_t block_size = image_block_size);
+
+    template <typename Archive>
+    auto serialize(Archive& ar, const unsigned int version) -> void
+    {
+        (void)version;
+
+        ar & size_;
+        ar & block_size_;
+        ar & digests_;
+    }
+};
+
+/**
+ * Header of an image transfer: the image's manifest, followed by the indices of the blocks sent.
+ */
+struct ImageUpdate
+{
+    ImageManifest manifest_;
+    std::vector<uint64_t> blocks_;
+
+    template <typename Archive>
+    auto serialize(Archive& ar, const unsigned int version) -> void
+    {
+        (void)version;
+
+        ar & manifest_;
+        ar & blocks_;
+    }
+};
+
+auto differing_image_blocks(const ImageManifest& source,
+                            const ImageManifest& destination) -> std::vector<uint64_t>;
+
 struct GuestData
 {
     config::RunConfiguration guest_config;
@@ -146,8 +207,10 @@ struct Trace
     }
 };
 
-auto archive_directory(const boost::filesystem::path& dir) -> void;
-auto restore_directory(const boost::filesystem::path& dir) -> void;
+auto archive_directory(const boost::filesystem::path& dir,
+                       const std::string& compressor = std::string{}) -> void;
+auto restore_directory(const boost::filesystem::path& dir,
+                       const std::string& compressor = std::string{}) -> void;
 
 struct NodeRequest
 {
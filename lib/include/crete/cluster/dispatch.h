@@ -7,6 +7,7 @@
 
 #include <vector>
 #include <memory>
+#include <chrono>
 
 #include <crete/cluster/common.h>
 #include <crete/cluster/node_registrar.h>
@@ -36,8 +37,9 @@ const auto dispatch_node_error_log_file_name = std::string{"node_error.log"};
 const auto dispatch_last_root_symlink = std::string{"last"};
 const auto dispatch_config_file_name = std::string{"dispatch_config.xml"};
 
-const auto vm_test_multiplier = 5u;
 const auto vm_trace_multiplier = 20u;
+const auto dispatch_io_thread_count = 8u; // Node FSM events run on these, each on its node's strand.
+const auto dispatch_node_poll_interval = std::chrono::milliseconds{250}; // Minimum interval between status polls of an idle node.
 
 namespace vm
 {
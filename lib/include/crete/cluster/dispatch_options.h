@@ -55,6 +55,7 @@ struct Test
     Interval interval;
     Items items;
     Seeds seeds;
+    uint64_t fingerprint_spill{0}; // Issued tests remembered in memory before spilling to disk. 0: never spill.
 
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version)
@@ -64,6 +65,7 @@ struct Test
         ar & interval;
         ar & items;
         ar & seeds;
+        ar & fingerprint_spill;
     }
 };
 
@@ -136,7 +138,8 @@ struct Trace
     bool print_graph{false};
     bool print_graph_only_branches{false}; // TODO: Now redundant. We only dump 'branches.'
     bool print_elf_info{false};
-    bool compress{false};
+    bool compress{false}; // Compress traces in transit with 'compressor.'
+    std::string compressor{"zstd"}; // One of: gzip, lz4, zstd.
 
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version)
@@ -149,6 +152,12 @@ struct Trace
         ar & print_graph_only_branches;
         ar & print_elf_info;
         ar & compress;
+        ar & compressor;
+    }
+
+    auto transfer_compressor() const -> std::string
+    {
+        return compress ? compressor : std::string{};
     }
 };
 
@@ -62,6 +62,7 @@ public:
     auto reset() -> void;
     auto active(bool p) -> void;
     auto is_active() -> bool;
+    auto test_window(uint32_t n) -> void;
     auto master_options() const -> const option::Dispatch&;
     auto update(const option::Dispatch& options) -> void;
 
@@ -83,6 +84,7 @@ private:
     Type type_;
     bool commenced_{false};
     bool active_{true};
+    uint32_t test_window_{0}; // Max tests queued on this node; bounds the credit advertised in status().
     option::Dispatch master_options_;
 };
 
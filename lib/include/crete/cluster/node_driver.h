@@ -330,23 +330,16 @@ auto transmit_trace(Node& node,
     auto lock = node.acquire();
     auto trace = lock->pop_trace();
 
-    archive_directory(trace);
+    archive_directory(trace,
+                      lock->master_options().trace.transfer_compressor());
 
-    {
-        fs::ifstream ifs{trace,
-                         std::ios::in | std::ios::binary};
-
-        CRETE_EXCEPTION_ASSERT(ifs.good(),
-                               err::file_open_failed{trace.string()});
-
-        write_serialized_binary(client,
-                                pkinfo,
-                                trace.filename().string());
+    write_serialized_binary(client,
+                            pkinfo,
+                            trace.filename().string());
 
-        write(client,
-              ifs,
-              default_chunk_size);
-    }
+    write_file(client,
+               trace,
+               pkinfo);
 
     fs::remove(trace);
 }
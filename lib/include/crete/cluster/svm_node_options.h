@@ -30,6 +30,7 @@ struct SVM
     } path;
     uint32_t count{std::max(boost::thread::hardware_concurrency()
                            ,1u)}; // Default value given in ctor.
+    uint32_t shards{1}; // crete-klee instances splitting the branches of a single trace.
 };
 
 struct SVMNode
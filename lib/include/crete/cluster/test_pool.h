@@ -1,12 +1,15 @@
 #ifndef CRETE_TEST_POOL_H_
 #define CRETE_TEST_POOL_H_
 
+#include <algorithm>
 #include <set>
 #include <string>
 #include <vector>
+#include <list>
 #include <queue>
 #include <stdint.h>
 #include <random>
+#include <memory>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/optional.hpp>
@@ -32,6 +35,94 @@ struct TestCaseTreeNode
 
 enum TestSchedStrat {FIFO, BFS};
 
+// 128-bit content fingerprint of a test case's elements. {0, 0} is never produced.
+struct TestFingerprint
+{
+    uint64_t lo;
+    uint64_t hi;
+
+    bool operator==(const TestFingerprint& other) const { return lo == other.lo && hi == other.hi; }
+    bool operator!=(const TestFingerprint& other) const { return !(*this == other); }
+    bool operator<(const TestFingerprint& other) const { return hi < other.hi || (hi == other.hi && lo < other.lo); }
+};
+
+auto fingerprint(const TestCaseElements& elems) -> TestFingerprint;
+
+/**
+ * @brief Set of test fingerprints, in an open-addressing table.
+ *
+ * With a non-zero spill_size, the table is written out under spill_dir as a sorted
+ * run whenever it holds spill_size fingerprints, and emptied. Runs are searched
+ * through read-only mappings, so they live in the page cache rather than the heap.
+ */
+class TestFingerprintSet
+{
+public:
+    TestFingerprintSet(const fs::path& spill_dir, uint64_t spill_size);
+
+    auto insert(const TestFingerprint& fp) -> bool; // False if fp is already in the set.
+    auto size() const -> uint64_t;
+
+private:
+    class Run;
+
+    auto slot(const TestFingerprint& fp) const -> uint64_t;
+    auto grow() -> void;
+    auto spill() -> void;
+    auto merge_runs() -> void;
+    auto new_run(const std::vector<TestFingerprint>& sorted) -> std::shared_ptr<Run>;
+
+    fs::path spill_dir_;
+    uint64_t spill_size_;
+    uint64_t size_{0};
+    std::vector<TestFingerprint> table_; // {0, 0} marks an empty slot.
+    uint64_t table_count_{0};
+    std::vector<std::shared_ptr<Run>> runs_;
+};
+
+// Location of a test case in the test log
+struct TestLogRecord
+{
+    uint32_t segment;
+    uint64_t offset; // Of the serialized test case, past the size prefix.
+    uint64_t size;
+};
+
+/**
+ * @brief Append-only store of test cases, as size-prefixed serialized tests in
+ *        numbered segment files under dir (see retrieve_tests_log()).
+ *
+ * Appends are fdatasync'ed in batches, and on segment rollover. Full segments
+ * are read through read-only mappings. Files are only created on the first append.
+ */
+class TestLog
+{
+public:
+    TestLog(const fs::path& dir);
+
+    auto append(const TestCase& tc) -> TestLogRecord;
+    auto read(const TestLogRecord& record) const -> TestCase;
+    auto prefetch(const TestLogRecord& record) const -> void; // Hints that record will be read soon.
+    auto sync() -> void;
+
+private:
+    class Segment;
+
+    auto roll() -> void;
+
+    fs::path dir_;
+    std::vector<std::shared_ptr<Segment>> segments_;
+    uint64_t unsynced_{0};
+};
+
+// Queued test case, whose body stays in the test log until it is scheduled
+struct TestQueueEntry
+{
+    uint32_t tt_last_node_index;
+    TestCaseIssueIndex base_tc_issue_index; // 0 if not a patch.
+    TestLogRecord record;
+};
+
 class TestPriority
 {
 private:
@@ -39,31 +130,70 @@ private:
 
 public:
     TestPriority(const TestSchedStrat& strat) {m_tc_sched_strat = strat;}
-    bool operator() (const TestCase& lhs, const TestCase& rhs) const;
+    bool operator() (const TestQueueEntry& lhs, const TestQueueEntry& rhs) const;
+};
+
+// Priority queue that also exposes the front of its heap, i.e., entries due soon
+class TestQueue : public std::priority_queue<TestQueueEntry, vector<TestQueueEntry>, TestPriority>
+{
+public:
+    using std::priority_queue<TestQueueEntry, vector<TestQueueEntry>, TestPriority>::priority_queue;
+
+    auto head(size_t count) const -> std::pair<container_type::const_iterator,
+                                               container_type::const_iterator>
+    {
+        return std::make_pair(c.begin(), c.begin() + std::min(count, c.size()));
+    }
+};
+
+/**
+ * @brief LRU cache of base test cases, bounded by the total of their serialized sizes.
+ *
+ * The most recently inserted test is kept even if it alone exceeds the capacity.
+ */
+class BaseTestCache
+{
+public:
+    BaseTestCache(uint64_t capacity);
+
+    auto find(TestCaseIssueIndex index) -> const TestCase*; // Null if not cached.
+    auto contains(TestCaseIssueIndex index) const -> bool;
+    auto insert(const TestCase& tc, uint64_t size) -> const TestCase&;
+
+private:
+    using Entry = std::pair<TestCase, uint64_t>; // <test, serialized size>
+
+    uint64_t capacity_;
+    uint64_t size_{0};
+    std::list<Entry> lru_; // Most recently used first.
+    boost::unordered_map<TestCaseIssueIndex, std::list<Entry>::iterator> index_;
 };
 
 class TestPool
 {
 public:
-    using TestQueue = std::priority_queue<TestCase, vector<TestCase>, TestPriority>;
     // Needs to be a map b/c the tc issued first is not necessary going to finish symbolic replay first
-    using BaseTestCache_ty = boost::unordered_map<TestCaseIssueIndex, TestCase>;
-    using UniqueTestIdentifier = TestCaseElements;
+    using BaseTestIndex_ty = boost::unordered_map<TestCaseIssueIndex, TestLogRecord>;
 
 private:
     fs::path root_;
 
     uint64_t tc_count_;
 
+    TestLog log_;
     TestQueue next_;
-    boost::unordered_set<UniqueTestIdentifier> issued_tc_hash_pool_;
-    BaseTestCache_ty base_tc_cache_;
+    boost::optional<TestCase> initial_tc_; // From config; not logged, as the first base tc supersedes it.
+    TestFingerprintSet issued_tests_;
+    TestLog base_log_;
+    BaseTestIndex_ty base_tc_index_;
+    BaseTestCache base_tc_cache_;
 
     // debug
     uint64_t m_duplicated_tc_count;
 
 public:
-    TestPool(const fs::path& root);
+    TestPool(const fs::path& root,
+             uint64_t fingerprint_spill = 0);
 
     auto next() -> boost::optional<TestCase>;
 
@@ -80,8 +210,9 @@ public:
 private:
     auto insert_internal(const TestCase& tc) -> bool;
 
-    auto insert_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterator;
-    auto get_base_tc(const TestCase& tc) -> BaseTestCache_ty::const_iterator;
+    auto insert_base_tc(const TestCase& tc) -> void;
+    auto get_base_tc(const TestCase& tc) -> const TestCase&;
+    auto prefetch_base_tcs() -> void;
     auto get_complete_tc(const TestCase& patch_tc) -> boost::optional<TestCase> const;
     auto write_test_case(const TestCase& tc, const fs::path out_path) -> void;
 };
@@ -43,6 +43,7 @@ public:
     auto add_instance() -> void;
     auto add_instances(size_t count) -> void;
     auto start_FSMs() -> void;
+    auto launch_translator_daemon() -> void;
     auto init_image_info() -> void;
     auto update(const ImageInfo& ii) -> void;
     auto image_info() -> const ImageInfo&;
@@ -69,6 +70,9 @@ private:
 
 auto process(AtomicGuard<VMNode>& node,
              NodeRequest& request) -> bool;
+auto receive_test_batch(AtomicGuard<VMNode>& node,
+                        boost::asio::streambuf& sbuf,
+                        Client& client) -> void;
 auto transmit_guest_data(AtomicGuard<VMNode>& node,
                          Client& client) -> void;
 auto transmit_guest_data_post_exec(AtomicGuard<VMNode>& node,
@@ -77,7 +81,10 @@ auto transmit_image_info(AtomicGuard<VMNode>& node,
                            Client& client) -> void;
 auto receive_image_info(AtomicGuard<VMNode>& node,
                         boost::asio::streambuf& sbuf) -> void;
+auto transmit_image_manifest(AtomicGuard<VMNode>& node,
+                             Client& client) -> void;
 auto receive_image(AtomicGuard<VMNode>& node,
+                   boost::asio::streambuf& sbuf,
                    Client& client) -> void;
 auto receive_target(AtomicGuard<VMNode>& node,
                     boost::asio::streambuf& sbuf) -> void;
@@ -27,6 +27,7 @@ namespace flag
 {
     struct guest_data_rxed {};
     struct trace_ready {};
+    struct testing {};
     struct next_test {};
     struct error {};
     struct terminated {};
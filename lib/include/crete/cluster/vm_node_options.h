@@ -27,6 +27,11 @@ struct Translator
         std::string x86;
         std::string x64;
     } path;
+    std::string cache; // TB cache directory shared by all translator runs of the node.
+    uint64_t cache_size{4096}; // MB the TB cache is trimmed to after each trace, 0 for unbounded.
+    std::string daemon; // Socket of the node's translator daemon. Set by the node, not parsed.
+    uint32_t jobs{1}; // Worker processes translating a single trace.
+    bool stream{true}; // Translate the trace while it is being captured.
 };
 
 struct VM
@@ -16,8 +16,18 @@ static const char *CRETE_SANDBOX_PATH = "/tmp/sandbox";
 static const char *CRETE_REPLAY_CURRENT_TC = "/tmp/crete.replay.current.tc.bin";
 static const char *CRETE_REPLAY_GCOV_PREFIX = "/tmp/gcov";
 
+// Override the two paths above for replay-preload, so parallel replay workers don't collide
+static const char *CRETE_ENV_REPLAY_CURRENT_TC = "CRETE_ENV_REPLAY_CURRENT_TC";
+static const char *CRETE_ENV_CONFIG_SERIALIZED = "CRETE_ENV_CONFIG_SERIALIZED";
+
 static const char *CRETE_SVM_TEST_FOLDER = "crete_svm_test_pool";
 
+// Fork-server mode of run-preload: crete-run requests a fresh test process through
+// CRETE_FORK_SERVER_CTL_FD, and receives its pid and wait status through CRETE_FORK_SERVER_ST_FD
+static const char *CRETE_ENV_FORK_SERVER = "CRETE_ENV_FORK_SERVER";
+static const int CRETE_FORK_SERVER_CTL_FD = 198;
+static const int CRETE_FORK_SERVER_ST_FD = 199;
+
 // CUSTOMIZED EXIT CODE
 static const int CRETE_EXIT_CODE_SIG_BASE = 30;
 
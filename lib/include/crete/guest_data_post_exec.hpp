@@ -16,6 +16,8 @@
 #include <boost/serialization/vector.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 
+#include <crete/trace_container.h>
+
 using namespace std;
 
 const string CRETE_FILENAME_GUEST_DATA_POST_EXEC =
@@ -44,14 +46,17 @@ struct GuestDataPostExec
     }
 };
 
-inline GuestDataPostExec read_serialized_guest_data_post_exec(const boost::filesystem::path &input)
+// Reads the section CRETE_FILENAME_GUEST_DATA_POST_EXEC of the trace container
+inline GuestDataPostExec read_serialized_guest_data_post_exec(const boost::filesystem::path &trace_container)
 {
     GuestDataPostExec ret;
-    ifstream i_sm(input.string().c_str(), ios_base::binary);
-    assert(i_sm.good());
+    TraceContainer trace(trace_container.string());
+    pair<const char*, uint64_t> section = trace.section(CRETE_FILENAME_GUEST_DATA_POST_EXEC);
+
+    TraceSectionBuf buf(section.first, section.second);
+    istream i_sm(&buf);
 
     boost::archive::binary_iarchive ia(i_sm);
-    GuestDataPostExec temp;
     ia >> ret;
 
     return ret;
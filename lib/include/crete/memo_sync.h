@@ -0,0 +1,91 @@
+#ifndef LIB_INCLUDE_CRETE_MEMO_SYNC_H_
+#define LIB_INCLUDE_CRETE_MEMO_SYNC_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <ostream>
+#include <stdexcept>
+
+// Shared by QEMU (runtime-dump) and the translator, so this header sticks to C++98.
+namespace crete
+{
+
+/*
+ * Memory sync tables of a trace chunk, one table per TB. Format (native endian):
+ *  uint64_t table count, then for each table
+ *      uint64_t range count, then for each range
+ *          uint64_t address, uint64_t size, uint8_t values[size]
+ */
+inline void write_memo_sync_count(std::ostream& os, uint64_t count)
+{
+    os.write((const char *)&count, sizeof(count));
+}
+
+inline void write_memo_sync_range(std::ostream& os, uint64_t addr, uint64_t size,
+        const uint8_t *values)
+{
+    os.write((const char *)&addr, sizeof(addr));
+    os.write((const char *)&size, sizeof(size));
+    os.write((const char *)values, size);
+}
+
+// Reads the tables in place, e.g., from a trace container mapping
+class MemoSyncReader
+{
+public:
+    MemoSyncReader(const char *data, uint64_t size)
+    : m_data(data), m_end(data + size)
+    {
+    }
+
+    // Table count, or range count of the next table
+    uint64_t read_count()
+    {
+        uint64_t count = 0;
+        read(&count, sizeof(count));
+
+        return count;
+    }
+
+    // Returns the values of the range, pointing into the data read
+    const char *read_range(uint64_t& addr, uint64_t& size)
+    {
+        read(&addr, sizeof(addr));
+        read(&size, sizeof(size));
+
+        check(size);
+
+        const char *values = m_data;
+        m_data += size;
+
+        return values;
+    }
+
+    bool at_end() const
+    {
+        return m_data == m_end;
+    }
+
+private:
+    void check(uint64_t size) const
+    {
+        if((uint64_t)(m_end - m_data) < size)
+            throw std::runtime_error("[CRETE ERROR] truncated memory sync tables");
+    }
+
+    void read(void *value, uint64_t size)
+    {
+        check(size);
+
+        memcpy(value, m_data, size);
+        m_data += size;
+    }
+
+    const char *m_data;
+    const char *m_end;
+};
+
+} // namespace crete
+
+#endif /* LIB_INCLUDE_CRETE_MEMO_SYNC_H_ */
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <stdint.h>
 #include <vector>
+#include <map>
 #include <iterator>
 #include <crete/trace_tag.h>
 
@@ -174,6 +175,20 @@ namespace crete
 
     TestCase retrieve_test_serialized(const std::string& tc_path);
     vector<TestCase> retrieve_tests_serialized(const string& tc_dir);
+    // Test log: segment files of <uint64_t size, write_serialized() data> records
+    vector<TestCase> retrieve_tests_log(const string& log_dir);
+
+    // Location of a test in a test log
+    struct TestLogLocation
+    {
+        string segment;
+        uint64_t offset; // Of the serialized test case, past the size prefix.
+        uint64_t size;
+    };
+
+    // Indexes the tests of a test log by issue index, without keeping them in memory
+    map<TestCaseIssueIndex, TestLogLocation> index_tests_log(const string& log_dir);
+    TestCase retrieve_test_log(const TestLogLocation& location);
 }
 
 #endif // CRETE_TEST_CASE_H
@@ -0,0 +1,355 @@
+#ifndef LIB_INCLUDE_CRETE_TRACE_CONTAINER_H_
+#define LIB_INCLUDE_CRETE_TRACE_CONTAINER_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Shared by QEMU (runtime-dump), the translator and the cluster nodes, so this
+// header sticks to C++98.
+namespace crete
+{
+
+// Trace data consumed by the translator and the VM node, kept in one file of the trace directory
+const char* const CRETE_TRACE_CONTAINER_NAME = "trace.crete";
+
+/*
+ * Format (native endian), written sequentially:
+ *  header:  char magic[8] "CRETETRC", uint32_t version, uint32_t reserved
+ *  section: uint32_t magic "SECT", uint32_t name size, uint64_t data size,
+ *           char name[], padding to 8 bytes, uint8_t data[], padding to 8 bytes
+ *  index:   a last section named CRETE_TRACE_CONTAINER_INDEX holding the uint64_t
+ *           offsets of all sections, followed by the uint64_t offset of that
+ *           section and char magic[8] "CRETEIDX"
+ *
+ * Until the index is written, readers find the complete sections by scanning.
+ * Section data is 8-byte aligned, so it can be used in place from a mapping.
+ */
+const uint32_t CRETE_TRACE_CONTAINER_VERSION = 1;
+const char* const CRETE_TRACE_CONTAINER_MAGIC = "CRETETRC";
+const char* const CRETE_TRACE_CONTAINER_INDEX_MAGIC = "CRETEIDX";
+const char* const CRETE_TRACE_CONTAINER_INDEX = "crete.index";
+const uint32_t CRETE_TRACE_CONTAINER_SECTION_MAGIC = 0x54434553; // "SECT"
+const uint64_t CRETE_TRACE_CONTAINER_HEADER_SIZE = 16;
+const uint64_t CRETE_TRACE_CONTAINER_SECTION_HEADER_SIZE = 16;
+const uint64_t CRETE_TRACE_CONTAINER_FOOTER_SIZE = 16;
+
+inline uint64_t trace_container_align(uint64_t size)
+{
+    return (size + 7) & ~(uint64_t)7;
+}
+
+class TraceContainerWriter
+{
+public:
+    explicit TraceContainerWriter(const std::string& path)
+    : m_ofs(path.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc),
+      m_path(path), m_offset(0), m_closed(false)
+    {
+        if(!m_ofs.good())
+            throw std::runtime_error("[CRETE ERROR] can't create trace container: " + path);
+
+        uint32_t version = CRETE_TRACE_CONTAINER_VERSION;
+        uint32_t reserved = 0;
+
+        write(CRETE_TRACE_CONTAINER_MAGIC, 8);
+        write(&version, sizeof(version));
+        write(&reserved, sizeof(reserved));
+        flush();
+    }
+
+    // Appends a section, visible to readers once this returns
+    void add_section(const std::string& name, const void* data, uint64_t size)
+    {
+        if(m_closed)
+            throw std::runtime_error("[CRETE ERROR] trace container is closed: " + m_path);
+
+        uint32_t magic = CRETE_TRACE_CONTAINER_SECTION_MAGIC;
+        uint32_t name_size = name.size();
+
+        m_index.push_back(m_offset);
+
+        write(&magic, sizeof(magic));
+        write(&name_size, sizeof(name_size));
+        write(&size, sizeof(size));
+        write(name.data(), name.size());
+        pad();
+        write(data, size);
+        pad();
+        flush();
+    }
+
+    void add_section(const std::string& name, const std::string& data)
+    {
+        add_section(name, data.data(), data.size());
+    }
+
+    // Writes the index; no section can be added afterwards
+    void close()
+    {
+        if(m_closed)
+            return;
+
+        uint64_t index_offset = m_offset;
+        std::vector<uint64_t> index = m_index;
+
+        add_section(CRETE_TRACE_CONTAINER_INDEX, index.data(), index.size() * sizeof(uint64_t));
+
+        write(&index_offset, sizeof(index_offset));
+        write(CRETE_TRACE_CONTAINER_INDEX_MAGIC, 8);
+        flush();
+
+        m_ofs.close();
+        m_closed = true;
+    }
+
+private:
+    void write(const void* data, uint64_t size)
+    {
+        m_ofs.write((const char*)data, size);
+        m_offset += size;
+    }
+
+    void pad()
+    {
+        static const char zeros[8] = {0};
+        write(zeros, trace_container_align(m_offset) - m_offset);
+    }
+
+    void flush()
+    {
+        m_ofs.flush();
+
+        if(!m_ofs.good())
+            throw std::runtime_error("[CRETE ERROR] can't write trace container: " + m_path);
+    }
+
+    std::ofstream m_ofs;
+    std::string m_path;
+    uint64_t m_offset;
+    std::vector<uint64_t> m_index;
+    bool m_closed;
+};
+
+// Read-only mapping of a trace container, which may still be being written.
+class TraceContainer
+{
+public:
+    explicit TraceContainer(const std::string& path)
+    : m_path(path), m_fd(-1), m_map(0), m_map_size(0), m_scanned(CRETE_TRACE_CONTAINER_HEADER_SIZE),
+      m_complete(false)
+    {
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if(m_fd < 0)
+            throw std::runtime_error("[CRETE ERROR] can't open trace container: " + path);
+
+        refresh();
+
+        if(m_map_size < CRETE_TRACE_CONTAINER_HEADER_SIZE ||
+           memcmp(m_map, CRETE_TRACE_CONTAINER_MAGIC, 8) != 0)
+        {
+            unmap();
+            ::close(m_fd);
+            throw std::runtime_error("[CRETE ERROR] not a trace container: " + path);
+        }
+
+        uint32_t version;
+        memcpy(&version, m_map + 8, sizeof(version));
+
+        if(version != CRETE_TRACE_CONTAINER_VERSION)
+        {
+            unmap();
+            ::close(m_fd);
+            throw std::runtime_error("[CRETE ERROR] unsupported trace container version: " + path);
+        }
+    }
+
+    ~TraceContainer()
+    {
+        unmap();
+        ::close(m_fd);
+    }
+
+    // Picks up the sections appended since the last call.
+    // Returns true if the container is complete.
+    bool refresh()
+    {
+        if(m_complete)
+            return true;
+
+        struct stat st;
+
+        if(::fstat(m_fd, &st) != 0)
+            throw std::runtime_error("[CRETE ERROR] can't stat trace container: " + m_path);
+
+        uint64_t size = st.st_size;
+
+        if(size != m_map_size)
+        {
+            unmap();
+
+            if(size > 0)
+            {
+                void* map = ::mmap(0, size, PROT_READ, MAP_SHARED, m_fd, 0);
+
+                if(map == MAP_FAILED)
+                    throw std::runtime_error("[CRETE ERROR] can't map trace container: " + m_path);
+
+                m_map = (const char*)map;
+                m_map_size = size;
+            }
+        }
+
+        // The footer magic may also be the tail of an incomplete section's data
+        if(!read_index())
+        {
+            scan();
+        }
+
+        return m_complete;
+    }
+
+    bool complete() const
+    {
+        return m_complete;
+    }
+
+    bool contains(const std::string& name) const
+    {
+        return m_sections.find(name) != m_sections.end();
+    }
+
+    // <data, size> of section name, valid until the next refresh()
+    std::pair<const char*, uint64_t> section(const std::string& name) const
+    {
+        std::map<std::string, std::pair<uint64_t, uint64_t> >::const_iterator it = m_sections.find(name);
+
+        if(it == m_sections.end())
+            throw std::runtime_error("[CRETE ERROR] section " + name + " not found in " + m_path);
+
+        return std::make_pair(m_map + it->second.first, it->second.second);
+    }
+
+private:
+    TraceContainer(const TraceContainer&);
+    TraceContainer& operator=(const TraceContainer&);
+
+    // Parses the section at offset, returning its end, or 0 if it is incomplete
+    // (or, unless strict, not a section)
+    uint64_t parse_section(uint64_t offset, bool strict = true)
+    {
+        if(offset + CRETE_TRACE_CONTAINER_SECTION_HEADER_SIZE > m_map_size)
+            return 0;
+
+        uint32_t magic;
+        uint32_t name_size;
+        uint64_t data_size;
+
+        memcpy(&magic, m_map + offset, sizeof(magic));
+        memcpy(&name_size, m_map + offset + 4, sizeof(name_size));
+        memcpy(&data_size, m_map + offset + 8, sizeof(data_size));
+
+        if(magic != CRETE_TRACE_CONTAINER_SECTION_MAGIC && !strict)
+            return 0;
+
+        if(magic != CRETE_TRACE_CONTAINER_SECTION_MAGIC)
+            throw std::runtime_error("[CRETE ERROR] corrupted trace container: " + m_path);
+
+        uint64_t name_offset = offset + CRETE_TRACE_CONTAINER_SECTION_HEADER_SIZE;
+        uint64_t data_offset = trace_container_align(name_offset + name_size);
+        uint64_t end = trace_container_align(data_offset + data_size);
+
+        if(end > m_map_size || end < data_offset)
+            return 0;
+
+        m_sections[std::string(m_map + name_offset, name_size)] = std::make_pair(data_offset, data_size);
+
+        return end;
+    }
+
+    void scan()
+    {
+        for(uint64_t end = parse_section(m_scanned); end != 0; end = parse_section(m_scanned))
+        {
+            m_scanned = end;
+        }
+    }
+
+    bool read_index()
+    {
+        if(m_map_size < CRETE_TRACE_CONTAINER_HEADER_SIZE + CRETE_TRACE_CONTAINER_FOOTER_SIZE ||
+           memcmp(m_map + m_map_size - 8, CRETE_TRACE_CONTAINER_INDEX_MAGIC, 8) != 0)
+            return false;
+
+        uint64_t index_offset;
+        memcpy(&index_offset, m_map + m_map_size - CRETE_TRACE_CONTAINER_FOOTER_SIZE, sizeof(index_offset));
+
+        if(index_offset < m_scanned ||
+           index_offset % 8 != 0 ||
+           parse_section(index_offset, false) != m_map_size - CRETE_TRACE_CONTAINER_FOOTER_SIZE ||
+           !contains(CRETE_TRACE_CONTAINER_INDEX))
+            return false;
+
+        std::pair<const char*, uint64_t> index = section(CRETE_TRACE_CONTAINER_INDEX);
+
+        for(uint64_t i = 0; i < index.second / sizeof(uint64_t); ++i)
+        {
+            uint64_t offset;
+            memcpy(&offset, index.first + i * sizeof(uint64_t), sizeof(offset));
+
+            if(offset >= m_scanned && parse_section(offset) == 0)
+                throw std::runtime_error("[CRETE ERROR] corrupted trace container index: " + m_path);
+        }
+
+        m_complete = true;
+
+        return true;
+    }
+
+    void unmap()
+    {
+        if(m_map)
+        {
+            ::munmap((void*)m_map, m_map_size);
+        }
+
+        m_map = 0;
+        m_map_size = 0;
+    }
+
+    std::string m_path;
+    int m_fd;
+    const char* m_map;
+    uint64_t m_map_size;
+    uint64_t m_scanned;
+    bool m_complete;
+    // <name, <offset, size>>
+    std::map<std::string, std::pair<uint64_t, uint64_t> > m_sections;
+};
+
+// Read-only std::streambuf over a section, e.g., for Boost archives
+class TraceSectionBuf : public std::streambuf
+{
+public:
+    TraceSectionBuf(const char* data, uint64_t size)
+    {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+} // namespace crete
+
+#endif /* LIB_INCLUDE_CRETE_TRACE_CONTAINER_H_ */
@@ -83,13 +83,21 @@ CreteReplayPreload::CreteReplayPreload(int argc, char **argv):
     }
 }
 
+static const char *getenv_or(const char *name, const char *fallback)
+{
+    const char *p = getenv(name);
+
+    return p ? p : fallback;
+}
+
 void CreteReplayPreload::init_guest_config()
 {
-    std::ifstream ifs(CRETE_CONFIG_SERIALIZED_PATH);
+    const char *config_path = getenv_or(CRETE_ENV_CONFIG_SERIALIZED, CRETE_CONFIG_SERIALIZED_PATH);
+    std::ifstream ifs(config_path);
 
     if(!ifs.good())
     {
-        BOOST_THROW_EXCEPTION(crete::Exception() << err::file_open_failed(CRETE_CONFIG_SERIALIZED_PATH));
+        BOOST_THROW_EXCEPTION(crete::Exception() << err::file_open_failed(config_path));
     }
 
     try
@@ -107,11 +115,12 @@ void CreteReplayPreload::init_guest_config()
 }
 void CreteReplayPreload::init_current_tc()
 {
-    std::ifstream ifs(CRETE_REPLAY_CURRENT_TC);
+    const char *tc_path = getenv_or(CRETE_ENV_REPLAY_CURRENT_TC, CRETE_REPLAY_CURRENT_TC);
+    std::ifstream ifs(tc_path);
     if(!ifs.good())
     {
         BOOST_THROW_EXCEPTION(Exception() <<
-                err::file_open_failed(CRETE_REPLAY_CURRENT_TC));
+                err::file_open_failed(tc_path));
     }
 
     TestCase tc = read_test_case(ifs);
@@ -11,6 +11,7 @@
 
 #include <cassert>
 #include <iomanip>
+#include <sstream>
 
 using namespace std;
 
@@ -555,4 +556,125 @@ namespace crete
 
         return tests;
     }
+
+    // Segments of a test log, in append order
+    static vector<string> test_log_segments(const string& log_dir)
+    {
+        namespace fs = boost::filesystem;
+
+        const fs::path test_log_dir(log_dir);
+
+        if(!fs::exists(test_log_dir))
+        {
+            return vector<string>();
+        }
+
+        assert(fs::is_directory(test_log_dir));
+
+        // Segments are numbered in append order
+        vector<string> v;
+        for ( fs::directory_iterator itr( test_log_dir );
+              itr != fs::directory_iterator();
+              ++itr ){
+            v.push_back(itr->path().string());
+        }
+
+        sort(v.begin(), v.end(), doj::alphanum_less<string>());
+
+        return v;
+    }
+
+    // Return empty vector if the folder does not exist or is empty
+    vector<TestCase> retrieve_tests_log(const string& log_dir)
+    {
+        namespace fs = boost::filesystem;
+
+        vector<string> v = test_log_segments(log_dir);
+        vector<TestCase> tests;
+
+        for (vector<string>::const_iterator it(v.begin()), it_end(v.end());
+                it != it_end; ++it)
+        {
+            fs::path entry(*it);
+
+            fs::ifstream segment(entry, ios_base::in | ios_base::binary);
+            CRETE_EXCEPTION_ASSERT(segment.good(), err::file_open_failed(entry.string()));
+
+            uint64_t size;
+            while(segment.read(reinterpret_cast<char*>(&size), sizeof(size)))
+            {
+                string data(size, '\0');
+
+                // An interrupted append leaves a truncated last record
+                if(!segment.read(&data[0], size))
+                {
+                    break;
+                }
+
+                istringstream iss(data, ios_base::in | ios_base::binary);
+                tests.push_back(read_serialized(iss));
+            }
+        }
+
+        return tests;
+    }
+
+    // Return empty map if the folder does not exist or is empty
+    map<TestCaseIssueIndex, TestLogLocation> index_tests_log(const string& log_dir)
+    {
+        namespace fs = boost::filesystem;
+
+        vector<string> v = test_log_segments(log_dir);
+        map<TestCaseIssueIndex, TestLogLocation> index;
+
+        for (vector<string>::const_iterator it(v.begin()), it_end(v.end());
+                it != it_end; ++it)
+        {
+            fs::ifstream segment(*it, ios_base::in | ios_base::binary);
+            CRETE_EXCEPTION_ASSERT(segment.good(), err::file_open_failed(*it));
+
+            TestLogLocation location;
+            location.segment = *it;
+
+            uint64_t size;
+            while(segment.read(reinterpret_cast<char*>(&size), sizeof(size)))
+            {
+                location.offset = segment.tellg();
+                location.size = size;
+
+                string data(size, '\0');
+
+                // An interrupted append leaves a truncated last record
+                if(!segment.read(&data[0], size))
+                {
+                    break;
+                }
+
+                istringstream iss(data, ios_base::in | ios_base::binary);
+                TestCaseIssueIndex issue_index = read_serialized(iss).get_issue_index();
+                bool inserted = index.insert(make_pair(issue_index, location)).second;
+
+                CRETE_EXCEPTION_ASSERT(inserted, err::msg("duplicate issue index in test log: " + *it));
+            }
+        }
+
+        return index;
+    }
+
+    TestCase retrieve_test_log(const TestLogLocation& location)
+    {
+        namespace fs = boost::filesystem;
+
+        fs::ifstream segment(location.segment, ios_base::in | ios_base::binary);
+        CRETE_EXCEPTION_ASSERT(segment.good(), err::file_open_failed(location.segment));
+
+        string data(location.size, '\0');
+
+        segment.seekg(location.offset);
+        CRETE_EXCEPTION_ASSERT(segment.read(&data[0], location.size), err::file(location.segment));
+
+        istringstream iss(data, ios_base::in | ios_base::binary);
+
+        return read_serialized(iss);
+    }
 }
@@ -3,7 +3,9 @@
 REF_1=$1
 REF_2=$2
 
-TEST_CASE_DIR="/test-case/"
+# Tests are kept in test logs, which crete-tc-compare writes out as one file each
+TC_COMPARE=${TC_COMPARE:-crete-tc-compare}
+TEST_CASE_DIR="/test-case-parsed/"
 main()
 {
     # check Macros which should be defined in $INCLUDE_FILE
@@ -17,6 +19,9 @@ main()
         exit
     fi
 
+    $TC_COMPARE -b $REF_1 2> /dev/null || exit
+    $TC_COMPARE -b $REF_2 2> /dev/null || exit
+
     for d in $REF_1/*/ ; do
         sub=$(echo $d | cut -d'/' -f 3)
 
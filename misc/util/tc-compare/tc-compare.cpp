@@ -1,7 +1,6 @@
 #include "tc-compare.hpp"
 
 #include <boost/program_options.hpp>
-#include <boost/unordered_map.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <string>
@@ -342,47 +341,34 @@ static bool hasEnding (std::string const &fullString, std::string const &ending)
     }
 }
 
-const uint64_t BASE_TEST_CACHE_SIZE = 200;
-static boost::unordered_map<TestCaseIssueIndex, TestCase> base_tc_cache;
+// Base tcs stay in their log until a patch needs them, as in TestPool
+static map<TestCaseIssueIndex, TestLogLocation> base_tc_index;
+// Patches of the same base tend to be adjacent, so the last base read is kept
+static TestCaseIssueIndex base_tc_last_index;
+static TestCase base_tc_last;
 
-boost::unordered_map<TestCaseIssueIndex, TestCase>::const_iterator
-get_base_tc(const fs::path& input, const TestCase& tc)
+void load_base_tcs(const fs::path& base_tc_dir)
 {
-    assert(tc.is_test_patch());
+    base_tc_index = index_tests_log(base_tc_dir.string());
+    base_tc_last_index = 0;
+}
 
-    TestCaseIssueIndex tc_issue_index = tc.get_base_tc_issue_index();
-    boost::unordered_map<TestCaseIssueIndex, TestCase>::const_iterator base_tc_it = base_tc_cache.find(tc_issue_index);
+const TestCase& get_base_tc(const TestCase& tc)
+{
+    assert(tc.is_test_patch());
 
-    if(base_tc_it == base_tc_cache.end())
+    if(base_tc_last_index != tc.get_base_tc_issue_index())
     {
-        fs::path base_tc_path = (input / "test-case-base-cache" / boost::lexical_cast<std::string>(tc_issue_index));
-        assert(fs::is_regular(base_tc_path));
+        map<TestCaseIssueIndex, TestLogLocation>::const_iterator base_tc_it =
+                base_tc_index.find(tc.get_base_tc_issue_index());
 
-        TestCase base_tc = retrieve_test_serialized(base_tc_path.string());
-        assert(base_tc.get_issue_index() == tc_issue_index);
-
-        if(base_tc_cache.size() >= BASE_TEST_CACHE_SIZE)
-        {
-            base_tc_cache.clear();
-        }
+        assert(base_tc_it != base_tc_index.end());
 
-        std::pair<boost::unordered_map<TestCaseIssueIndex, TestCase>::const_iterator, bool> it =
-                base_tc_cache.insert(std::make_pair(base_tc.get_issue_index(), base_tc));
-
-        if(!it.second)
-        {
-            fprintf(stderr, "[tc-compare]get_base_tc() error: duplicate issue_index in base_tc_cache_ (issue index = %lu),\n",
-                    it.first->first);
-
-            assert(0);
-        }
-
-        base_tc_it = it.first;
+        base_tc_last = retrieve_test_log(base_tc_it->second);
+        base_tc_last_index = base_tc_it->first;
     }
 
-    assert(base_tc_it != base_tc_cache.end());
-
-    return base_tc_it;
+    return base_tc_last;
 }
 
 void batch_path_mode_internal(const fs::path& input)
@@ -393,10 +379,11 @@ void batch_path_mode_internal(const fs::path& input)
     const fs::path base_tc_dir  = input/"test-case-base-cache";
 
     assert(fs::is_directory(tc_dir));
-    assert(fs::is_directory(base_tc_dir));
+    // Only created once a base is logged, i.e., absent when no test was a patch
+    assert(!fs::exists(base_tc_dir) || fs::is_directory(base_tc_dir));
 
-    vector<TestCase> tcs = retrieve_tests_serialized(tc_dir.string());
-    base_tc_cache.clear();
+    vector<TestCase> tcs = retrieve_tests_log(tc_dir.string());
+    load_base_tcs(base_tc_dir);
 
     const fs::path out_dir  = input/"test-case-parsed";
     if(fs::exists(out_dir))
@@ -410,9 +397,7 @@ void batch_path_mode_internal(const fs::path& input)
         TestCase out_tc;
         if(tcs[i].is_test_patch())
         {
-            boost::unordered_map<TestCaseIssueIndex, TestCase>::const_iterator base_tc =
-                    get_base_tc(input, tcs[i]);
-            out_tc = generate_complete_tc_from_patch(tcs[i], base_tc->second);
+            out_tc = generate_complete_tc_from_patch(tcs[i], get_base_tc(tcs[i]));
         } else {
             out_tc = tcs[i];
         }
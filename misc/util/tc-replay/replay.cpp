@@ -13,11 +13,14 @@
 #include <string>
 #include <ctime>
 #include <sys/mount.h>
+#include <sys/wait.h>
+#include <errno.h>
 
 using namespace std;
 
 static const string replay_log_file = "crete.replay.log";
 static const string replay_launch_directory = "/tmp/crete-tc-replay-launch/";
+static const string replay_gcov_merge_directory = "/tmp/crete-tc-replay-gcov/";
 
 namespace crete
 {
@@ -26,7 +29,11 @@ CreteReplay::CreteReplay(int argc, char* argv[]) :
     m_ops_descr(make_options()),
     m_cwd(fs::current_path()),
     m_init_sandbox(true),
-    m_enable_log(false)
+    m_enable_log(false),
+    m_jobs(1),
+    m_worker(0),
+    m_sandbox_root(CRETE_SANDBOX_PATH),
+    m_sandbox_overlay(false)
 {
     process_options(argc, argv);
     setup_launch();
@@ -54,6 +61,10 @@ po::options_description CreteReplay::make_options()
         ("log,l", po::bool_switch(), "enable log the output of replayed programs")
         ("exploitable-check,x", po::value<fs::path>(), "path to the output of exploitable-check")
         ("explo-check-script,r", po::value<fs::path>(), "path to the script to check exploitable with gdb replay")
+        ("jobs", po::value<unsigned>(), "number of test cases replayed in parallel, each worker with its own "
+                "sandbox or launch directory (requires 'input-sandbox' or 'input-launch-directory')")
+        ("sandbox-overlay", po::bool_switch(), "reset the sandbox with an overlayfs mount of 'input-sandbox' "
+                "instead of copying it before each test case (default with 'jobs'; requires overlayfs)")
         ;
 
     return desc;
@@ -184,6 +195,48 @@ void CreteReplay::process_options(int argc, char* argv[])
         m_exploitable_script = p;
     }
 
+    if(m_var_map.count("jobs"))
+    {
+        m_jobs = m_var_map["jobs"].as<unsigned>();
+
+        CRETE_EXCEPTION_ASSERT(m_jobs > 0, err::arg_invalid_uint(m_jobs));
+
+        if(m_seed_mode)
+        {
+            m_jobs = 1;
+        }
+    }
+
+    if(m_var_map.count("sandbox-overlay"))
+    {
+        m_sandbox_overlay = m_var_map["sandbox-overlay"].as<bool>();
+    }
+
+    if(m_jobs > 1)
+    {
+        m_sandbox_overlay = true;
+
+        if(m_input_sandbox.empty() && m_input_launch.empty())
+        {
+            BOOST_THROW_EXCEPTION(Exception() << err::msg("\'jobs\' requires \'input-sandbox\' or \'input-launch-directory\', "
+                    "so that each worker gets its own launch directory\n"));
+        }
+
+        if(!m_exploitable_out.empty())
+        {
+            BOOST_THROW_EXCEPTION(Exception() << err::msg("\'exploitable-check\' is not supported with \'jobs\'\n"));
+        }
+
+        try
+        {
+            bp::find_executable_in_path("gcov-tool");
+        }
+        catch(...)
+        {
+            BOOST_THROW_EXCEPTION(Exception() << err::file_missing("gcov-tool (required to merge coverage of \'jobs\')"));
+        }
+    }
+
     if(!fs::exists(m_exec))
     {
         BOOST_THROW_EXCEPTION(std::runtime_error("Executable not found: "
@@ -249,7 +302,7 @@ static void reset_folder_permission_recursively(const fs::path& root)
 void CreteReplay::reset_sandbox_folder_permission()
 {
     {
-        fs::path p = CRETE_SANDBOX_PATH;
+        fs::path p = m_sandbox_root;
         if(fs::exists(p))
         {
             fs::permissions(p, fs::perms_mask);
@@ -257,7 +310,7 @@ void CreteReplay::reset_sandbox_folder_permission()
     }
 
     {
-        fs::path p = fs::path(CRETE_SANDBOX_PATH) / "tmp";
+        fs::path p = m_sandbox_root / "tmp";
         if(fs::exists(p))
         {
             fs::permissions(p, fs::perms_mask);
@@ -265,7 +318,7 @@ void CreteReplay::reset_sandbox_folder_permission()
     }
 
     {
-        fs::path p = fs::path(CRETE_SANDBOX_PATH) / m_launch_directory;
+        fs::path p = m_sandbox_root / m_launch_directory;
         if(fs::exists(p))
         {
             fs::permissions(p, fs::perms_mask);
@@ -279,12 +332,21 @@ void CreteReplay::reset_sandbox_folder_permission()
 // require: "sudo setcap CAP_SYS_ADMIN+ep ./crete-run"
 void CreteReplay::init_sandbox()
 {
+    // the launch directory may still be an overlay mount from an earlier run
+    const fs::path overlay_dir = m_sandbox_root.string() + ".overlay";
+    if(fs::exists(overlay_dir))
+    {
+        umount((m_sandbox_root / m_launch_directory).string().c_str());
+        reset_folder_permission_recursively(overlay_dir);
+        fs::remove_all(overlay_dir);
+    }
+
     reset_sandbox_folder_permission();
 
     // delete the sandbox folder if it existed
-    if(fs::is_directory(CRETE_SANDBOX_PATH))
+    if(fs::is_directory(m_sandbox_root))
     {
-        for (fs::directory_iterator end_dir_it, it((fs::path(CRETE_SANDBOX_PATH))); it!=end_dir_it; ++it)
+        for (fs::directory_iterator end_dir_it, it(m_sandbox_root); it!=end_dir_it; ++it)
         {
             int ret = umount(it->path().string().c_str());
 
@@ -295,15 +357,15 @@ void CreteReplay::init_sandbox()
             }
         }
 
-        fs::remove_all(CRETE_SANDBOX_PATH);
-        assert(!fs::exists(CRETE_SANDBOX_PATH) && "[crete-run] crete-sandbox folder reset failed!\n");
+        fs::remove_all(m_sandbox_root);
+        assert(!fs::exists(m_sandbox_root) && "[crete-run] crete-sandbox folder reset failed!\n");
     }
 
     {
         const fs::path src = "/home";
         if(fs::is_directory(src))
         {
-            const fs::path dst = fs::path(CRETE_SANDBOX_PATH) / "home";
+            const fs::path dst = m_sandbox_root / "home";
             fs::create_directories(dst);
             rdonly_bind_mount(src, dst);
         }
@@ -312,7 +374,7 @@ void CreteReplay::init_sandbox()
         const fs::path src = "/lib";
         if(fs::is_directory(src))
         {
-            const fs::path dst = fs::path(CRETE_SANDBOX_PATH) / "lib";
+            const fs::path dst = m_sandbox_root / "lib";
             fs::create_directories(dst);
             rdonly_bind_mount(src, dst);
         }
@@ -321,7 +383,7 @@ void CreteReplay::init_sandbox()
         const fs::path src = "/lib64";
         if(fs::is_directory(src))
         {
-            const fs::path dst = fs::path(CRETE_SANDBOX_PATH) / "lib64";
+            const fs::path dst = m_sandbox_root / "lib64";
             fs::create_directories(dst);
             rdonly_bind_mount(src, dst);
         }
@@ -330,7 +392,7 @@ void CreteReplay::init_sandbox()
         const fs::path src = "/usr";
         if(fs::is_directory(src))
         {
-            const fs::path dst = fs::path(CRETE_SANDBOX_PATH) / "usr";
+            const fs::path dst = m_sandbox_root / "usr";
             fs::create_directories(dst);
             rdonly_bind_mount(src, dst);
         }
@@ -339,7 +401,7 @@ void CreteReplay::init_sandbox()
         const fs::path src = "/dev";
         if(fs::is_directory(src))
         {
-            const fs::path dst = fs::path(CRETE_SANDBOX_PATH) / "dev";
+            const fs::path dst = m_sandbox_root / "dev";
             fs::create_directories(dst);
             rdonly_bind_mount(src, dst);
         }
@@ -348,22 +410,72 @@ void CreteReplay::init_sandbox()
         const fs::path src = "/proc";
         if(fs::is_directory(src))
         {
-            const fs::path dst = fs::path(CRETE_SANDBOX_PATH) / "proc";
+            const fs::path dst = m_sandbox_root / "proc";
             fs::create_directories(dst);
             rdonly_bind_mount(src, dst);
         }
     }
 
-    fs::create_directories(fs::path(CRETE_SANDBOX_PATH) / "tmp");
-    fs::create_directories(fs::path(CRETE_SANDBOX_PATH) / CRETE_REPLAY_GCOV_PREFIX);
+    fs::create_directories(m_sandbox_root / "tmp");
+    fs::create_directories(m_sandbox_root / CRETE_REPLAY_GCOV_PREFIX);
+}
+
+// Mount a fresh copy-on-write view of the input sandbox at the launch directory,
+// so that a reset only discards what the last test case wrote, instead of
+// copying the whole input sandbox again.
+// ret: true, if the overlay is mounted; false, if not (e.g. no overlayfs support)
+bool CreteReplay::mount_sandbox_overlay()
+{
+    fs::path crete_sandbox_exec_path = m_sandbox_root / m_launch_directory;
+    fs::path overlay_dir = m_sandbox_root.string() + ".overlay";
+    fs::path upper_dir = overlay_dir / "upper";
+    fs::path work_dir = overlay_dir / "work";
+
+    umount(crete_sandbox_exec_path.string().c_str());
+
+    if(fs::exists(overlay_dir))
+    {
+        reset_folder_permission_recursively(overlay_dir);
+        fs::remove_all(overlay_dir);
+    }
+
+    fs::create_directories(upper_dir);
+    fs::create_directories(work_dir);
+
+    if(fs::exists(crete_sandbox_exec_path))
+    {
+        // only an empty mount point remains if the previous one was an overlay
+        reset_sandbox_folder_permission();
+        fs::remove_all(crete_sandbox_exec_path);
+    }
+    fs::create_directories(crete_sandbox_exec_path);
+
+    const string options = "lowerdir=" + fs::canonical(m_input_sandbox).string() +
+            ",upperdir=" + upper_dir.string() +
+            ",workdir=" + work_dir.string();
+
+    return mount("overlay", crete_sandbox_exec_path.string().c_str(), "overlay",
+            0, options.c_str()) == 0;
 }
 
 void CreteReplay::reset_sandbox()
 {
+    if(m_sandbox_overlay)
+    {
+        if(mount_sandbox_overlay())
+        {
+            return;
+        }
+
+        fprintf(stderr, "[crete-replay] overlay mount failed (errno = %d), "
+                "falling back to copying the input sandbox\n", errno);
+        m_sandbox_overlay = false;
+    }
+
     reset_sandbox_folder_permission();
 
     // 2. reset "sandbox-exec folder" within sandbox
-    fs::path crete_sandbox_exec_path = fs::path(CRETE_SANDBOX_PATH) / m_launch_directory;
+    fs::path crete_sandbox_exec_path = m_sandbox_root / m_launch_directory;
     fs::remove_all(crete_sandbox_exec_path);
     assert(fs::exists(fs::path(crete_sandbox_exec_path).parent_path()));
 
@@ -388,7 +500,7 @@ void CreteReplay::reset_sandbox()
 
 void CreteReplay::reset_launch_dir()
 {
-    assert(m_launch_directory == fs::path(replay_launch_directory) / fs::canonical(m_input_launch).filename());
+    assert(m_launch_directory == worker_launch_parent(m_worker) / fs::canonical(m_input_launch).filename());
     if(fs::exists(m_launch_directory))
     {
         fs::remove_all(m_launch_directory);
@@ -476,8 +588,6 @@ void CreteReplay::setup_launch()
     m_launch_ctx.output_behavior.insert(bp::behavior_map::value_type(STDERR_FILENO, bp::redirect_stream_to_stdout()));
     m_launch_ctx.input_behavior.insert(bp::behavior_map::value_type(STDIN_FILENO, bp::capture_stream()));
 
-    m_launch_ctx.work_directory = m_launch_directory.string();
-
     if(!m_environment.empty())
     {
         assert(m_launch_ctx.environment.empty());
@@ -495,12 +605,62 @@ void CreteReplay::setup_launch()
         m_launch_ctx.environment = bp::self::get_environment();
     }
     m_launch_ctx.environment.insert(bp::environment::value_type("LD_PRELOAD", "libcrete_replay_preload.so"));
+    m_launch_ctx.environment.insert(bp::environment::value_type(CRETE_CONCOLIC_NAME_SUFFIX, "_p1"));
+
+    m_secondary_cmds = guest_config.get_secondary_cmds();
+}
+
+fs::path CreteReplay::worker_sandbox_root(unsigned worker) const
+{
+    if(m_jobs == 1)
+    {
+        return CRETE_SANDBOX_PATH;
+    }
+
+    return string(CRETE_SANDBOX_PATH) + "-" + boost::lexical_cast<string>(worker);
+}
+
+fs::path CreteReplay::worker_launch_parent(unsigned worker) const
+{
+    if(m_jobs == 1)
+    {
+        return replay_launch_directory;
+    }
+
+    return fs::path(replay_launch_directory) / ("worker-" + boost::lexical_cast<string>(worker));
+}
+
+// Where the gcda files of a worker end up, as seen from outside of any sandbox
+fs::path CreteReplay::worker_gcov_dir(unsigned worker) const
+{
+    if(!m_input_sandbox.empty())
+    {
+        return worker_sandbox_root(worker) / CRETE_REPLAY_GCOV_PREFIX;
+    }
+
+    return worker_launch_parent(worker) / "gcov";
+}
+
+// Setup what has to differ between parallel workers: the sandbox or launch
+// directory, the files read by replay-preload, and GCOV_PREFIX.
+// With a single job, these are the same fixed paths as always.
+void CreteReplay::setup_worker(unsigned worker)
+{
+    m_worker = worker;
+    m_sandbox_root = worker_sandbox_root(worker);
+
+    if(!m_input_launch.empty())
+    {
+        m_launch_directory = worker_launch_parent(worker) / fs::canonical(m_input_launch).filename();
+    }
+
+    m_launch_ctx.work_directory = m_launch_directory.string();
     m_launch_ctx.environment.erase("PWD");
     m_launch_ctx.environment.insert(bp::environment::value_type("PWD", m_launch_ctx.work_directory));
 
     if(!m_input_sandbox.empty())
     {
-        m_launch_ctx.chroot = CRETE_SANDBOX_PATH;
+        m_launch_ctx.chroot = m_sandbox_root.string();
 
         m_launch_ctx.environment.erase("GCOV_PREFIX");
         m_launch_ctx.environment.insert(bp::environment::value_type("GCOV_PREFIX", CRETE_REPLAY_GCOV_PREFIX));
@@ -509,22 +669,35 @@ void CreteReplay::setup_launch()
         {
             init_sandbox();
         }
+    } else if(m_jobs > 1) {
+        fs::path gcov_dir = worker_gcov_dir(worker);
+        fs::remove_all(gcov_dir);
+        fs::create_directories(gcov_dir);
+
+        m_launch_ctx.environment.erase("GCOV_PREFIX");
+        m_launch_ctx.environment.insert(bp::environment::value_type("GCOV_PREFIX", gcov_dir.string()));
     }
 
-    // 4. setup the path for guest_config_serialized
-    if(m_input_sandbox.empty())
+    // setup the path for guest_config_serialized
+    if(!m_input_sandbox.empty())
     {
+        m_guest_config_serialized = m_sandbox_root / CRETE_CONFIG_SERIALIZED_PATH;
+        m_current_tc = m_sandbox_root / CRETE_REPLAY_CURRENT_TC;
+    } else if(m_jobs > 1) {
+        fs::path worker_parent = worker_launch_parent(worker);
+        fs::create_directories(worker_parent);
+
+        m_guest_config_serialized = worker_parent / fs::path(CRETE_CONFIG_SERIALIZED_PATH).filename();
+        m_current_tc = worker_parent / fs::path(CRETE_REPLAY_CURRENT_TC).filename();
+
+        m_launch_ctx.environment.insert(bp::environment::value_type(CRETE_ENV_CONFIG_SERIALIZED, m_guest_config_serialized.string()));
+        m_launch_ctx.environment.insert(bp::environment::value_type(CRETE_ENV_REPLAY_CURRENT_TC, m_current_tc.string()));
+    } else {
         m_guest_config_serialized = CRETE_CONFIG_SERIALIZED_PATH;
         m_current_tc = CRETE_REPLAY_CURRENT_TC;
-    } else {
-        m_guest_config_serialized = fs::path(CRETE_SANDBOX_PATH) / CRETE_CONFIG_SERIALIZED_PATH;
-        m_current_tc = fs::path(CRETE_SANDBOX_PATH) / CRETE_REPLAY_CURRENT_TC;
     }
 
-    m_launch_ctx.environment.insert(bp::environment::value_type(CRETE_CONCOLIC_NAME_SUFFIX, "_p1"));
-
     m_launch_ctx_secondary = m_launch_ctx;
-    m_secondary_cmds = guest_config.get_secondary_cmds();
 }
 
 // Get current date/time, format is YYYY-MM-DD.HH:mm:ss
@@ -549,21 +722,33 @@ static bool end_with (std::string const &fullString, std::string const &ending)
     }
 }
 
-void CreteReplay::collect_gcov_result()
+// Copy gcda files collected under 'gcov_data_dir' (a GCOV_PREFIX) to where the
+// executable under test expects them.
+// Absolute path of a gcda file found under the GCOV_PREFIX 'gcov_dir', which
+// mirrors the absolute paths of the gcda files
+static fs::path strip_gcov_prefix(const fs::path& gcda, const fs::path& gcov_dir)
 {
-//    fprintf(stderr, "collect_gcov_result() entered\n");
+    fs::path::const_iterator it = gcda.begin();
 
-    // gcov data is in the right place if no sandbox is used
-    if(m_input_sandbox.empty())
+    for(fs::path::const_iterator prefix_it = gcov_dir.begin();
+            prefix_it != gcov_dir.end(); ++prefix_it)
     {
-        return;
+        if(*prefix_it == ".")
+            continue; // trailing separator
+
+        assert(it != gcda.end() && *it == *prefix_it);
+        ++it;
     }
 
-    // FIXME: xxx temp workwround that it make take a while for gcov to generate gcda files
-    //        the sleep time of 1 seconds are subjective here
-    sleep(1);
+    fs::path stripped("/");
+    for(; it != gcda.end(); ++it)
+        stripped /= *it;
+
+    return stripped;
+}
 
-    fs::path gcov_data_dir = fs::path(CRETE_SANDBOX_PATH) / CRETE_REPLAY_GCOV_PREFIX;
+static void install_gcov_result(const fs::path& gcov_data_dir)
+{
     for ( boost::filesystem::recursive_directory_iterator end, it(gcov_data_dir);
             it!= end; ++it) {
         if(fs::is_directory(it->path()))
@@ -577,8 +762,7 @@ void CreteReplay::collect_gcov_result()
             assert(0);
         }
 
-        assert(src.string().find(gcov_data_dir.string()) == 0);
-        fs::path tgt(src.string().c_str() +  gcov_data_dir.string().length());
+        fs::path tgt = strip_gcov_prefix(src, gcov_data_dir);
         assert(fs::is_directory(tgt.parent_path()));
 
 //        fprintf(stderr, "copy from %s to %s\n",
@@ -587,10 +771,137 @@ void CreteReplay::collect_gcov_result()
 
         fs::copy_file(src, tgt, fs::copy_option::overwrite_if_exists);
     }
+}
+
+static bool contains_gcda(const fs::path& dir)
+{
+    if(!fs::is_directory(dir))
+    {
+        return false;
+    }
+
+    for ( boost::filesystem::recursive_directory_iterator end, it(dir);
+            it!= end; ++it) {
+        if(end_with(it->path().filename().string(), ".gcda"))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Merge the gcda files of dir1 and dir2 (same layout) into out_dir
+static void gcov_tool_merge(const fs::path& dir1, const fs::path& dir2,
+        const fs::path& out_dir)
+{
+    bp::context ctx;
+    ctx.stdout_behavior = bp::silence_stream();
+    ctx.environment = bp::self::get_environment();
+
+    std::string exec = bp::find_executable_in_path("gcov-tool");
+    std::vector<std::string> args;
+    args.push_back(exec);
+    args.push_back("merge");
+    args.push_back("-o");
+    args.push_back(out_dir.string());
+    args.push_back(dir1.string());
+    args.push_back(dir2.string());
+
+    bp::child c = bp::launch(exec, args, ctx);
+    bp::status s = c.wait();
+
+    CRETE_EXCEPTION_ASSERT(s.exited() && (s.exit_status() == 0),
+            err::msg("gcov-tool merge failed: " + dir1.string() + " + " + dir2.string()));
+}
+
+void CreteReplay::collect_gcov_result()
+{
+//    fprintf(stderr, "collect_gcov_result() entered\n");
+
+    if(m_jobs > 1)
+    {
+        merge_gcov_results();
+        return;
+    }
+
+    // gcov data is in the right place if no sandbox is used
+    if(m_input_sandbox.empty())
+    {
+        return;
+    }
+
+    // The gcda files are complete, as each replayed child has been waited on.
+    install_gcov_result(m_sandbox_root / CRETE_REPLAY_GCOV_PREFIX);
 
 //    fprintf(stderr, "collect_gcov_result() finished\n");
 }
 
+// Fold the gcda files of all workers into one set with gcov-tool, and install it.
+// Without a sandbox, the existing gcda files are folded in as well, as the
+// executable would have accumulated into them when replayed sequentially.
+void CreteReplay::merge_gcov_results()
+{
+    const fs::path merge_dir = replay_gcov_merge_directory;
+    fs::remove_all(merge_dir);
+    fs::create_directories(merge_dir);
+
+    fs::path merged;
+
+    if(m_input_sandbox.empty())
+    {
+        const fs::path existing = merge_dir / "existing";
+
+        for(unsigned worker = 0; worker < m_jobs; ++worker)
+        {
+            const fs::path gcov_dir = worker_gcov_dir(worker);
+            if(!fs::is_directory(gcov_dir))
+                continue;
+
+            for ( boost::filesystem::recursive_directory_iterator end, it(gcov_dir);
+                    it!= end; ++it) {
+                fs::path tgt = strip_gcov_prefix(it->path(), gcov_dir);
+                fs::path copy = existing / tgt.relative_path();
+
+                if(fs::is_regular_file(tgt) && !fs::exists(copy))
+                {
+                    fs::create_directories(copy.parent_path());
+                    fs::copy_file(tgt, copy);
+                }
+            }
+        }
+
+        if(contains_gcda(existing))
+        {
+            merged = existing;
+        }
+    }
+
+    for(unsigned worker = 0; worker < m_jobs; ++worker)
+    {
+        const fs::path gcov_dir = worker_gcov_dir(worker);
+        if(!contains_gcda(gcov_dir))
+            continue;
+
+        if(merged.empty())
+        {
+            merged = gcov_dir;
+            continue;
+        }
+
+        const fs::path out_dir = merge_dir / boost::lexical_cast<string>(worker);
+        gcov_tool_merge(merged, gcov_dir, out_dir);
+        merged = out_dir;
+    }
+
+    if(!merged.empty())
+    {
+        install_gcov_result(merged);
+    }
+
+    fs::remove_all(merge_dir);
+}
+
 static unsigned monitored_pid = 0;
 static unsigned monitored_timeout = 3;
 
@@ -703,8 +1014,6 @@ static bool execute_command_line(const std::string& cmd, const bp::posix_context
 
 void CreteReplay::replay()
 {
-    init_timeout_handler();
-
     // Read all test cases to replay
     vector<string> test_list = get_files_ordered(m_tc_dir);
 
@@ -724,19 +1033,105 @@ void CreteReplay::replay()
             << "Working directory: " << m_cwd.string() << endl
             << "Launch direcotory: " << m_launch_directory.string() << endl
             << "Number of test cases: " << test_list.size() << endl
+            << "Number of jobs: " << m_jobs << endl
             << endl;
 
-    uint64_t replayed_tc_count = 1;
-    for (vector<string>::const_iterator it(test_list.begin()), it_end(test_list.end());
-            it != it_end; ++it)
+    if(m_jobs == 1)
     {
-        if(m_seed_mode && (replayed_tc_count != 1))
+        init_timeout_handler();
+        setup_worker(0);
+        replay_tests(test_list, ofs_replay_log);
+        collect_gcov_result();
+
+        return;
+    }
+
+    // Each worker is a process of its own, as the timeout handling relies on
+    // alarm() and a single monitored pid
+    ofs_replay_log.flush();
+    cout.flush();
+
+    vector<pid_t> workers;
+    for(unsigned worker = 0; worker < m_jobs; ++worker)
+    {
+        pid_t pid = fork();
+        CRETE_EXCEPTION_ASSERT(pid >= 0, err::c_errno(errno));
+
+        if(pid == 0)
+        {
+            int exit_code = 0;
+
+            try
+            {
+                fs::ofstream ofs_worker_log;
+
+                if(m_enable_log)
+                {
+                    ofs_worker_log.open(m_cwd / (replay_log_file + "." + boost::lexical_cast<string>(worker)));
+                } else {
+                    ofs_worker_log.open("/dev/null");
+                }
+
+                init_timeout_handler();
+                setup_worker(worker);
+                replay_tests(test_list, ofs_worker_log);
+            }
+            catch(...)
+            {
+                cerr << "[CRETE Replay] Exception Info (worker " << worker << "): \n"
+                        << boost::current_exception_diagnostic_information() << endl;
+                exit_code = -1;
+            }
+
+            exit(exit_code);
+        }
+
+        workers.push_back(pid);
+    }
+
+    bool workers_succeeded = true;
+    for(unsigned worker = 0; worker < workers.size(); ++worker)
+    {
+        int status = 0;
+        waitpid(workers[worker], &status, 0);
+
+        if(!(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+        {
+            fprintf(stderr, "[CRETE ERROR] [crete-replay] worker %u failed\n", worker);
+            workers_succeeded = false;
+        }
+
+        if(m_enable_log)
+        {
+            fs::path worker_log = m_cwd / (replay_log_file + "." + boost::lexical_cast<string>(worker));
+            fs::ifstream ifs_worker_log(worker_log);
+            ofs_replay_log << ifs_worker_log.rdbuf();
+            ifs_worker_log.close();
+            fs::remove(worker_log);
+        }
+    }
+
+    CRETE_EXCEPTION_ASSERT(workers_succeeded, err::msg("replay worker failed"));
+
+    collect_gcov_result();
+}
+
+// Replay the share of 'test_list' of the current worker, i.e. every m_jobs-th
+// test case starting from m_worker
+void CreteReplay::replay_tests(const vector<string>& test_list,
+        fs::ofstream& ofs_replay_log)
+{
+    for (uint64_t tc_index = m_worker; tc_index < test_list.size(); tc_index += m_jobs)
+    {
+        vector<string>::const_iterator it = test_list.begin() + tc_index;
+
+        if(m_seed_mode && (tc_index != 0))
         {
             break;
         }
 
         ofs_replay_log << "====================================================================\n";
-        ofs_replay_log << "Start to replay tc-" << dec << replayed_tc_count++ << endl;
+        ofs_replay_log << "Start to replay tc-" << dec << (tc_index + 1) << endl;
 
         // prepare for replay
         {
@@ -836,8 +1231,6 @@ void CreteReplay::replay()
         }
         ofs_replay_log << "====================================================================\n";
     }
-
-    collect_gcov_result();
 }
 
 // FIXME: xxx add timeout to deal with GDB hanging
@@ -6,6 +6,7 @@
 #include <crete/harness_config.h>
 
 #include <boost/process.hpp>
+#include <boost/filesystem/fstream.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <boost/program_options/options_description.hpp>
 
@@ -50,6 +51,11 @@ private:
     fs::path m_exploitable_out;
     fs::path m_exploitable_script;
 
+    unsigned m_jobs;
+    unsigned m_worker;
+    fs::path m_sandbox_root;
+    bool m_sandbox_overlay;
+
 public:
     CreteReplay(int argc, char* argv[]);
 
@@ -57,15 +63,24 @@ private:
     boost::program_options::options_description make_options();
     void process_options(int argc, char* argv[]);
     void setup_launch();
+    void setup_worker(unsigned worker);
+
+    fs::path worker_sandbox_root(unsigned worker) const;
+    fs::path worker_launch_parent(unsigned worker) const;
+    fs::path worker_gcov_dir(unsigned worker) const;
 
     void init_sandbox();
     void reset_sandbox();
+    bool mount_sandbox_overlay();
     void reset_sandbox_folder_permission();
 
     void reset_launch_dir();
 
     void collect_gcov_result();
+    void merge_gcov_results();
     void replay();
+    void replay_tests(const vector<string>& test_list,
+            fs::ofstream& ofs_replay_log);
 
     void check_exploitable(const fs::path& tc_path,
             const string& replay_log) const;
@@ -14,6 +14,7 @@ DISPATCH=$CRETE_BINARY_DIR/crete-dispatch
 VM_NODE=$CRETE_BINARY_DIR/crete-vm-node
 SVM_NODE=$CRETE_BINARY_DIR/crete-svm-node
 COVERAGE=$CRETE_BINARY_DIR/crete-coverage
+TC_COMPARE=$CRETE_BINARY_DIR/crete-tc-compare
 
 if [[ ! -f $DISPATCH ]]; then
 	echo "Error: crete-dispatch not found"
@@ -31,6 +32,10 @@ if [[ ! -f $COVERAGE ]]; then
 	echo "Error: crete-coverage not found"
 	exit 1
 fi
+if [[ ! -f $TC_COMPARE ]]; then
+	echo "Error: crete-tc-compare not found"
+	exit 1
+fi
 
 $DISPATCH -c crete.dispatch.xml &
 DISPATCH_PID=$!
@@ -43,6 +48,9 @@ SVM_NODE_PID=$!
 
 wait $DISPATCH_PID
 
+# Tests are kept in test logs: write them out as one file each, under test-case-parsed
+$TC_COMPARE -b dispatch/last 2> /dev/null
+
 rm -f coverages.txt
 
 for dir in dispatch/last/*
@@ -53,7 +61,7 @@ do
 	echo "Generating coverage report for: $prog " $dir 
 	
 	echo $prog >> coverages.txt
-	$COVERAGE -t "$dir/test-case" -c cov.config.xml -e "coreutils-6.10/src/$prog" > /dev/null
+	$COVERAGE -t "$dir/test-case-parsed" -c cov.config.xml -e "coreutils-6.10/src/$prog" > /dev/null
 	cd coreutils-6.10/src && gcov -b "coreutils-6.10/src/$prog" >> ../../coverages.txt
 	cd ../..
 done